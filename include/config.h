@@ -1,6 +1,11 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+// Rain filter, servo, wind calibration and publish settings below are the
+// defaults of the runtime settings (settings.h): MQTT_TOPIC_CMD_CONFIG
+// changes them without a reflash and NVS keeps the changes.
+#define SETTINGS_NVS_NAMESPACE "settings"
+
 // =================== PIN DEFINITIONS ===================
 #define RAIN_A0 34   // Analog from rain module (ADC1)
 #define RAIN_D0 26   // Digital output (potentiometer threshold)
@@ -9,12 +14,54 @@
 #define SERVO_PIN 13 // SG90 servo signal
 #define HALL_PIN 32  // Hall sensor (wind anemometer)
 
+// =================== POWER SETTINGS ===================
+// Low-power mode: the ULP coprocessor counts hall pulses and watches the
+// rain sensor while the cores sit in light sleep; they wake to publish, on
+// a rain transition and to refresh the display (power.cpp). The radio is
+// off while they sleep and rejoins for each publish. HALL_PIN and RAIN_D0
+// must be RTC GPIOs and RAIN_A0 an ADC1 pin.
+#ifndef POWER_LOW_POWER
+#define POWER_LOW_POWER 0
+#endif
+#define ULP_PERIOD_US 2000        // ULP run interval: HALL_PIN sampled at 500 Hz (pulses must stay low longer)
+#define ULP_RAIN_EVERY 50         // Rain ADC and RAIN_D0 checked every Nth run (100 ms)
+#define ULP_RAIN_CONFIRM 3        // Checks in a row that disagree with the cores before waking them
+#define POWER_DISPLAY_MS 5000     // Display refresh wake
+#define POWER_MAX_SLEEP_MS 10000  // Longest sleep
+#define POWER_MIN_SLEEP_MS 20     // Not worth sleeping for less
+#define POWER_RAIN_AWAKE_MS 15000 // Stay awake after a rain wake (servo debounce and dwell)
+#define POWER_REJOIN_MS 2500      // Radio back on this long before a publish (WiFi join, broker connect)
+#define ULP_ADC_HANDOVER_US 150   // Longest ULP run (program + one conversion): the cores wait this before reading ADC1
+
 // =================== WIND SENSOR SETTINGS ===================
 #define PPR 1                 // Pulses per revolution (1 magnet = 1 pulse)
 #define MIN_PULSE_US 20000    // Debounce: ignore pulses <20ms apart
 #define WIND_TIMEOUT_MS 10000 // No pulse for this long → wind=0
 #define RADIUS_M 0.06f        // Cup radius (meters) from axis to magnet
 #define K_FACTOR 1.10f        // Calibration factor (tune after testing)
+#define WIND_CAL_SLOPE 0.0063f  // m/s per rpm (linear calibration)
+#define WIND_CAL_OFFSET 1.9973f // m/s
+#define WIND_CAL_MIN_RPM 10.0f  // Slower than this reads as calm
+
+// Every debounced pulse period goes through a ring to readWind(); speed is
+// sampled from it at WIND_SAMPLE_HZ (WMO: 4 Hz), the gust is the highest
+// WIND_GUST_S running mean, the means are plain averages of 1 s means
+#define WIND_PULSE_RING 64    // Pulse periods in flight (power of two, >= max Hz * 80 ms)
+#define WIND_SAMPLE_HZ 4      // Speed samples per second
+#define WIND_GUST_S 3         // Gust averaging time
+#define WIND_MEAN_SHORT_S 120 // 2-minute mean
+#define WIND_MEAN_LONG_S 600  // 10-minute mean (and the gust reporting period)
+
+// Pulse capture: 0 = GPIO interrupt per pulse with MIN_PULSE_US software
+// debounce; 1 = PCNT unit 0 counts edges in hardware behind its glitch
+// filter (no interrupts, exact count; the period is measured over a span
+// of at least WIND_PCNT_SPAN_MS, so speed trails by up to that span).
+// In low-power mode the ULP counts instead (POWER_LOW_POWER).
+#ifndef WIND_PCNT
+#define WIND_PCNT 0
+#endif
+#define WIND_PCNT_FILTER 1023  // Glitch filter in APB cycles (max 1023 = 12.8 us)
+#define WIND_PCNT_SPAN_MS 1000 // Shortest span a PCNT period is measured over
 
 // =================== RAIN SENSOR SETTINGS ===================
 #define LOGIC_PERIOD_MS 80 // Rain sensor polling interval
@@ -23,8 +70,56 @@
 #define TRIGGER_DROP 90    // Instant wet trigger threshold
 #define DRY_HYST 80        // Hysteresis for dry calibration drift
 #define MIN_DENOM 80       // Minimum denominator for percentage calc
-#define PCT_EASE_WET 0.65f // EMA alpha when wet
-#define PCT_EASE_DRY 0.25f // EMA alpha when dry
+#define PCT_EASE_WET_Q8 166 // EMA alpha when wet, Q0.8 (0.65)
+#define PCT_EASE_DRY_Q8 64  // EMA alpha when dry, Q0.8 (0.25)
+
+// Boot calibration and its warm start from NVS (rain_sensor.cpp)
+#define RAIN_BOOT_CAL_TICKS 4            // Updates averaged into a fresh dry reference (reads dry until then)
+#define RAIN_WARM_TOLERANCE 150          // Boot reading this close to the saved dryRef counts as a dry plate
+#define RAIN_CAL_NVS_NAMESPACE "raincal" // Saved dryRef, wetRef, RAIN_D0 polarity
+#define RAIN_CAL_CHECK_MS 5000           // How often the learned references are compared with the saved ones
+#define RAIN_CAL_SAVE_DELTA 16           // Counts a reference must move before it is worth a write
+#define RAIN_CAL_SAVE_MS 900000          // At most one drift write per 15 min (recalibrations save at once)
+
+// Continuous sampling: the ADC streams RAIN_A0 into DMA buffers (I2S0 in
+// built-in ADC mode); each tick averages RAIN_ADC_DECIMATE samples into one
+// decimated value and reports the mean of the last RAIN_ADC_SMOOTH of them.
+#define RAIN_ADC_CONTINUOUS (!POWER_LOW_POWER) // 0 = blocking analogRead() averaging (the ULP needs ADC1)
+#define RAIN_ADC_SAMPLE_RATE 8000 // Hz
+#define RAIN_ADC_DECIMATE 64      // → 125 Hz decimated rate
+#define RAIN_ADC_SMOOTH 8         // 64 ms output window (one LOGIC_PERIOD_MS)
+#define RAIN_ADC_DMA_BUFS 4       // x RAIN_ADC_DMA_LEN samples = 128 ms of slack
+#define RAIN_ADC_DMA_LEN 256
+
+// =================== BME280 SETTINGS ===================
+// Forced mode: one conversion per BME_PERIOD_MS, collected in one burst
+// read; the acquisition tick uses the cached values in between
+#define BME_PERIOD_MS 1000 // Conversion cadence
+#define BME_OSRS_T 1       // Oversampling 1, 2, 4, 8, 16
+#define BME_OSRS_P 1       // Oversampling 0 (skip), 1, 2, 4, 8, 16
+#define BME_OSRS_H 1       // Oversampling 0 (skip), 1, 2, 4, 8, 16
+#define BME_IIR 0          // IIR filter coefficient 0 (off), 2, 4, 8, 16
+
+// =================== ACQUISITION SETTINGS ===================
+// Dual core: rain/wind/BME280 sampling runs in its own FreeRTOS task on
+// ACQ_CORE and hands samples to loop() (UI, MQTT) through a lock-free ring.
+// The host simulator stays single-threaded so replays are deterministic.
+// Low-power mode samples in the loop scheduler too: the ADC1 hand-off to
+// the ULP and the decision to sleep must happen in one task (power.h).
+#ifndef ACQ_DUAL_CORE
+#if defined(NATIVE_SIM) || POWER_LOW_POWER
+#define ACQ_DUAL_CORE 0
+#else
+#define ACQ_DUAL_CORE 1
+#endif
+#endif
+#if ACQ_DUAL_CORE && POWER_LOW_POWER
+#error "POWER_LOW_POWER needs ACQ_DUAL_CORE 0: powerAdcClaim() and powerIdle() must run in one task"
+#endif
+#define ACQ_CORE 1            // with loop(); WiFi/lwIP keep core 0 to themselves
+#define ACQ_STACK_SIZE 4096   // bytes
+#define ACQ_TASK_PRIORITY 2   // above loop() (1): preempts TFT/MQTT work
+#define SAMPLE_RING_SIZE 16   // power of two; ~1.3 s of 80 ms samples
 
 // =================== SERVO SETTINGS ===================
 #define SERVO_ANGLE_DRY 100   // Servo angle when dry (adjust if not straight)
@@ -44,6 +139,15 @@
 #define MQTT_USER "minor_smart_things"
 #define MQTT_PASS "smart_things_2025"
 
+// TLS on the broker connection (tls_client; the pinned CA is in include/mqtt_ca.h)
+#ifndef MQTT_TLS
+#define MQTT_TLS 0                               // The broker still answers plain MQTT on 8883
+#endif
+#define MQTT_TLS_SERVER_NAME "broker.example.net" // SNI; must be a DNS name in the broker certificate
+#define MQTT_TLS_HANDSHAKE_TIMEOUT_MS 10000      // Give up on one handshake
+#define MQTT_TLS_SESSION_PATH "/tls_session.bin" // Session of the last full handshake (LittleFS)
+#define MQTT_TLS_SESSION_MAX_AGE_S 86400         // Do not offer a saved session older than this
+
 // MQTT Topics
 #define MQTT_TOPIC_GPS "homestations/1053258/1/gps"
 #define MQTT_TOPIC_WIND "homestations/1053258/1/windspeed"
@@ -53,8 +157,93 @@
 #define MQTT_TOPIC_PRESSURE "homestations/1053258/1/airpressure"
 #define MQTT_TOPIC_MOTOR "homestations/1053258/1/motor"
 #define MQTT_TOPIC_UPDATE "homestations/1053258/1/update"
+#define MQTT_TOPIC_DIAG "homestations/1053258/1/diagnostics" // Stage latency histograms, heap (JSON)
+#define MQTT_TOPIC_CMD_CALIBRATE "homestations/1053258/1/cmd/calibrate" // "dry" or a raw ADC dry reference
+#define MQTT_TOPIC_CMD_INTERVAL "homestations/1053258/1/cmd/interval"   // Publish interval in seconds
+#define MQTT_TOPIC_CMD_REBOOT "homestations/1053258/1/cmd/reboot"       // "reboot"
+#define MQTT_TOPIC_CMD_CONFIG "homestations/1053258/1/cmd/config"       // "key=value ...", "key=default", "reset"
+#define MQTT_TOPIC_CONFIG "homestations/1053258/1/config" // Settings in force after each change (JSON)
+#define MQTT_TOPIC_BACKLOG "homestations/1053258/1/backlog" // Replayed offline samples (JSON array)
+
+#define MQTT_TOPIC_DATA "homestations/1053258/1/data"                 // PAYLOAD_JSON document
+#define MQTT_TOPIC_DATA_MSGPACK "homestations/1053258/1/data/msgpack" // PAYLOAD_MSGPACK document
+#define MQTT_TOPIC_ROLLUP_1M "homestations/1053258/1/rollup/1m"        // Per-channel n/mean/min/max/sd
+#define MQTT_TOPIC_ROLLUP_10M "homestations/1053258/1/rollup/10m"
+#define MQTT_TOPIC_ROLLUP_1H "homestations/1053258/1/rollup/1h"
+
+#define PUBLISH_INTERVAL 10000 // Publish every 10 seconds (default, cmd/interval or publish_ms changes it)
+#define PUBLISH_INTERVAL_MIN_S 1     // cmd/interval accepted range
+#define PUBLISH_INTERVAL_MAX_S 3600
+#define REBOOT_MIN_UPTIME_MS 60000 // Ignore cmd/reboot earlier (a retained message would boot-loop)
+
+// Payload format of mqttPublishData (runtime setting payload_format)
+#define PAYLOAD_LEGACY 0                   // One message per value on the topics above
+#define PAYLOAD_JSON 1                     // One JSON document per cycle (seq, ts, all values)
+#define PAYLOAD_MSGPACK 2                  // Same document as MessagePack
+#define MQTT_PAYLOAD_FORMAT PAYLOAD_LEGACY // The existing backend reads the per-topic values
+
+// Which values a publish cycle sends (runtime setting publish_policy)
+#define PUBLISH_EVERY 0                          // All of them, every PUBLISH_INTERVAL
+#define PUBLISH_ON_CHANGE 1                      // Only those outside their deadband (report by exception)
+#define MQTT_PUBLISH_POLICY PUBLISH_EVERY      // The existing backend expects every value each interval
+#define PUBLISH_DEADBAND_WIND 0.5f               // m/s from the value last sent
+#define PUBLISH_DEADBAND_TEMP 0.2f               // °C
+#define PUBLISH_DEADBAND_HUM 1.0f                // %
+#define PUBLISH_DEADBAND_PRESSURE 0.3f           // hPa (rain and motor: any change, sent at once)
+#define PUBLISH_HEARTBEAT_MS 300000              // Resend a value unchanged for this long
+
+// Connection manager (non-blocking; retries back off exponentially with jitter)
+#define WIFI_JOIN_TIMEOUT_MS 15000     // Give up on one WiFi join attempt
+#define MQTT_TCP_TIMEOUT_MS 5000       // Give up on one broker TCP connect
+#define MQTT_CONNACK_TIMEOUT_MS 3000   // Give up on CONNACK once CONNECT is sent (polled)
+#define MQTT_KEEPALIVE_S 15            // Sent in CONNECT; PubSubClient pings at this interval
+#define MQTT_SOCKET_TIMEOUT_S 1        // PubSubClient per-byte read wait; it only gets complete packets
+#define RECONNECT_BACKOFF_MIN_MS 1000  // First retry window
+#define RECONNECT_BACKOFF_MAX_MS 60000 // Retry window cap
+#define MQTT_BUFFER_SIZE 1280          // PubSubClient packet buffer (backlog batches)
+#define NTP_SERVER "pool.ntp.org"      // Timestamps for buffered samples
+
+// Outbound queue: publishes are copied here and written from mqttMaintain()
+// only while the socket has send-buffer room, so a slow link never stalls a task
+#define MQTT_QUEUE_SLOTS 24        // Messages (a legacy cycle is seven)
+#define MQTT_QUEUE_BYTES 4096      // Payload arena (a diagnostics document is ~600 B)
+#define MQTT_DRAIN_BUDGET_US 2000  // Stop writing after this long per mqttMaintain() call
+
+// =================== OFFLINE BUFFER SETTINGS ===================
+// Samples taken while the broker is unreachable go to a ring file in
+// LittleFS and are replayed on MQTT_TOPIC_BACKLOG once the session is back.
+#define OFFLINE_CAPACITY 8640       // Records (36 B each): 24 h of 10 s samples
+#define OFFLINE_FLUSH_RECORDS 16    // Staged in RAM, written to flash in one go
+#define OFFLINE_INDEX_SAVE_MS 30000 // Min interval between index writes while replaying
+#define OFFLINE_REPLAY_BATCH 10     // Records per backlog message
+#define OFFLINE_REPLAY_MS 1000      // Min interval between backlog messages
+
+// =================== ROLLUP SETTINGS ===================
+// Every acquisition sample is folded into 1-minute aggregates per channel;
+// closed minutes merge into 10-minute ones, and those into hours. Each
+// level is published on its MQTT_TOPIC_ROLLUP_* topic when it closes.
+#define ROLLUP_BASE_MS 60000 // Finest window
+#define ROLLUP_MID_FACTOR 10 // Base windows per middle window (10 min)
+#define ROLLUP_TOP_FACTOR 6  // Middle windows per top window (1 h)
+
+// =================== SCHEDULER SETTINGS ===================
+#define HEARTBEAT_MS 400       // UI heartbeat blink period
+#define MQTT_MAINTAIN_MS 10    // Connection upkeep + inbound messages
+#define SCHED_REPORT_MS 60000  // Task timing table on Serial
+#define DIAG_PUBLISH_MS 300000 // Stage latency window published on MQTT_TOPIC_DIAG
+#define PROF_OVERRUN_US 20000  // A single stage run longer than this counts as an overrun
+
+// =================== UI SETTINGS ===================
+// Changing parts of the screen are composed in sprites and pushed by DMA;
+// any surface that does not fit falls back to drawing on the panel.
+#define UI_SPRITES 1            // 0 = always draw directly
+#define UI_SPRITE_BUDGET 40960  // Bytes of RAM for all sprites together (35 KB with all five)
+#define UI_HEAP_RESERVE 49152   // Leave at least this much heap for WiFi/TLS
 
-#define PUBLISH_INTERVAL 10000 // Publish every 10 seconds
+// Card sparklines: a sweep chart of one point per period, only the newest
+// column is drawn per point
+#define HISTORY_LEN 80          // Points per metric (one chart column each)
+#define HISTORY_PERIOD_MS 90000 // Mean over 90 s per point: 2 h of history
 
 // =================== UI THEME COLORS ===================
 #define COL_BG 0x0000      // TFT_BLACK
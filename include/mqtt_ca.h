@@ -0,0 +1,14 @@
+#ifndef MQTT_CA_H
+#define MQTT_CA_H
+
+// CA certificate (PEM) that signed the broker's certificate, used with
+// MQTT_TLS 1. It is the only root the station trusts: a broker certificate
+// from any other CA fails the handshake. Replace the placeholder with the
+// real one, e.g. the last certificate printed by
+//   openssl s_client -connect <broker>:8883 -showcerts
+static const char MQTT_CA_PEM[] =
+    "-----BEGIN CERTIFICATE-----\n"
+    "(placeholder: the broker's CA certificate goes here)\n"
+    "-----END CERTIFICATE-----\n";
+
+#endif // MQTT_CA_H
@@ -0,0 +1,202 @@
+#ifndef NATIVE_SIM_ARDUINO_H
+#define NATIVE_SIM_ARDUINO_H
+
+// Host stand-in for the subset of the Arduino-ESP32 core the station uses.
+// Timing and I/O are routed to the simulated hardware in sim.cpp.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+
+#include "sim.h"
+
+// arduino-esp32 pulls these into the global namespace as well
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+
+#define IRAM_ATTR
+
+#define LOW 0x0
+#define HIGH 0x1
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define digitalPinToInterrupt(p) (p)
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef enum
+{
+    ADC_0db,
+    ADC_2_5db,
+    ADC_6db,
+    ADC_11db
+} adc_attenuation_t;
+
+// uint32_t on purpose: unsigned long is 32-bit on the ESP32, so wrap-around
+// arithmetic in the sketch behaves the same on the host.
+inline uint32_t millis() { return (uint32_t)(simMicros() / 1000); }
+inline uint32_t micros() { return (uint32_t)simMicros(); }
+
+inline void delay(uint32_t ms)
+{
+    simStats().delayUs += (uint64_t)ms * 1000;
+    simAdvanceUs((uint64_t)ms * 1000);
+}
+
+inline void delayMicroseconds(uint32_t us)
+{
+    simStats().delayUs += us;
+    simAdvanceUs(us);
+}
+
+inline int analogRead(uint8_t pin) { return simAnalogRead(pin); }
+inline int digitalRead(uint8_t pin) { return simDigitalRead(pin); }
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline void analogSetWidth(uint8_t) {}
+inline void analogSetPinAttenuation(uint8_t, adc_attenuation_t) {}
+
+inline long random(long howbig) { return simRandom(howbig); }
+inline long random(long howsmall, long howbig) { return howsmall >= howbig ? howsmall : howsmall + simRandom(howbig - howsmall); }
+inline void randomSeed(unsigned long) {} // seeded from SimConfig::seed
+
+// SNTP: time() turns into UTC sntpSyncMs after this is called with WiFi up
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char *server1,
+                const char *server2 = nullptr, const char *server3 = nullptr);
+
+inline void attachInterrupt(uint8_t pin, void (*isr)(), int mode) { simAttachInterrupt(pin, isr, mode); }
+inline void detachInterrupt(uint8_t pin) { simDetachInterrupt(pin); }
+
+// ---- String (only what the sketch needs) ----
+class String
+{
+public:
+    String(const char *s = "") : s_(s ? s : "") {}
+    String(const std::string &s) : s_(s) {}
+    explicit String(char c) : s_(1, c) {}
+    String(int v) : s_(std::to_string(v)) {}
+    String(unsigned int v) : s_(std::to_string(v)) {}
+    String(long v) : s_(std::to_string(v)) {}
+    String(unsigned long v) : s_(std::to_string(v)) {}
+    String(float v, unsigned char decimals = 2) { format(v, decimals); }
+    String(double v, unsigned char decimals = 2) { format(v, decimals); }
+
+    const char *c_str() const { return s_.c_str(); }
+    unsigned int length() const { return (unsigned int)s_.size(); }
+    long toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(s_.c_str(), nullptr); }
+
+    String &operator+=(const String &o)
+    {
+        s_ += o.s_;
+        return *this;
+    }
+    String &operator+=(const char *o)
+    {
+        s_ += o;
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        s_ += c;
+        return *this;
+    }
+
+    bool operator==(const String &o) const { return s_ == o.s_; }
+    bool operator!=(const String &o) const { return s_ != o.s_; }
+
+    friend String operator+(const String &a, const String &b) { return String(a.s_ + b.s_); }
+    friend String operator+(const String &a, const char *b) { return String(a.s_ + b); }
+    friend String operator+(const char *a, const String &b) { return String(a + b.s_); }
+
+private:
+    void format(double v, unsigned char decimals)
+    {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+        s_ = buf;
+    }
+
+    std::string s_;
+};
+
+class IPAddress
+{
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : b_{a, b, c, d} {}
+    String toString() const
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", b_[0], b_[1], b_[2], b_[3]);
+        return String(buf);
+    }
+
+private:
+    uint8_t b_[4];
+};
+
+// ---- Serial (stdout, silenced with simSetQuiet) ----
+class HardwareSerial
+{
+public:
+    void begin(unsigned long baud) { simConfig().uartBaud = (uint32_t)baud; }
+
+    int printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    void print(const char *s) { write(s); }
+    void print(const String &s) { write(s.c_str()); }
+    void print(char c) { this->printf("%c", c); }
+    void print(int v) { this->printf("%d", v); }
+    void print(unsigned int v) { this->printf("%u", v); }
+    void print(long v) { this->printf("%ld", v); }
+    void print(unsigned long v) { this->printf("%lu", v); }
+    void print(double v, int decimals = 2) { this->printf("%.*f", decimals, v); }
+    void print(const IPAddress &ip) { write(ip.toString().c_str()); }
+
+    void flush() { simSerialFlush(); }
+
+    void println() { write("\n"); }
+    template <typename T>
+    void println(const T &v)
+    {
+        print(v);
+        write("\n");
+    }
+
+private:
+    void write(const char *s);
+};
+
+extern HardwareSerial Serial;
+
+// ---- ESP (chip control) ----
+class EspClass
+{
+public:
+    void restart() { simRestart(); } // the run stops at the next loop() boundary
+    uint32_t getFreeHeap() { return simHeapFreeBytes(); }
+    uint32_t getMaxAllocHeap() { return simHeapMaxBlock(); }
+    uint32_t getMinFreeHeap() { return simHeapMinFreeBytes(); }
+    uint32_t getCpuFreqMHz() { return SIM_CPU_MHZ; }
+    // CCOUNT stand-in: the virtual clock at SIM_CPU_MHZ (sketch code itself takes no time)
+    uint32_t getCycleCount() { return (uint32_t)(simMicros() * SIM_CPU_MHZ); }
+};
+
+extern EspClass ESP;
+
+#endif // NATIVE_SIM_ARDUINO_H
@@ -0,0 +1,27 @@
+#ifndef NATIVE_SIM_CLIENT_H
+#define NATIVE_SIM_CLIENT_H
+
+#include <Arduino.h>
+
+// Arduino Client interface, as PubSubClient sees it. fd() is a sim-only
+// addition: the broker model charges traffic to the socket underneath.
+class Client
+{
+public:
+    virtual ~Client() {}
+    virtual int connect(IPAddress ip, uint16_t port) = 0;
+    virtual int connect(const char *host, uint16_t port) = 0;
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t *buf, size_t size) = 0;
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int read(uint8_t *buf, size_t size) = 0;
+    virtual int peek() = 0;
+    virtual void flush() = 0;
+    virtual void stop() = 0;
+    virtual uint8_t connected() = 0;
+    virtual operator bool() = 0;
+    virtual int fd() const = 0;
+};
+
+#endif // NATIVE_SIM_CLIENT_H
@@ -0,0 +1,31 @@
+#ifndef NATIVE_SIM_ESP32SERVO_H
+#define NATIVE_SIM_ESP32SERVO_H
+
+#include <Arduino.h>
+
+class Servo
+{
+public:
+    int attach(int pin, int minUs = 544, int maxUs = 2400)
+    {
+        (void)minUs;
+        (void)maxUs;
+        pin_ = pin;
+        return 1;
+    }
+    void detach() { pin_ = -1; }
+    bool attached() const { return pin_ >= 0; }
+    void setPeriodHertz(int) {}
+    void write(int angle)
+    {
+        angle_ = constrain(angle, 0, 180);
+        simServoWrite(angle_);
+    }
+    int read() const { return angle_; }
+
+private:
+    int pin_ = -1;
+    int angle_ = 0;
+};
+
+#endif // NATIVE_SIM_ESP32SERVO_H
@@ -0,0 +1,60 @@
+#ifndef NATIVE_SIM_LITTLEFS_H
+#define NATIVE_SIM_LITTLEFS_H
+
+#include <Arduino.h>
+
+#include <memory>
+
+// Flash filesystem stand-in: files live in a host directory (sim_main
+// --flash-dir), so stored data survives a simulated reboot. Writes are
+// counted and charged at flashByteUs per byte.
+
+namespace fs
+{
+
+enum SeekMode
+{
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class File
+{
+public:
+    File() {}
+    explicit File(FILE *f) : f_(f, fclose) {}
+
+    explicit operator bool() const { return (bool)f_; }
+    size_t write(const uint8_t *buf, size_t size);
+    size_t read(uint8_t *buf, size_t size);
+    bool seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void flush();
+    void close() { f_.reset(); }
+
+private:
+    std::shared_ptr<FILE> f_;
+};
+
+class LittleFSFS
+{
+public:
+    bool begin(bool formatOnFail = false, const char *basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+               const char *partitionLabel = "spiffs");
+    void end() {}
+    bool format();
+    File open(const char *path, const char *mode = "r");
+    bool exists(const char *path);
+    bool remove(const char *path);
+    size_t totalBytes() { return 1441792; } // lolin32 default "spiffs" partition
+    size_t usedBytes();
+};
+
+} // namespace fs
+
+using fs::File;
+extern fs::LittleFSFS LittleFS;
+
+#endif // NATIVE_SIM_LITTLEFS_H
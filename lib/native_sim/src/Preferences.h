@@ -0,0 +1,53 @@
+#ifndef NATIVE_SIM_PREFERENCES_H
+#define NATIVE_SIM_PREFERENCES_H
+
+#include <Arduino.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+// NVS stand-in: one namespace per host file (nvs_<name> in the flash
+// directory), rewritten on every change and charged as one 32-byte NVS
+// entry write. Erased with the rest of the flash on a fresh run.
+class Preferences
+{
+public:
+    bool begin(const char *name, bool readOnly = false, const char *partitionLabel = nullptr);
+    void end();
+    bool clear();
+    bool remove(const char *key);
+    bool isKey(const char *key);
+
+    size_t putUChar(const char *key, uint8_t value) { return putBytes(key, &value, sizeof(value)); }
+    size_t putUShort(const char *key, uint16_t value) { return putBytes(key, &value, sizeof(value)); }
+    size_t putUInt(const char *key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+    size_t putFloat(const char *key, float value) { return putBytes(key, &value, sizeof(value)); }
+    uint8_t getUChar(const char *key, uint8_t defaultValue = 0) { return get(key, defaultValue); }
+    uint16_t getUShort(const char *key, uint16_t defaultValue = 0) { return get(key, defaultValue); }
+    uint32_t getUInt(const char *key, uint32_t defaultValue = 0) { return get(key, defaultValue); }
+    float getFloat(const char *key, float defaultValue = NAN) { return get(key, defaultValue); }
+
+    // Blobs; getBytes() copies nothing unless the stored blob fits in maxLen
+    size_t putBytes(const char *key, const void *value, size_t len);
+    size_t getBytesLength(const char *key);
+    size_t getBytes(const char *key, void *buf, size_t maxLen);
+
+private:
+    // Scalars are stored as their bytes, read back only at the same size
+    template <typename T> T get(const char *key, T defaultValue)
+    {
+        T v = defaultValue;
+        if (getBytesLength(key) == sizeof(T))
+            getBytes(key, &v, sizeof(T));
+        return v;
+    }
+    bool save();
+
+    std::string path_;
+    std::map<std::string, std::vector<uint8_t>> values_;
+    bool open_ = false;
+    bool readOnly_ = false;
+};
+
+#endif // NATIVE_SIM_PREFERENCES_H
@@ -0,0 +1,81 @@
+#ifndef NATIVE_SIM_PUBSUBCLIENT_H
+#define NATIVE_SIM_PUBSUBCLIENT_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+// PubSubClient stand-in talking to the broker model in sim.cpp.
+// connect() and publish() block for the configured latency, like the
+// synchronous socket calls of the real library; connect() reuses a client
+// whose socket is already established, writes CONNECT through it and spins
+// until the client has the CONNACK, as PubSubClient 2.8 does. loop() reads
+// inbound packets from the client the same way the library does.
+class PubSubClient
+{
+public:
+    typedef void (*Callback)(char *, uint8_t *, unsigned int);
+
+    explicit PubSubClient(Client &client) : client_(&client) {}
+
+    PubSubClient &setClient(Client &client)
+    {
+        client_ = &client;
+        return *this;
+    }
+
+    PubSubClient &setServer(const char *domain, uint16_t port)
+    {
+        (void)domain;
+        (void)port;
+        return *this;
+    }
+    PubSubClient &setCallback(Callback cb)
+    {
+        callback_ = cb;
+        return *this;
+    }
+    PubSubClient &setSocketTimeout(uint16_t seconds)
+    {
+        socketTimeout_ = seconds;
+        return *this;
+    }
+    PubSubClient &setKeepAlive(uint16_t seconds)
+    {
+        (void)seconds;
+        return *this;
+    }
+    bool setBufferSize(uint16_t size)
+    {
+        bufferSize_ = size;
+        return true;
+    }
+    uint16_t getBufferSize() const { return bufferSize_; }
+
+    bool connect(const char *id, const char *user, const char *pass);
+    void disconnect();
+    bool connected();
+    int state() const { return state_; }
+
+    bool publish(const char *topic, const char *payload);
+    bool publish(const char *topic, const char *payload, bool retained);
+    bool publish(const char *topic, const uint8_t *payload, unsigned int length);
+    bool subscribe(const char *topic);
+    bool loop();
+
+private:
+    bool readByte(uint8_t &b);
+
+    Client *client_;
+    Callback callback_ = nullptr;
+    int state_ = MQTT_DISCONNECTED;
+    uint16_t bufferSize_ = 256; // MQTT_MAX_PACKET_SIZE
+    uint16_t socketTimeout_ = 15; // MQTT_SOCKET_TIMEOUT
+};
+
+#endif // NATIVE_SIM_PUBSUBCLIENT_H
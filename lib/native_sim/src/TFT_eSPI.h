@@ -0,0 +1,108 @@
+#ifndef NATIVE_SIM_TFT_ESPI_H
+#define NATIVE_SIM_TFT_ESPI_H
+
+#include <Arduino.h>
+
+#include <vector>
+
+#ifndef TFT_WIDTH
+#define TFT_WIDTH 240
+#endif
+#ifndef TFT_HEIGHT
+#define TFT_HEIGHT 320
+#endif
+
+#define TL_DATUM 0
+#define TC_DATUM 1
+#define TR_DATUM 2
+#define ML_DATUM 3
+#define MC_DATUM 4
+#define MR_DATUM 5
+#define BL_DATUM 6
+#define BC_DATUM 7
+#define BR_DATUM 8
+
+#define TFT_BLACK 0x0000
+#define TFT_DARKGREY 0x7BEF
+#define TFT_LIGHTGREY 0xD69A
+#define TFT_WHITE 0xFFFF
+#define TFT_RED 0xF800
+#define TFT_GREEN 0x07E0
+#define TFT_CYAN 0x07FF
+
+// Counting ILI9341 stand-in: nothing is rasterised, every primitive is
+// charged as an address-window command plus 2 bytes per touched pixel,
+// which is what the real driver pushes over SPI. Sprites charge CPU time
+// per pixel instead, and pushImageDMA() queues the pixels behind the CPU.
+class TFT_eSPI
+{
+public:
+    TFT_eSPI(int16_t w = TFT_WIDTH, int16_t h = TFT_HEIGHT) : w0_(w), h0_(h) {}
+
+    void init() {}
+    void setRotation(uint8_t r) { rotation_ = r & 3; }
+    int16_t width() const { return (rotation_ & 1) ? h0_ : w0_; }
+    int16_t height() const { return (rotation_ & 1) ? w0_ : h0_; }
+
+    void fillScreen(uint32_t color) { fillRect(0, 0, width(), height(), color); }
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    void fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color);
+    void drawRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color);
+    void fillCircle(int32_t x, int32_t y, int32_t r, uint32_t color);
+    void fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color);
+    void drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color);
+
+    void setTextDatum(uint8_t d) { datum_ = d; }
+    void setTextColor(uint16_t fg, uint16_t bg) { (void)fg, (void)bg; }
+    void setTextFont(uint8_t f) { font_ = f; }
+    void setTextSize(uint8_t s) { size_ = s ? s : 1; }
+    int16_t drawString(const char *s, int32_t x, int32_t y);
+    int16_t drawString(const String &s, int32_t x, int32_t y) { return drawString(s.c_str(), x, y); }
+    int16_t textWidth(const char *s) const;
+    int16_t fontHeight() const;
+
+    void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data);
+
+    // DMA (ESP32 SPI): transfers run on while the CPU continues; the panel
+    // stays selected between startWrite() and endWrite()
+    bool initDMA() { return dmaReady_ = true; }
+    bool dmaBusy() { return simSpiDmaBusy(); }
+    void dmaWait() { simSpiDmaWait(); }
+    void pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data);
+    void startWrite() {}
+    void endWrite() { dmaWait(); }
+
+protected:
+    void charge(uint64_t pixels, uint32_t windows = 1);
+
+    bool offscreen_ = false; // a sprite: drawing costs CPU time, not SPI
+    bool dmaReady_ = false;
+
+    int16_t w0_, h0_;
+    uint8_t rotation_ = 0;
+    uint8_t datum_ = TL_DATUM;
+    uint8_t font_ = 1;
+    uint8_t size_ = 1;
+};
+
+// Off-screen 16-bit buffer, allocated from the simulated heap
+class TFT_eSprite : public TFT_eSPI
+{
+public:
+    explicit TFT_eSprite(TFT_eSPI *tft) : TFT_eSPI(0, 0), tft_(tft) { offscreen_ = true; }
+    ~TFT_eSprite() { deleteSprite(); }
+
+    void setColorDepth(int8_t bits) { (void)bits; } // 16 only
+    void *createSprite(int16_t w, int16_t h);
+    void deleteSprite();
+    bool created() const { return !buf_.empty(); }
+    void *getPointer() { return buf_.empty() ? nullptr : buf_.data(); }
+    void fillSprite(uint32_t color) { fillRect(0, 0, width(), height(), color); }
+    void pushSprite(int32_t x, int32_t y);
+
+private:
+    TFT_eSPI *tft_;
+    std::vector<uint16_t> buf_;
+};
+
+#endif // NATIVE_SIM_TFT_ESPI_H
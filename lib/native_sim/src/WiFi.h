@@ -0,0 +1,81 @@
+#ifndef NATIVE_SIM_WIFI_H
+#define NATIVE_SIM_WIFI_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+typedef enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum
+{
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} wifi_mode_t;
+
+typedef enum
+{
+    ARDUINO_EVENT_WIFI_STA_START = 2,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP = 8,
+    ARDUINO_EVENT_MAX = 64
+} arduino_event_id_t;
+
+typedef void (*WiFiEventCb)(arduino_event_id_t event);
+
+// Station stand-in over the model in sim.cpp: a join request associates
+// wifiAssocMs after the trace reports an AP; losing the AP fires
+// STA_DISCONNECTED and, with auto-reconnect on, starts a new join.
+class WiFiClass
+{
+public:
+    bool mode(wifi_mode_t) { return true; }
+    wl_status_t begin(const char *ssid, const char *pass);
+    wl_status_t status();
+    bool disconnect(bool wifiOff = false);
+    bool reconnect();
+    bool setAutoReconnect(bool on);
+    bool getAutoReconnect();
+    int onEvent(WiFiEventCb cb, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+    IPAddress localIP() { return status() == WL_CONNECTED ? IPAddress(192, 168, 4, 2) : IPAddress(); }
+};
+
+extern WiFiClass WiFi;
+
+// TCP client over a simulated socket
+class WiFiClient : public Client
+{
+public:
+    WiFiClient() {}
+    explicit WiFiClient(int fd) : fd_(fd) {}
+
+    int connect(IPAddress, uint16_t port) override { return connect("broker", port); }
+    int connect(const char *host, uint16_t port) override; // blocking, like the real one
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t *buf, size_t size) override;
+    int available() override; // the CONNACK, then inbound publishes (simSocketAvailable())
+    int read() override;
+    int read(uint8_t *buf, size_t size) override;
+    int peek() override { return -1; }
+    void flush() override {}
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+    int fd() const override { return fd_; }
+
+private:
+    int fd_ = -1;
+};
+
+#endif // NATIVE_SIM_WIFI_H
@@ -0,0 +1,39 @@
+#ifndef NATIVE_SIM_WIRE_H
+#define NATIVE_SIM_WIRE_H
+
+#include <Arduino.h>
+
+#include <vector>
+
+// I2C master stand-in. Transactions go to the device models in
+// sim_devices.cpp (only the BME280 answers) and are charged per byte,
+// address byte included, through simI2cTransfer().
+class TwoWire
+{
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0)
+    {
+        (void)sda;
+        (void)scl;
+        (void)frequency;
+        return true;
+    }
+
+    void beginTransmission(uint16_t address);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t *data, size_t len);
+    uint8_t endTransmission(bool sendStop = true); // 0 = ACK, 2 = address NACK
+    uint8_t requestFrom(uint16_t address, uint8_t size, bool sendStop = true);
+    int available();
+    int read();
+
+private:
+    uint16_t txAddress_ = 0;
+    std::vector<uint8_t> tx_;
+    std::vector<uint8_t> rx_;
+    size_t rxPos_ = 0;
+};
+
+extern TwoWire Wire;
+
+#endif // NATIVE_SIM_WIRE_H
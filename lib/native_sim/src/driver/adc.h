@@ -0,0 +1,42 @@
+#ifndef NATIVE_SIM_DRIVER_ADC_H
+#define NATIVE_SIM_DRIVER_ADC_H
+
+#include <esp_err.h>
+
+typedef enum
+{
+    ADC_UNIT_1 = 1,
+    ADC_UNIT_2 = 2
+} adc_unit_t;
+
+typedef enum
+{
+    ADC1_CHANNEL_0 = 0, // GPIO36
+    ADC1_CHANNEL_3 = 3, // GPIO39
+    ADC1_CHANNEL_4 = 4, // GPIO32
+    ADC1_CHANNEL_5 = 5, // GPIO33
+    ADC1_CHANNEL_6 = 6, // GPIO34
+    ADC1_CHANNEL_7 = 7  // GPIO35
+} adc1_channel_t;
+
+typedef enum
+{
+    ADC_ATTEN_DB_0 = 0,
+    ADC_ATTEN_DB_2_5 = 1,
+    ADC_ATTEN_DB_6 = 2,
+    ADC_ATTEN_DB_11 = 3
+} adc_atten_t;
+
+typedef enum
+{
+    ADC_WIDTH_BIT_9 = 0,
+    ADC_WIDTH_BIT_10 = 1,
+    ADC_WIDTH_BIT_11 = 2,
+    ADC_WIDTH_BIT_12 = 3
+} adc_bits_width_t;
+
+inline esp_err_t adc1_config_width(adc_bits_width_t) { return ESP_OK; }
+inline esp_err_t adc1_config_channel_atten(adc1_channel_t, adc_atten_t) { return ESP_OK; }
+void adc1_ulp_enable(); // the ULP reads ADC1 through I_ADC (sim_ulp.cpp)
+
+#endif // NATIVE_SIM_DRIVER_ADC_H
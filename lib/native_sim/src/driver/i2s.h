@@ -0,0 +1,82 @@
+#ifndef NATIVE_SIM_DRIVER_I2S_H
+#define NATIVE_SIM_DRIVER_I2S_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <driver/adc.h>
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+
+// Legacy I2S driver (IDF 4.4), built-in ADC mode only. Samples are
+// generated from the trace at sample_rate on the virtual clock and handed
+// out in whole DMA buffers, like the real driver; when all dma_buf_count
+// buffers are full the oldest is dropped. Each 16-bit sample carries the
+// channel in bits 15..12 and the 12-bit reading below.
+
+typedef enum
+{
+    I2S_NUM_0 = 0,
+    I2S_NUM_1 = 1
+} i2s_port_t;
+
+typedef enum
+{
+    I2S_MODE_MASTER = 1 << 0,
+    I2S_MODE_SLAVE = 1 << 1,
+    I2S_MODE_TX = 1 << 2,
+    I2S_MODE_RX = 1 << 3,
+    I2S_MODE_DAC_BUILT_IN = 1 << 4,
+    I2S_MODE_ADC_BUILT_IN = 1 << 5
+} i2s_mode_t;
+
+typedef enum
+{
+    I2S_BITS_PER_SAMPLE_16BIT = 16,
+    I2S_BITS_PER_SAMPLE_32BIT = 32
+} i2s_bits_per_sample_t;
+
+typedef enum
+{
+    I2S_CHANNEL_FMT_RIGHT_LEFT = 0,
+    I2S_CHANNEL_FMT_ONLY_RIGHT = 3,
+    I2S_CHANNEL_FMT_ONLY_LEFT = 4
+} i2s_channel_fmt_t;
+
+typedef enum
+{
+    I2S_COMM_FORMAT_STAND_I2S = 0x01,
+    I2S_COMM_FORMAT_STAND_MSB = 0x02
+} i2s_comm_format_t;
+
+typedef struct
+{
+    i2s_mode_t mode;
+    uint32_t sample_rate;
+    i2s_bits_per_sample_t bits_per_sample;
+    i2s_channel_fmt_t channel_format;
+    i2s_comm_format_t communication_format;
+    int intr_alloc_flags;
+    union
+    {
+        int dma_desc_num;
+        int dma_buf_count;
+    };
+    union
+    {
+        int dma_frame_num;
+        int dma_buf_len;
+    };
+    bool use_apll;
+    bool tx_desc_auto_clear;
+    int fixed_mclk;
+} i2s_config_t;
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t *config, int queue_size, void *queue);
+esp_err_t i2s_driver_uninstall(i2s_port_t port);
+esp_err_t i2s_set_adc_mode(adc_unit_t unit, adc1_channel_t channel);
+esp_err_t i2s_adc_enable(i2s_port_t port);
+esp_err_t i2s_adc_disable(i2s_port_t port);
+esp_err_t i2s_read(i2s_port_t port, void *dest, size_t size, size_t *bytes_read, TickType_t ticks_to_wait);
+
+#endif // NATIVE_SIM_DRIVER_I2S_H
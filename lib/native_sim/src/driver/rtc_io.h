@@ -0,0 +1,28 @@
+#ifndef NATIVE_SIM_DRIVER_RTC_IO_H
+#define NATIVE_SIM_DRIVER_RTC_IO_H
+
+#include <esp_err.h>
+
+// Enough of the RTC GPIO driver to route a pad to the ULP
+
+typedef enum
+{
+    GPIO_NUM_NC = -1,
+    GPIO_NUM_0 = 0,
+    GPIO_NUM_39 = 39
+} gpio_num_t;
+
+typedef enum
+{
+    RTC_GPIO_MODE_INPUT_ONLY,
+    RTC_GPIO_MODE_OUTPUT_ONLY,
+    RTC_GPIO_MODE_INPUT_OUTPUT,
+    RTC_GPIO_MODE_DISABLED
+} rtc_gpio_mode_t;
+
+int rtc_io_number_get(gpio_num_t gpio_num); // -1 if the pad has no RTC function
+esp_err_t rtc_gpio_init(gpio_num_t gpio_num);
+inline esp_err_t rtc_gpio_set_direction(gpio_num_t, rtc_gpio_mode_t) { return ESP_OK; }
+inline esp_err_t rtc_gpio_pullup_en(gpio_num_t) { return ESP_OK; }
+
+#endif // NATIVE_SIM_DRIVER_RTC_IO_H
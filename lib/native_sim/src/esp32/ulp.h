@@ -0,0 +1,79 @@
+#ifndef NATIVE_SIM_ESP32_ULP_H
+#define NATIVE_SIM_ESP32_ULP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_err.h>
+
+// ULP FSM coprocessor, legacy macro assembler (IDF 4.4). The macros take
+// the same arguments as on target but build a plain record per
+// instruction; sim_ulp.cpp interprets the loaded program every wakeup
+// period while the virtual clock runs, whether the cores sleep or not.
+// Only the instructions the sketch uses are there. Registers and the ALU
+// are 16 bits; SUB sets the overflow flag when it borrows.
+
+#define R0 0
+#define R1 1
+#define R2 2
+#define R3 3
+
+enum
+{
+    ULP_OP_LABEL,
+    ULP_OP_MOVI,
+    ULP_OP_MOVR,
+    ULP_OP_ADDI,
+    ULP_OP_SUBI,
+    ULP_OP_ADDR,
+    ULP_OP_SUBR,
+    ULP_OP_LD,
+    ULP_OP_ST,
+    ULP_OP_RD_REG,
+    ULP_OP_ADC,
+    ULP_OP_BL,  // R0 < imm
+    ULP_OP_BGE, // R0 >= imm
+    ULP_OP_BX,
+    ULP_OP_BXZ, // zero flag
+    ULP_OP_BXF, // overflow flag
+    ULP_OP_WAKE,
+    ULP_OP_HALT
+};
+
+typedef struct
+{
+    uint8_t op;
+    uint8_t a, b, c; // registers (destination first), or bit range / ADC unit and pad
+    int32_t imm;     // immediate, memory offset or label number
+    uint32_t reg;    // peripheral register (I_RD_REG)
+} ulp_insn_t;
+
+#define I_MOVI(rd, imm) {ULP_OP_MOVI, (uint8_t)(rd), 0, 0, (int32_t)(imm), 0}
+#define I_MOVR(rd, rs) {ULP_OP_MOVR, (uint8_t)(rd), (uint8_t)(rs), 0, 0, 0}
+#define I_ADDI(rd, rs, imm) {ULP_OP_ADDI, (uint8_t)(rd), (uint8_t)(rs), 0, (int32_t)(imm), 0}
+#define I_SUBI(rd, rs, imm) {ULP_OP_SUBI, (uint8_t)(rd), (uint8_t)(rs), 0, (int32_t)(imm), 0}
+#define I_ADDR(rd, rs1, rs2) {ULP_OP_ADDR, (uint8_t)(rd), (uint8_t)(rs1), (uint8_t)(rs2), 0, 0}
+#define I_SUBR(rd, rs1, rs2) {ULP_OP_SUBR, (uint8_t)(rd), (uint8_t)(rs1), (uint8_t)(rs2), 0, 0}
+#define I_LD(rd, raddr, off) {ULP_OP_LD, (uint8_t)(rd), (uint8_t)(raddr), 0, (int32_t)(off), 0}
+#define I_ST(rs, raddr, off) {ULP_OP_ST, (uint8_t)(rs), (uint8_t)(raddr), 0, (int32_t)(off), 0}
+#define I_RD_REG(reg, low, high) {ULP_OP_RD_REG, (uint8_t)(low), (uint8_t)(high), 0, 0, (uint32_t)(reg)}
+#define I_ADC(rd, adc_idx, pad_idx) {ULP_OP_ADC, (uint8_t)(rd), (uint8_t)(adc_idx), (uint8_t)(pad_idx), 0, 0}
+#define I_WAKE() {ULP_OP_WAKE, 0, 0, 0, 0, 0}
+#define I_HALT() {ULP_OP_HALT, 0, 0, 0, 0, 0}
+#define M_LABEL(n) {ULP_OP_LABEL, 0, 0, 0, (int32_t)(n), 0}
+#define M_BL(n, imm) {ULP_OP_BL, 0, 0, 0, (int32_t)(n), (uint32_t)(imm)}
+#define M_BGE(n, imm) {ULP_OP_BGE, 0, 0, 0, (int32_t)(n), (uint32_t)(imm)}
+#define M_BX(n) {ULP_OP_BX, 0, 0, 0, (int32_t)(n), 0}
+#define M_BXZ(n) {ULP_OP_BXZ, 0, 0, 0, (int32_t)(n), 0}
+#define M_BXF(n) {ULP_OP_BXF, 0, 0, 0, (int32_t)(n), 0}
+
+// 8 KB of RTC slow memory, in 32-bit words
+extern uint32_t simRtcSlowMem[2048];
+#define RTC_SLOW_MEM simRtcSlowMem
+
+// psize: instructions in, words used out
+esp_err_t ulp_process_macros_and_load(uint32_t load_addr, const ulp_insn_t *program, size_t *psize);
+esp_err_t ulp_set_wakeup_period(size_t period_index, uint32_t period_us);
+esp_err_t ulp_run(uint32_t entry_point);
+
+#endif // NATIVE_SIM_ESP32_ULP_H
@@ -0,0 +1,24 @@
+#ifndef NATIVE_SIM_ESP_SLEEP_H
+#define NATIVE_SIM_ESP_SLEEP_H
+
+#include <stdint.h>
+
+#include <esp_err.h>
+
+// Light sleep on the virtual clock (sim_ulp.cpp): the clock runs on to the
+// timer deadline or to a ULP wake, the ULP keeps running, the cores and
+// the hall interrupt do not. The WiFi association and sockets are kept.
+
+typedef enum
+{
+    ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+    ESP_SLEEP_WAKEUP_TIMER = 4,
+    ESP_SLEEP_WAKEUP_ULP = 6
+} esp_sleep_wakeup_cause_t;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us);
+esp_err_t esp_sleep_enable_ulp_wakeup();
+esp_err_t esp_light_sleep_start();
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
+
+#endif // NATIVE_SIM_ESP_SLEEP_H
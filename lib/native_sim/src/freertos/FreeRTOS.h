@@ -0,0 +1,12 @@
+#ifndef NATIVE_SIM_FREERTOS_H
+#define NATIVE_SIM_FREERTOS_H
+
+#include <stdint.h>
+
+// Only the types driver stand-ins need; the sim itself is single-threaded
+typedef uint32_t TickType_t;
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+
+#endif // NATIVE_SIM_FREERTOS_H
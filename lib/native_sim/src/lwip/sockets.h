@@ -0,0 +1,23 @@
+#ifndef NATIVE_SIM_LWIP_SOCKETS_H
+#define NATIVE_SIM_LWIP_SOCKETS_H
+
+// lwIP socket stand-in: the lwip_* entry points are backed by the socket
+// model in sim_devices.cpp (no real network traffic). Types and constants
+// come from the host headers, which match lwIP's for everything used here.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+int lwip_socket(int domain, int type, int protocol);
+int lwip_connect(int s, const struct sockaddr *name, socklen_t namelen);
+int lwip_close(int s);
+ssize_t lwip_recv(int s, void *mem, size_t len, int flags); // only MSG_PEEK liveness probes are modelled
+int lwip_fcntl(int s, int cmd, int val);
+int lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptset, struct timeval *timeout);
+int lwip_getsockopt(int s, int level, int optname, void *optval, socklen_t *optlen);
+
+#endif // NATIVE_SIM_LWIP_SOCKETS_H
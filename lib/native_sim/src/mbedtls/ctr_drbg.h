@@ -0,0 +1,17 @@
+#ifndef NATIVE_SIM_MBEDTLS_CTR_DRBG_H
+#define NATIVE_SIM_MBEDTLS_CTR_DRBG_H
+
+#include <stddef.h>
+
+typedef struct mbedtls_ctr_drbg_context
+{
+    int seeded;
+} mbedtls_ctr_drbg_context;
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context *ctx);
+void mbedtls_ctr_drbg_free(mbedtls_ctr_drbg_context *ctx);
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context *ctx, int (*f_entropy)(void *, unsigned char *, size_t),
+                          void *p_entropy, const unsigned char *custom, size_t len);
+int mbedtls_ctr_drbg_random(void *p_rng, unsigned char *output, size_t output_len);
+
+#endif // NATIVE_SIM_MBEDTLS_CTR_DRBG_H
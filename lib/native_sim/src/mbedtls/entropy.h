@@ -0,0 +1,18 @@
+#ifndef NATIVE_SIM_MBEDTLS_ENTROPY_H
+#define NATIVE_SIM_MBEDTLS_ENTROPY_H
+
+// mbedTLS stand-ins (sim_tls.cpp): the types and calls tls_client uses,
+// with the real error codes, over the broker's TLS model
+
+#include <stddef.h>
+
+typedef struct mbedtls_entropy_context
+{
+    int sources;
+} mbedtls_entropy_context;
+
+void mbedtls_entropy_init(mbedtls_entropy_context *ctx);
+void mbedtls_entropy_free(mbedtls_entropy_context *ctx);
+int mbedtls_entropy_func(void *data, unsigned char *output, size_t len);
+
+#endif // NATIVE_SIM_MBEDTLS_ENTROPY_H
@@ -0,0 +1,8 @@
+#ifndef NATIVE_SIM_MBEDTLS_ERROR_H
+#define NATIVE_SIM_MBEDTLS_ERROR_H
+
+#include <stddef.h>
+
+void mbedtls_strerror(int errnum, char *buffer, size_t buflen);
+
+#endif // NATIVE_SIM_MBEDTLS_ERROR_H
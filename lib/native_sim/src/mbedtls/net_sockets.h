@@ -0,0 +1,19 @@
+#ifndef NATIVE_SIM_MBEDTLS_NET_SOCKETS_H
+#define NATIVE_SIM_MBEDTLS_NET_SOCKETS_H
+
+#include <stddef.h>
+
+#define MBEDTLS_ERR_NET_CONN_RESET -0x0050
+
+typedef struct mbedtls_net_context
+{
+    int fd;
+} mbedtls_net_context;
+
+void mbedtls_net_init(mbedtls_net_context *ctx);
+void mbedtls_net_free(mbedtls_net_context *ctx); // closes the socket
+int mbedtls_net_set_nonblock(mbedtls_net_context *ctx);
+int mbedtls_net_send(void *ctx, const unsigned char *buf, size_t len);
+int mbedtls_net_recv(void *ctx, unsigned char *buf, size_t len);
+
+#endif // NATIVE_SIM_MBEDTLS_NET_SOCKETS_H
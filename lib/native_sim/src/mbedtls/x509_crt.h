@@ -0,0 +1,25 @@
+#ifndef NATIVE_SIM_MBEDTLS_X509_CRT_H
+#define NATIVE_SIM_MBEDTLS_X509_CRT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MBEDTLS_ERR_X509_INVALID_FORMAT -0x2180
+#define MBEDTLS_ERR_X509_CERT_VERIFY_FAILED -0x2700
+#define MBEDTLS_X509_BADCERT_NOT_TRUSTED 0x08
+
+// A parsed certificate is its fingerprint: the broker model compares it
+// with the CA that signed its own certificate
+typedef struct mbedtls_x509_crt
+{
+    uint32_t fingerprint;
+    int parsed;
+} mbedtls_x509_crt;
+
+typedef struct mbedtls_x509_crl mbedtls_x509_crl;
+
+void mbedtls_x509_crt_init(mbedtls_x509_crt *crt);
+void mbedtls_x509_crt_free(mbedtls_x509_crt *crt);
+int mbedtls_x509_crt_parse(mbedtls_x509_crt *chain, const unsigned char *buf, size_t buflen); // PEM incl. the NUL
+
+#endif // NATIVE_SIM_MBEDTLS_X509_CRT_H
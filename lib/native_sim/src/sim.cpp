@@ -0,0 +1,798 @@
+#include "sim.h"
+#include "config.h"
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <WiFi.h>
+
+#include <stdarg.h>
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+HardwareSerial Serial;
+EspClass ESP;
+TwoWire Wire;
+WiFiClass WiFi;
+
+static SimConfig g_config;
+static SimStats g_stats;
+static bool g_quiet = false;
+
+// --- UART ---
+static double g_uartFifo = 0.0; // bytes still queued in the TX FIFO
+static uint64_t g_uartLastUs = 0;
+
+// --- Clock ---
+static uint64_t g_nowUs = 0;
+static double g_spiCarryUs = 0.0;
+static uint64_t g_spiDmaDoneUs = 0; // DMA transfer in flight until then
+static double g_spriteCarryUs = 0.0;
+static uint32_t g_heapMinFree = UINT32_MAX;
+
+// --- Trace ---
+static std::vector<SimTraceRow> g_trace;
+static size_t g_cursor = 0;
+static uint32_t g_rng = 1;
+
+// --- Interrupts ---
+static void (*g_hallIsr)() = nullptr;
+static double g_hallPhase = 0.0;
+static bool g_hallCounter = false;
+static uint32_t g_hallCounterEdges = 0;
+
+// --- WiFi station ---
+static bool g_wifiJoining = false;
+static bool g_wifiConnected = false;
+static bool g_wifiAutoReconnect = true;
+static uint64_t g_wifiJoinUs = 0;    // current join attempt started
+static uint64_t g_wifiApSinceUs = 0; // AP continuously in range since
+static std::vector<WiFiEventCb> g_wifiHandlers;
+
+// --- Flash (LittleFS stand-in) ---
+static std::string g_flashDir = "sim_flash";
+static double g_flashCarryUs = 0.0;
+
+// --- SNTP ---
+static bool g_sntpStarted = false;
+static bool g_sntpSynced = false;
+static uint64_t g_sntpStartUs = 0;
+
+// --- Broker ---
+struct Inbound
+{
+    std::string topic;
+    std::string payload;
+    uint32_t atMs;
+};
+static std::deque<Inbound> g_inbound;
+static Inbound g_delivering;
+static std::set<std::string> g_subscriptions;
+
+static bool g_restart = false;
+
+SimConfig &simConfig()
+{
+    return g_config;
+}
+
+SimStats &simStats()
+{
+    return g_stats;
+}
+
+// =================== Operation count ===================
+
+// volatile: the sketch's inlined code must not fold reads of it
+static volatile uint64_t g_ops = 0;
+
+// Inserted by -fsanitize-coverage=trace-pc at every basic block of the
+// instrumented sources; this file is built without the flag
+extern "C" void __sanitizer_cov_trace_pc()
+{
+    g_ops = g_ops + 1;
+}
+
+uint64_t simOps()
+{
+    return g_ops;
+}
+
+const char *simOpsBuild()
+{
+#if defined(__OPTIMIZE_SIZE__)
+#define SIM_OPT "-Os"
+#elif defined(__OPTIMIZE__)
+#define SIM_OPT "-O1+"
+#else
+#define SIM_OPT "-O0"
+#endif
+#if defined(__clang__)
+    return "clang " __clang_version__ " " SIM_OPT;
+#else
+    return "gcc " __VERSION__ " " SIM_OPT;
+#endif
+}
+
+// =================== Clock ===================
+
+uint64_t simMicros()
+{
+    return g_nowUs;
+}
+
+static void wifiTick();
+
+void simAdvanceUs(uint64_t us)
+{
+    uint64_t target = g_nowUs + us;
+    while (g_nowUs < target)
+    {
+        wifiTick();
+        if (simUlpNextUs() <= g_nowUs)
+            simUlpRun();
+
+        // 1 ms steps so hall frequency changes in the trace are picked up
+        uint64_t step = std::min<uint64_t>(std::min<uint64_t>(target, simUlpNextUs()) - g_nowUs, 1000);
+        float hz = g_hallIsr || g_hallCounter || simUlpRunning() ? simTraceAt((uint32_t)(g_nowUs / 1000)).hallHz : 0.0f;
+        if (hz > 0.0f)
+        {
+            double toEdgeUs = (1.0 - g_hallPhase) * 1e6 / hz;
+            if (toEdgeUs <= (double)step)
+            {
+                g_nowUs += std::max<uint64_t>(1, (uint64_t)ceil(toEdgeUs));
+                g_hallPhase = 0.0;
+                g_stats.hallEdges++;
+                if (g_hallCounter)
+                    g_hallCounterEdges++;
+                if (g_hallIsr)
+                {
+                    // Interrupt entry/exit; the handler's own time is not modelled
+                    g_nowUs += g_config.isrEntryUs;
+                    g_stats.hallInterrupts++;
+                    g_hallIsr();
+                }
+                continue;
+            }
+            g_hallPhase += hz * (double)step / 1e6;
+        }
+        g_nowUs += step;
+    }
+}
+
+// =================== Trace ===================
+
+static float lerp(float a, float b, float f)
+{
+    return a + (b - a) * f;
+}
+
+SimTraceRow simTraceAt(uint32_t tMs)
+{
+    if (g_trace.empty())
+    {
+        return SimTraceRow{tMs, 3400.0f, HIGH, 0.0f, 15.0f, 60.0f, 1013.0f, 1};
+    }
+
+    // Lookups cluster around "now", so a cursor beats a binary search
+    if (g_cursor >= g_trace.size())
+        g_cursor = 0;
+    while (g_cursor > 0 && g_trace[g_cursor].tMs > tMs)
+        g_cursor--;
+    while (g_cursor + 1 < g_trace.size() && g_trace[g_cursor + 1].tMs <= tMs)
+        g_cursor++;
+
+    const SimTraceRow &a = g_trace[g_cursor];
+    if (g_cursor + 1 >= g_trace.size() || tMs <= a.tMs)
+        return a;
+
+    const SimTraceRow &b = g_trace[g_cursor + 1];
+    float f = (float)(tMs - a.tMs) / (float)(b.tMs - a.tMs);
+    SimTraceRow r = a;
+    r.tMs = tMs;
+    r.rainRaw = lerp(a.rainRaw, b.rainRaw, f);
+    r.hallHz = lerp(a.hallHz, b.hallHz, f);
+    r.tempC = lerp(a.tempC, b.tempC, f);
+    r.humidity = lerp(a.humidity, b.humidity, f);
+    r.pressureHPa = lerp(a.pressureHPa, b.pressureHPa, f);
+    return r;
+}
+
+uint32_t simTraceEndMs()
+{
+    return g_trace.empty() ? 0 : g_trace.back().tMs;
+}
+
+// CSV: t_ms,rain_raw,rain_d0,hall_hz,temp_c,humidity,pressure_hpa,link
+// Lines that do not start with a digit (header, '#' comments) are skipped.
+bool simLoadTrace(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return false;
+
+    g_trace.clear();
+    g_cursor = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), f))
+    {
+        if (line[0] < '0' || line[0] > '9')
+            continue;
+        SimTraceRow r{};
+        unsigned t, d0, link;
+        if (sscanf(line, "%u,%f,%u,%f,%f,%f,%f,%u", &t, &r.rainRaw, &d0, &r.hallHz,
+                   &r.tempC, &r.humidity, &r.pressureHPa, &link) != 8)
+            continue;
+        r.tMs = t;
+        r.rainD0 = d0 ? HIGH : LOW;
+        r.link = (uint8_t)link;
+        if (!g_trace.empty() && r.tMs <= g_trace.back().tMs)
+            continue; // rows must be strictly increasing in time
+        g_trace.push_back(r);
+    }
+    fclose(f);
+    g_rng = g_config.seed;
+    return !g_trace.empty();
+}
+
+// Rows in time order, as a CSV would give them (benchmarks script their own)
+void simSetTrace(const SimTraceRow *rows, size_t count)
+{
+    g_trace.assign(rows, rows + count);
+    g_cursor = 0;
+    g_rng = g_config.seed;
+}
+
+// A day-in-the-life trace: dry start (the boot calibration needs it),
+// one rain shower, variable wind with gusts, a slow diurnal swing and a
+// network outage. Rows every second; everything in between interpolates.
+void simSyntheticTrace(uint32_t durationMs)
+{
+    g_trace.clear();
+    g_cursor = 0;
+    g_rng = g_config.seed;
+
+    const float dryRaw = 3400.0f, wetRaw = 1700.0f;
+    const uint32_t rainStart = durationMs * 35 / 100, rainEnd = durationMs * 60 / 100;
+    const uint32_t linkDown = durationMs * 70 / 100, linkUp = durationMs * 78 / 100;
+
+    for (uint32_t t = 0; t <= durationMs; t += 1000)
+    {
+        float s = t / 1000.0f;
+        SimTraceRow r{};
+        r.tMs = t;
+
+        // Rain: 60 s wetting ramp, 180 s drying ramp
+        float wet = 0.0f;
+        if (t >= rainStart && t < rainEnd)
+            wet = std::min(1.0f, (t - rainStart) / 60000.0f);
+        else if (t >= rainEnd)
+            wet = std::max(0.0f, 1.0f - (t - rainEnd) / 180000.0f);
+        r.rainRaw = lerp(dryRaw, wetRaw, wet);
+        r.rainD0 = (r.rainRaw < 2800.0f) ? LOW : HIGH;
+
+        // Wind: slow swell plus a 5 s gust every 97 s
+        float hz = 1.5f + 1.2f * sinf(s * 2.0f * (float)M_PI / 300.0f);
+        if ((uint32_t)s % 97 < 5)
+            hz += 3.0f;
+        r.hallHz = std::max(0.0f, hz);
+
+        float day = sinf(s * 2.0f * (float)M_PI / 86400.0f);
+        r.tempC = 12.0f + 4.0f * day - 2.0f * wet;
+        r.humidity = 70.0f - 10.0f * day + 20.0f * wet;
+        r.pressureHPa = 1013.0f - 3.0f * s / 86400.0f;
+
+        r.link = (t >= linkDown && t < linkUp) ? 0 : 1;
+        g_trace.push_back(r);
+    }
+}
+
+// =================== Peripherals ===================
+
+static int noise()
+{
+    if (g_config.adcNoise <= 0)
+        return 0;
+    g_rng = g_rng * 1664525u + 1013904223u;
+    return (int)((g_rng >> 16) % (uint32_t)(2 * g_config.adcNoise + 1)) - g_config.adcNoise;
+}
+
+long simRandom(long howbig)
+{
+    static uint32_t state = 0;
+    if (state == 0)
+        state = g_config.seed * 2654435761u + 1;
+    if (howbig <= 0)
+        return 0;
+    state ^= state << 13; // xorshift32, separate from the ADC noise stream
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (long)(state % (uint32_t)howbig);
+}
+
+int simAdcSample(uint8_t pin, uint32_t tMs)
+{
+    if (pin != RAIN_A0)
+        return 0;
+    int v = (int)lroundf(simTraceAt(tMs).rainRaw) + noise();
+    return constrain(v, 0, 4095);
+}
+
+int simAnalogRead(uint8_t pin)
+{
+    g_stats.adcReads++;
+    if (pin == RAIN_A0)
+        simAdc1Owner(false); // ADC1 (GPIO34)
+    simAdvanceUs(g_config.adcReadUs);
+    return simAdcSample(pin, millis());
+}
+
+int simHallLevel()
+{
+    bool moving = simTraceAt((uint32_t)(g_nowUs / 1000)).hallHz > 0.0f;
+    return moving && g_hallPhase < g_config.hallLowFraction ? LOW : HIGH;
+}
+
+int simDigitalRead(uint8_t pin)
+{
+    if (pin == RAIN_D0)
+        return simTraceAt(millis()).rainD0;
+    if (pin == HALL_PIN)
+        return simHallLevel();
+    return HIGH; // everything else idles high (pull-ups)
+}
+
+void simAttachInterrupt(uint8_t pin, void (*isr)(), int mode)
+{
+    if (pin == HALL_PIN && mode == FALLING)
+        g_hallIsr = isr;
+}
+
+void simDetachInterrupt(uint8_t pin)
+{
+    if (pin == HALL_PIN)
+        g_hallIsr = nullptr;
+}
+
+void simHallCounter(bool on)
+{
+    g_hallCounter = on;
+}
+
+uint32_t simHallCounterEdges()
+{
+    return g_hallCounterEdges;
+}
+
+void simI2cTransfer(uint32_t bytes)
+{
+    uint64_t us = (uint64_t)bytes * g_config.i2cByteUs;
+    g_stats.i2cBytes += bytes;
+    g_stats.i2cUs += us;
+    simAdvanceUs(us);
+}
+
+static uint64_t spiWireUs(uint64_t bytes)
+{
+    g_spiCarryUs += (double)bytes * 8.0 / g_config.spiMHz;
+    uint64_t us = (uint64_t)g_spiCarryUs;
+    g_spiCarryUs -= (double)us;
+    return us;
+}
+
+void simSpiTransfer(uint64_t bytes)
+{
+    simSpiDmaWait();
+    uint64_t us = spiWireUs(bytes);
+    g_stats.spiBytes += bytes;
+    g_stats.spiUs += us;
+    simAdvanceUs(us);
+}
+
+void simSpiDmaStart(uint64_t bytes)
+{
+    g_stats.spiBytes += bytes;
+    g_stats.spiDmaBytes += bytes;
+    g_spiDmaDoneUs = std::max(g_spiDmaDoneUs, g_nowUs) + spiWireUs(bytes);
+}
+
+bool simSpiDmaBusy()
+{
+    return g_nowUs < g_spiDmaDoneUs;
+}
+
+void simSpiDmaWait()
+{
+    if (g_nowUs >= g_spiDmaDoneUs)
+        return;
+    uint64_t us = g_spiDmaDoneUs - g_nowUs;
+    g_stats.spiUs += us;
+    g_stats.spiDmaWaitUs += us;
+    simAdvanceUs(us);
+}
+
+void simSpriteDraw(uint64_t pixels)
+{
+    g_spriteCarryUs += (double)pixels * g_config.spritePixelNs / 1000.0;
+    uint64_t us = (uint64_t)g_spriteCarryUs;
+    g_spriteCarryUs -= (double)us;
+    g_stats.spriteUs += us;
+    simAdvanceUs(us);
+}
+
+bool simHeapAlloc(uint32_t bytes)
+{
+    if (bytes > simHeapMaxBlock())
+        return false;
+    g_stats.heapUsed += bytes;
+    g_heapMinFree = std::min(g_heapMinFree, simHeapFreeBytes());
+    return true;
+}
+
+void simHeapFree(uint32_t bytes)
+{
+    g_stats.heapUsed -= std::min(bytes, g_stats.heapUsed);
+}
+
+uint32_t simHeapFreeBytes()
+{
+    return g_config.heapBytes - std::min(g_stats.heapUsed, g_config.heapBytes);
+}
+
+uint32_t simHeapMinFreeBytes()
+{
+    return std::min(g_heapMinFree, simHeapFreeBytes());
+}
+
+uint32_t simHeapMaxBlock()
+{
+    return std::min(simHeapFreeBytes(), g_config.heapMaxBlock);
+}
+
+void simServoWrite(int angle)
+{
+    g_stats.servoWrites++;
+    g_stats.servoAngle = angle;
+}
+
+void simFlashWrite(uint64_t bytes)
+{
+    g_stats.flashWrites++;
+    g_stats.flashBytes += bytes;
+    g_flashCarryUs += (double)bytes * g_config.flashByteNs / 1000.0;
+    uint64_t us = (uint64_t)g_flashCarryUs;
+    g_flashCarryUs -= (double)us;
+    g_stats.flashUs += us;
+    simAdvanceUs(us);
+}
+
+const char *simFlashDir()
+{
+    return g_flashDir.c_str();
+}
+
+void simSetFlashDir(const char *dir)
+{
+    g_flashDir = dir;
+}
+
+bool simWifiAvailable()
+{
+    return simTraceAt(millis()).link != 0;
+}
+
+bool simBrokerAvailable()
+{
+    return simTraceAt(millis()).link == 1;
+}
+
+// =================== WiFi station ===================
+
+static void wifiFire(arduino_event_id_t event)
+{
+    for (WiFiEventCb cb : g_wifiHandlers)
+        cb(event);
+}
+
+// Advances the station model; runs every simulated millisecond
+static void wifiTick()
+{
+    if (!g_wifiJoining && !g_wifiConnected)
+        return;
+
+    bool ap = simWifiAvailable();
+    if (g_wifiConnected)
+    {
+        if (ap)
+            return;
+        g_wifiConnected = false;
+        g_wifiJoining = g_wifiAutoReconnect;
+        g_wifiJoinUs = g_nowUs;
+        wifiFire(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+        return;
+    }
+
+    if (!ap)
+    {
+        g_wifiApSinceUs = 0;
+        if (g_nowUs - g_wifiJoinUs >= (uint64_t)g_config.wifiNoApMs * 1000)
+        {
+            // Scan found nothing: report it, keep trying only with auto-reconnect
+            g_wifiJoining = g_wifiAutoReconnect;
+            g_wifiJoinUs = g_nowUs;
+            wifiFire(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+        }
+        return;
+    }
+
+    if (g_wifiApSinceUs == 0)
+        g_wifiApSinceUs = std::max(g_nowUs, g_wifiJoinUs);
+    if (g_nowUs - g_wifiApSinceUs >= (uint64_t)g_config.wifiAssocMs * 1000)
+    {
+        g_wifiJoining = false;
+        g_wifiConnected = true;
+        wifiFire(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+        wifiFire(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    }
+}
+
+void simWifiJoin()
+{
+    // A new join restarts association, as on the ESP32
+    g_stats.wifiJoins++;
+    g_wifiConnected = false;
+    g_wifiJoining = true;
+    g_wifiJoinUs = g_nowUs;
+    g_wifiApSinceUs = 0;
+}
+
+void simWifiLeave()
+{
+    bool was = g_wifiConnected;
+    g_wifiJoining = false;
+    g_wifiConnected = false;
+    if (was)
+        wifiFire(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+}
+
+void simWifiSetAutoReconnect(bool on)
+{
+    g_wifiAutoReconnect = on;
+}
+
+bool simWifiAutoReconnect()
+{
+    return g_wifiAutoReconnect;
+}
+
+bool simWifiConnected()
+{
+    wifiTick();
+    return g_wifiConnected;
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *pass)
+{
+    (void)ssid;
+    (void)pass;
+    simWifiJoin();
+    return WL_DISCONNECTED;
+}
+
+wl_status_t WiFiClass::status()
+{
+    return simWifiConnected() ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+bool WiFiClass::disconnect(bool wifiOff)
+{
+    (void)wifiOff;
+    simWifiLeave();
+    return true;
+}
+
+bool WiFiClass::reconnect()
+{
+    simWifiJoin();
+    return true;
+}
+
+bool WiFiClass::setAutoReconnect(bool on)
+{
+    simWifiSetAutoReconnect(on);
+    return true;
+}
+
+bool WiFiClass::getAutoReconnect()
+{
+    return simWifiAutoReconnect();
+}
+
+int WiFiClass::onEvent(WiFiEventCb cb, arduino_event_id_t event)
+{
+    (void)event; // handlers filter on the event id themselves
+    g_wifiHandlers.push_back(cb);
+    return (int)g_wifiHandlers.size();
+}
+
+// =================== SNTP ===================
+
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char *server1, const char *server2,
+                const char *server3)
+{
+    (void)gmtOffset_sec, (void)daylightOffset_sec, (void)server1, (void)server2, (void)server3;
+    g_sntpStarted = true;
+    g_sntpStartUs = g_nowUs;
+}
+
+// Replaces libc time() for the whole program: seconds since boot until
+// SNTP has synced (as on the ESP32), then UTC from SimConfig::epochStart.
+// Keeps timestamps in published payloads deterministic.
+#ifndef __THROW
+#define __THROW
+#endif
+extern "C" time_t time(time_t *t) __THROW
+{
+    if (g_sntpStarted && !g_sntpSynced && g_wifiConnected &&
+        g_nowUs - g_sntpStartUs >= (uint64_t)g_config.sntpSyncMs * 1000)
+        g_sntpSynced = true;
+    time_t v = (time_t)(g_nowUs / 1000000) + (g_sntpSynced ? (time_t)g_config.epochStart : 0);
+    if (t)
+        *t = v;
+    return v;
+}
+
+// =================== Broker ===================
+
+void simMqttSubscribe(const char *topic)
+{
+    g_subscriptions.insert(topic);
+    if (simBridgeActive())
+        simBridgeSubscribe(topic);
+}
+
+void simMqttDisconnect()
+{
+    g_subscriptions.clear();
+}
+
+void simMqttRecordPublish(const char *topic, const uint8_t *payload, unsigned int length)
+{
+    size_t topicLen = strlen(topic);
+    size_t remaining = 2 + topicLen + length;
+    g_stats.publishes++;
+    g_stats.publishBytes += 1 + (remaining > 127 ? 2 : 1) + remaining;
+
+    uint32_t h = g_stats.publishDigest;
+    for (size_t i = 0; i <= topicLen; i++)
+        h = (h ^ (uint8_t)topic[i]) * 16777619u;
+    for (unsigned int i = 0; i < length; i++)
+        h = (h ^ payload[i]) * 16777619u;
+    g_stats.publishDigest = h;
+
+    if (!strcmp(topic, MQTT_TOPIC_BACKLOG))
+    {
+        g_stats.backlogMessages++;
+        for (unsigned int i = 0; i < length; i++)
+            g_stats.backlogSamples += payload[i] == '{';
+    }
+    if (simBridgeActive())
+        simBridgePublish(topic, payload, length);
+}
+
+void simMqttInject(const char *topic, const char *payload, uint32_t atMs)
+{
+    // Keep the queue in delivery order; equal times stay in injection order
+    auto it = g_inbound.end();
+    while (it != g_inbound.begin() && std::prev(it)->atMs > atMs)
+        --it;
+    g_inbound.insert(it, Inbound{topic, payload, atMs});
+}
+
+bool simMqttNextInbound(SimMqttMessage &msg)
+{
+    Inbound in{"", "", 0};
+    while (simBridgeActive() && simBridgePoll(in.topic, in.payload))
+        simMqttInject(in.topic.c_str(), in.payload.c_str(), millis());
+    while (!g_inbound.empty() && g_inbound.front().atMs <= millis())
+    {
+        g_delivering = g_inbound.front();
+        g_inbound.pop_front();
+        if (g_subscriptions.count(g_delivering.topic) == 0)
+            continue;
+        msg.topic = g_delivering.topic.c_str();
+        msg.payload = (const uint8_t *)g_delivering.payload.data();
+        msg.length = (unsigned int)g_delivering.payload.size();
+        return true;
+    }
+    return false;
+}
+
+void simRestart()
+{
+    g_restart = true;
+}
+
+bool simRestartRequested()
+{
+    return g_restart;
+}
+
+// =================== Serial ===================
+
+void simSetQuiet(bool quiet)
+{
+    g_quiet = quiet;
+}
+
+bool simQuiet()
+{
+    return g_quiet;
+}
+
+// The FIFO drains at baud/10 bytes per second; a write that does not fit
+// blocks until enough has gone out, as uart_write_bytes() does without a
+// TX ring buffer.
+static void uartTx(size_t bytes)
+{
+    double bytesPerUs = g_config.uartBaud / 10.0 / 1e6;
+    g_uartFifo = std::max(0.0, g_uartFifo - (double)(g_nowUs - g_uartLastUs) * bytesPerUs);
+    g_uartLastUs = g_nowUs;
+    g_stats.serialBytes += bytes;
+
+    double over = g_uartFifo + (double)bytes - g_config.uartFifo;
+    if (over > 0)
+    {
+        uint64_t us = (uint64_t)ceil(over / bytesPerUs);
+        g_stats.serialUs += us;
+        simAdvanceUs(us);
+        g_uartLastUs = g_nowUs;
+        g_uartFifo = g_config.uartFifo;
+    }
+    else
+    {
+        g_uartFifo += (double)bytes;
+    }
+}
+
+void simSerialFlush()
+{
+    uartTx(0);
+    uint64_t us = (uint64_t)ceil(g_uartFifo * 10.0 * 1e6 / g_config.uartBaud);
+    g_stats.serialUs += us;
+    simAdvanceUs(us);
+    g_uartFifo = 0.0;
+    g_uartLastUs = g_nowUs;
+}
+
+int HardwareSerial::printf(const char *fmt, ...)
+{
+    char buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n < 0)
+        return n;
+    if ((size_t)n >= sizeof(buf))
+    {
+        std::string big((size_t)n + 1, '\0');
+        va_start(ap, fmt);
+        vsnprintf(&big[0], big.size(), fmt, ap);
+        va_end(ap);
+        write(big.c_str());
+        return n;
+    }
+    write(buf);
+    return n;
+}
+
+void HardwareSerial::write(const char *s)
+{
+    uartTx(strlen(s));
+    if (!g_quiet)
+        fputs(s, stdout);
+}
@@ -0,0 +1,247 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Host-side hardware model behind the Arduino stand-in headers in this
+// library. Everything runs on a virtual clock: delay() and bus transfers
+// advance it instantly, so a trace replays far faster than real time and
+// every run with the same trace/seed is bit-for-bit identical.
+
+// One trace row; analog values are interpolated, digital ones held
+struct SimTraceRow
+{
+    uint32_t tMs;
+    float rainRaw;     // ADC counts on RAIN_A0
+    uint8_t rainD0;    // level on RAIN_D0
+    float hallHz;      // falling edges per second on HALL_PIN
+    float tempC;       // BME280 temperature
+    float humidity;    // BME280 relative humidity (%)
+    float pressureHPa; // BME280 pressure
+    uint8_t link;      // 0 = no AP, 1 = AP + broker, 2 = AP but broker unreachable
+};
+
+// Bus/latency model (defaults roughly match the lolin32 build)
+struct SimConfig
+{
+    uint32_t seed = 1;
+    int adcNoise = 6;                // +/- counts of noise on every analogRead
+    uint32_t adcReadUs = 10;         // cost of one analogRead
+    uint32_t isrEntryUs = 2;         // GPIO interrupt dispatch (entry + exit) per edge
+    uint32_t i2cByteUs = 90;         // 100 kHz, 9 bits per byte
+    float spiMHz = 27.0f;            // SPI_FREQUENCY
+    uint32_t spritePixelNs = 25;     // CPU time per pixel drawn into a sprite
+    uint32_t heapBytes = 180000;     // free heap once setup() starts drawing
+    uint32_t heapMaxBlock = 113792;  // largest contiguous block (ESP.getMaxAllocHeap)
+    uint32_t wifiAssocMs = 1500;     // join request until GOT_IP
+    uint32_t wifiNoApMs = 3000;      // join request until DISCONNECTED when no AP
+    uint32_t wifiSleepDropMs = 3000; // light sleep with the station associated: the AP drops it after this long
+    uint32_t tcpConnectMs = 35;      // TCP handshake to the broker
+    uint32_t mqttConnackMs = 5;      // CONNECT → CONNACK round trip
+    uint32_t mqttSegmentGapMs = 0;   // inbound PUBLISH split in two TCP segments this far apart; 0 = whole
+    uint32_t mqttConnectFailMs = 3000; // TCP connect timeout, AP up but broker down
+    uint32_t mqttPublishUs = 300;    // synchronous socket write per publish
+    uint32_t uplinkBytesPerSec = 0;  // broker acknowledges this fast; 0 = unlimited
+    uint32_t tcpSendBuf = 5744;      // lwIP TCP_SND_BUF (4 MSS): a write blocks when it is full
+    uint32_t tlsVerifyMs = 600;      // full TLS handshake: broker chain, RSA-2048 signature checks
+    uint32_t tlsKeyExchangeMs = 800; // full TLS handshake: ECDHE P-256 key pair and shared secret
+    uint32_t tlsResumeUs = 3000;     // resumed TLS handshake: key derivation and Finished MACs
+    uint32_t tlsTicketLifetimeS = 300; // broker accepts a ticket this long (OpenSSL default); 0 = never resumes
+    bool tlsWrongCa = false;         // broker certificate chains to a CA other than MQTT_CA_PEM
+    uint8_t bmeAddress = 0x76;       // address the simulated BME280 answers on
+    bool bmePresent = true;
+    uint32_t flashByteNs = 2500;     // LittleFS write incl. amortised erase (~400 KB/s)
+    uint32_t epochStart = 1767225600; // UTC at simulated boot (2026-01-01)
+    uint32_t sntpSyncMs = 200;       // configTime() with WiFi up until time() is valid
+    uint32_t uartBaud = 115200;      // Serial.begin() overrides; 10 bits per byte
+    uint32_t uartFifo = 128;         // bytes; arduino-esp32 has no TX ring buffer by default
+    float hallLowFraction = 0.15f;   // HALL_PIN low for this part of each period (magnet passing)
+    uint32_t ulpInstrNs = 750;       // ULP FSM at 8 MHz, ~6 cycles per instruction
+    uint32_t ulpAdcUs = 45;          // one I_ADC conversion
+    float awakeMa = 70.0f;           // modelled supply current, cores at 240 MHz with WiFi
+    float lightSleepMa = 0.8f;       // light sleep, RTC domain on
+    float ulpMa = 1.4f;              // extra while the ULP executes
+};
+
+struct SimStats
+{
+    uint32_t loops = 0;
+    uint32_t hallEdges = 0;
+    uint32_t hallInterrupts = 0; // edges delivered to an attached ISR
+    uint32_t adcReads = 0;
+    uint64_t adcDmaSamples = 0; // continuous-mode samples handed to the sketch
+    uint64_t adcDmaDropped = 0; // lost to full DMA buffers
+    uint32_t servoWrites = 0;
+    int servoAngle = 0;
+    uint32_t i2cBytes = 0;
+    uint64_t i2cUs = 0;
+    uint32_t tftCalls = 0;
+    uint64_t spiBytes = 0;
+    uint64_t spiUs = 0;          // CPU blocked on SPI (transfers plus waits for DMA)
+    uint64_t spiDmaBytes = 0;    // sent by DMA behind the CPU
+    uint64_t spiDmaWaitUs = 0;   // part of spiUs spent waiting for a DMA transfer
+    uint64_t spriteUs = 0;       // CPU drawing into sprites
+    uint32_t heapUsed = 0;
+    uint32_t mqttConnects = 0;
+    uint32_t mqttConnectFails = 0;
+    uint32_t publishes = 0;
+    uint64_t publishBytes = 0;
+    uint32_t publishDigest = 2166136261u; // FNV-1a over every topic/payload published
+    uint64_t sendBlockedUs = 0;           // socket writes waiting for send-buffer space
+    uint64_t sendBlockedMaxUs = 0;        // longest single wait
+    uint64_t connectUs = 0;               // TCP connect start to CONNACK, summed over connects
+    uint64_t connectMaxUs = 0;
+    uint64_t mqttLoopBlockedUs = 0;       // mqtt.loop() waiting for the rest of a packet
+    uint64_t mqttLoopBlockedMaxUs = 0;    // longest single wait
+    uint32_t tlsFull = 0;
+    uint32_t tlsResumed = 0;
+    uint32_t tlsFailed = 0;
+    uint64_t tlsFullUs = 0;    // handshake time, ClientHello to the broker's Finished
+    uint64_t tlsResumedUs = 0;
+    uint64_t tlsCpuUs = 0;     // handshake crypto on the station
+    uint64_t delayUs = 0;                 // time spent inside delay()/delayMicroseconds()
+    uint32_t flashWrites = 0;
+    uint64_t flashBytes = 0;
+    uint64_t flashUs = 0;
+    uint64_t serialBytes = 0;
+    uint64_t serialUs = 0;        // time Serial writes blocked on a full UART FIFO
+    uint32_t backlogMessages = 0; // publishes on MQTT_TOPIC_BACKLOG
+    uint32_t backlogSamples = 0;  // JSON objects inside them
+    uint32_t sleeps = 0;          // esp_light_sleep_start() calls
+    uint32_t timerWakes = 0;
+    uint32_t ulpWakes = 0;
+    uint64_t sleepUs = 0;
+    uint32_t ulpRuns = 0;
+    uint64_t ulpBusyNs = 0;       // ULP executing (instructions and conversions)
+    uint32_t adcConflicts = 0;    // ULP conversions while the cores held ADC1 (analogRead since adc1_ulp_enable)
+    uint32_t wifiJoins = 0;       // join requests (begin/reconnect)
+    uint32_t wifiSleepDrops = 0;  // associations lost to a light sleep
+};
+
+SimConfig &simConfig();
+SimStats &simStats();
+
+// ---- Operation count ----
+// Basic blocks executed in sketch code: the native envs build src/ with
+// -fsanitize-coverage=trace-pc, which calls into sim.cpp on every block.
+// Deterministic for a given compiler and optimisation level; 0 without the flag.
+uint64_t simOps();
+const char *simOpsBuild(); // compiler and optimisation level the count depends on
+
+// ---- Virtual clock ----
+uint64_t simMicros();
+void simAdvanceUs(uint64_t us); // fires hall edges that fall inside the step
+
+// ---- Trace ----
+bool simLoadTrace(const char *path);
+void simSyntheticTrace(uint32_t durationMs);
+void simSetTrace(const SimTraceRow *rows, size_t count);
+uint32_t simTraceEndMs();
+SimTraceRow simTraceAt(uint32_t tMs);
+
+// ---- Peripherals (used by the stand-in headers) ----
+int simAnalogRead(uint8_t pin);
+void simAdc1Owner(bool ulp); // adc1_ulp_enable() hands ADC1 to the ULP, analogRead() takes it back
+int simAdcSample(uint8_t pin, uint32_t tMs); // one noisy conversion, no time charged (DMA)
+int simDigitalRead(uint8_t pin);
+void simAttachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void simDetachInterrupt(uint8_t pin);
+void simHallCounter(bool on);   // PCNT stand-in: count HALL_PIN edges without an ISR
+uint32_t simHallCounterEdges(); // edges seen while counting
+void simI2cTransfer(uint32_t bytes);
+void simSpiTransfer(uint64_t bytes);   // blocking; waits for a running DMA transfer first
+void simSpiDmaStart(uint64_t bytes);   // queued behind a running one; the clock does not move
+bool simSpiDmaBusy();
+void simSpiDmaWait();
+void simSpriteDraw(uint64_t pixels);   // CPU cost of rendering off-screen
+bool simHeapAlloc(uint32_t bytes);     // false if it does not fit (free heap or largest block)
+void simHeapFree(uint32_t bytes);
+uint32_t simHeapFreeBytes();
+uint32_t simHeapMaxBlock();
+uint32_t simHeapMinFreeBytes(); // low-water mark since boot
+
+int simHallLevel(); // HALL_PIN: low for hallLowFraction of each period after the falling edge
+
+// ---- ULP coprocessor and light sleep (sim_ulp.cpp) ----
+bool simUlpRunning();
+uint64_t simUlpNextUs(); // next program run; simAdvanceUs() stops there
+void simUlpRun();        // run the program once at the current time
+
+#define SIM_CPU_MHZ 240 // ESP.getCycleCount() rate
+void simServoWrite(int angle);
+void simFlashWrite(uint64_t bytes); // LittleFS stand-in: counts and charges a write
+const char *simFlashDir();
+void simSetFlashDir(const char *dir);
+long simRandom(long howbig); // Arduino random(); deterministic per seed
+bool simWifiAvailable();   // trace: an AP is in range
+bool simBrokerAvailable(); // trace: the broker answers
+
+// ---- WiFi station model (events fire from simAdvanceUs, like the event task) ----
+void simWifiJoin();
+void simWifiLeave();
+void simWifiSetAutoReconnect(bool on);
+bool simWifiAutoReconnect();
+bool simWifiConnected();
+
+// ---- Socket model (lwip_* stand-ins and WiFiClient) ----
+int simSocketOpen();              // new unconnected socket, -1 if the table is full
+bool simSocketStartConnect(int fd); // non-blocking connect; false if the fd is bad
+int simSocketConnectResult(int fd); // 1 connected, 0 in progress, -errno failed
+bool simSocketConnected(int fd);  // established and the path is still up
+void simSocketClose(int fd);
+void simSocketSend(int fd, uint32_t bytes); // blocks until the send buffer has room (uplinkBytesPerSec)
+bool simSocketWritable(int fd);             // select() writability: established, send buffer below half
+// Inbound bytes: the CONNACK, then the broker model's messages for the
+// session as PUBLISH packets (outbound publishes are only charged)
+void simSocketMqttConnect(int fd, uint32_t bytes); // CONNECT sent: the CONNACK is readable mqttConnackMs later
+void simSocketMqttOnline(int fd);                  // CONNACK accepted: inbound messages go to fd
+int simSocketAvailable(int fd);                    // bytes readable now
+int simSocketRead(int fd, uint8_t *buf, size_t len);
+
+// ---- TLS model (mbedTLS stand-ins, sim_tls.cpp) ----
+uint32_t simTlsRecordOverhead(int fd); // bytes added per record once fd carries a TLS session, else 0
+
+// ---- Broker model ----
+struct SimMqttMessage
+{
+    const char *topic;
+    const uint8_t *payload;
+    unsigned int length;
+};
+void simMqttSubscribe(const char *topic);
+void simMqttDisconnect(); // drops subscriptions, like a clean session
+void simMqttRecordPublish(const char *topic, const uint8_t *payload, unsigned int length);
+void simMqttInject(const char *topic, const char *payload, uint32_t atMs = 0); // delivered by mqtt.loop() from atMs on
+bool simMqttNextInbound(SimMqttMessage &msg);               // subscribed topics only; valid until the next call
+
+// ---- Bridge to a real broker (e.g. a local mosquitto) ----
+// Mirrors what the model delivers: every publish is forwarded, every
+// subscription is mirrored and inbound messages join the model's queue.
+// The simulated link state still decides when the station is online.
+bool simBridgeOpen(const char *hostPort); // "host[:port]", blocking CONNECT/CONNACK
+bool simBridgeActive();
+void simBridgePublish(const char *topic, const uint8_t *payload, unsigned int length);
+void simBridgeSubscribe(const char *topic);
+bool simBridgePoll(std::string &topic, std::string &payload); // non-blocking, one message
+
+// ---- ESP.restart() ends the run ----
+void simRestart();
+bool simRestartRequested();
+
+// ---- Self-checks (sim_main command-line modes) ----
+int simRingStress(uint32_t count); // SpscRing with real producer/consumer threads; 0 = pass
+int simBenchPublish(uint32_t cycles); // mqttPublishData cost per payload format
+int simBenchRain(uint32_t updates);   // rain pipeline: bit-exact check and cost per update
+// Sensor, publish and UI paths against a stored baseline; non-zero if a
+// metric grew by more than tolerancePct (host time only with gateHost).
+// update = rewrite the baseline instead of checking it.
+int simBenchSuite(const char *baselinePath, bool update, double tolerancePct, bool gateHost);
+
+// ---- Serial (charged against the UART model even when quiet) ----
+void simSetQuiet(bool quiet);
+bool simQuiet();
+void simSerialFlush(); // Serial.flush(): wait until the UART FIFO is empty
+
+#endif // SIM_H
@@ -0,0 +1,586 @@
+// --bench-publish: cost of one mqttPublishData() cycle per payload format and policy
+// --bench-rain: integer rain pipeline against a floating-point model
+// --bench-suite: per-call cost of the sensor, publish and UI paths against a
+//                stored baseline (the regression gate)
+
+#include "sim.h"
+#include "config.h"
+
+// Sketch modules (the native env has src/ on the include path)
+#include "acquisition.h"
+#include "history.h"
+#include "mqtt_client.h"
+#include "publish_policy.h"
+#include "rain_sensor.h"
+#include "ui.h"
+#include "wind_sensor.h"
+
+#include <rain_filter.h>
+
+#include <math.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#endif
+
+// Sketch entry points and hardware instances (main.cpp)
+void setup();
+void loop();
+extern TFT_eSPI tft;
+extern Servo servo;
+
+static const uint32_t TCP_IP_OVERHEAD = 40; // IPv4 + TCP headers per segment (one per publish)
+
+int simBenchPublish(uint32_t cycles)
+{
+    static const struct
+    {
+        const char *name;
+        uint8_t format;
+        uint8_t policy;
+    } formats[] = {{"legacy", PAYLOAD_LEGACY, PUBLISH_EVERY},
+                   {"json", PAYLOAD_JSON, PUBLISH_EVERY},
+                   {"msgpack", PAYLOAD_MSGPACK, PUBLISH_EVERY},
+                   {"legacy/change", PAYLOAD_LEGACY, PUBLISH_ON_CHANGE},
+                   {"json/change", PAYLOAD_JSON, PUBLISH_ON_CHANGE},
+                   {"msgpack/change", PAYLOAD_MSGPACK, PUBLISH_ON_CHANGE}};
+
+    // No trace: the link stays up and the sensors hold steady
+    simSetQuiet(true);
+    setup();
+    while (!mqttIsConnected() && simMicros() < 60000000ull)
+    {
+        loop();
+        simAdvanceUs(1000);
+    }
+    if (!mqttIsConnected() || cycles == 0)
+    {
+        fprintf(stderr, "bench: no MQTT session\n");
+        return 1;
+    }
+    simAdvanceUs(1000000); // let the connect log drain out of the UART
+
+    printf("mqttPublishData, %u cycles per format (time on the virtual clock: queueing + UART;\n"
+           "drain: the mqttMaintain() call that writes the queue to the socket)\n", cycles);
+    printf("%-15s %8s %10s %10s %10s %10s %10s %10s %10s\n", "format", "msgs", "mqtt B", "wire B", "serial B",
+           "mean us", "max us", "drain us", "host ns");
+    for (const auto &f : formats)
+    {
+        mqttSetPayloadFormat(f.format);
+        mqttSetPublishPolicy(f.policy);
+        policyReset();
+        SimStats before = simStats();
+        uint64_t totalUs = 0, maxUs = 0, drainUs = 0;
+        double hostNs = 0;
+        for (uint32_t i = 0; i < cycles; i++)
+        {
+            float wind = 2.0f + (float)(i % 50) * 0.13f;
+            uint64_t t0 = simMicros();
+            auto w0 = std::chrono::steady_clock::now();
+            mqttPublishData(wind, i % 7 == 0, 12.5f + (float)(i % 30) * 0.1f, 65.2f, 1012.8f, (i % 7 == 0) ? 90 : 0);
+            hostNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - w0).count();
+            uint64_t us = simMicros() - t0;
+            totalUs += us;
+            maxUs = std::max(maxUs, us);
+            t0 = simMicros();
+            mqttMaintain();
+            drainUs += simMicros() - t0;
+            simAdvanceUs((uint64_t)PUBLISH_INTERVAL * 1000); // UART drains between cycles
+        }
+        const SimStats &after = simStats();
+        double msgs = (double)(after.publishes - before.publishes) / cycles;
+        double mqttBytes = (double)(after.publishBytes - before.publishBytes) / cycles;
+        printf("%-15s %8.1f %10.1f %10.1f %10.1f %10.1f %10llu %10.1f %10.0f\n", f.name, msgs, mqttBytes,
+               mqttBytes + msgs * TCP_IP_OVERHEAD, (double)(after.serialBytes - before.serialBytes) / cycles,
+               (double)totalUs / cycles, (unsigned long long)maxUs, (double)drainUs / cycles, hostNs / cycles);
+    }
+    return 0;
+}
+
+// ---- --bench-rain ----
+
+// The same steps as rainFilterStep() in double precision: every operand is
+// an integer below 2^53, so floor() reproduces the integer truncation and
+// shifts exactly and the two must agree bit for bit
+struct RainModel
+{
+    double dry, wet, pct;
+};
+
+static bool modelStep(RainModel &m, double raw, bool hwWet, const RainTuning &t)
+{
+    bool wetNow = hwWet || raw + t.triggerDrop < m.dry;
+    if (wetNow)
+    {
+        if (raw < m.wet)
+            m.wet = raw;
+    }
+    else
+    {
+        m.wet += floor(std::max(m.dry - m.wet, 0.0) / 300);
+    }
+    if (!wetNow && raw > std::max(m.dry - t.dryHyst, 0.0) && raw > m.dry)
+        m.dry = floor((199 * m.dry + raw) / 200);
+
+    double denom = std::max(std::max(m.dry - m.wet, 0.0), (double)t.minDenom);
+    double target = std::min(floor(std::max(m.dry - raw, 0.0) * RAIN_PCT_ONE / denom), (double)RAIN_PCT_ONE);
+    double ease = wetNow ? t.easeWetQ8 : t.easeDryQ8;
+    m.pct += floor((target - m.pct) * ease / 256);
+    return wetNow;
+}
+
+// The float pipeline rainSensorUpdate() had before, for the cost and the
+// quantisation difference (not expected to match)
+struct RainLegacy
+{
+    uint16_t dry, wet;
+    float pct;
+};
+
+static bool legacyStep(RainLegacy &l, uint16_t raw, bool hwWet)
+{
+    bool wetNow = hwWet || raw + TRIGGER_DROP < l.dry;
+    if (wetNow)
+    {
+        if (raw < l.wet)
+            l.wet = raw;
+    }
+    else
+    {
+        l.wet = (uint16_t)(l.wet + (l.dry - l.wet) / 300);
+    }
+    if (!wetNow && raw > (uint16_t)(l.dry - DRY_HYST) && raw > l.dry)
+        l.dry = (uint16_t)((199 * l.dry + raw) / 200);
+    int denom = (int)l.dry - (int)l.wet;
+    if (denom < MIN_DENOM)
+        denom = MIN_DENOM;
+    float target = 100.0f * (float)(l.dry - raw) / (float)denom;
+    target = std::min(std::max(target, 0.0f), 100.0f);
+    l.pct += (target - l.pct) * (wetNow ? 0.65f : 0.25f); // PCT_EASE_WET/DRY as they were
+    return wetNow;
+}
+
+struct RainInput
+{
+    uint16_t raw;
+    bool hwWet;
+    int32_t recal; // >= 0: reset the references to this dry value first
+};
+
+// Dry spells with noise and drift, showers of varying depth, rail-to-rail
+// spikes and the occasional recalibration (including tiny dry references)
+static std::vector<RainInput> rainInputs(uint32_t n)
+{
+    std::vector<RainInput> in(n);
+    uint32_t rng = 12345;
+    auto next = [&rng](uint32_t mod) {
+        rng = rng * 1664525u + 1013904223u;
+        return (rng >> 8) % mod;
+    };
+    int32_t level = 3300, target = 3300;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        if (next(400) == 0)
+            target = next(5) == 0 ? (int32_t)next(4096) : 3000 + (int32_t)next(800);
+        level += (target - level) / 16;
+        int32_t raw = level + (int32_t)next(41) - 20;
+        uint32_t spike = next(1000);
+        if (spike == 0)
+            raw = 4095;
+        else if (spike == 1)
+            raw = 0;
+        in[i].raw = (uint16_t)std::min(std::max(raw, 0), 4095);
+        in[i].hwWet = target < 2800 && next(4) != 0;
+        uint32_t cal = next(5000);
+        in[i].recal = cal == 0 ? (int32_t)next(120) : cal == 1 ? (int32_t)(3000 + next(1000)) : -1;
+    }
+    return in;
+}
+
+static inline uint64_t benchTicks()
+{
+#ifdef BENCH_HAVE_TSC
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+int simBenchRain(uint32_t updates)
+{
+    if (updates == 0)
+        return 2;
+    std::vector<RainInput> in = rainInputs(updates);
+
+    // Bit-exactness, step by step
+    RainFilter f = {0, 0, 0};
+    RainModel m = {0, 0, 0};
+    RainLegacy l = {0, 0, 0};
+    const RainTuning &tune = RAIN_TUNING_DEFAULT;
+    rainFilterReset(f, 3300, tune);
+    m = {(double)f.dryRef, (double)f.wetRef, 0};
+    l = {f.dryRef, f.wetRef, 0};
+    uint32_t mismatches = 0, firstMismatch = 0, legacyDiverged = 0;
+    double maxDiffPct = 0;
+    for (uint32_t i = 0; i < updates; i++)
+    {
+        const RainInput &x = in[i];
+        if (x.recal >= 0)
+        {
+            rainFilterReset(f, (uint16_t)x.recal, tune);
+            m.dry = f.dryRef;
+            m.wet = f.wetRef;
+        }
+        l = {f.dryRef, f.wetRef, f.pctQ8 / 256.0f}; // one step of each from the same state
+        bool wf = rainFilterStep(f, x.raw, x.hwWet, tune);
+        bool wm = modelStep(m, x.raw, x.hwWet, tune);
+        legacyStep(l, x.raw, x.hwWet);
+        if (wf != wm || f.dryRef != m.dry || f.wetRef != m.wet || f.pctQ8 != m.pct)
+        {
+            if (mismatches++ == 0)
+                firstMismatch = i;
+        }
+        if (l.dry == f.dryRef && l.wet == f.wetRef)
+            maxDiffPct = std::max(maxDiffPct, fabs(f.pctQ8 / 256.0 - l.pct));
+        else
+            legacyDiverged++; // the old arithmetic wrapped or went negative
+    }
+
+    // Cost per update, inputs already in memory, best of five passes
+    auto timeIt = [&](auto step) {
+        uint64_t best = UINT64_MAX;
+        for (int pass = 0; pass < 5; pass++)
+        {
+            uint64_t t0 = benchTicks();
+            for (uint32_t i = 0; i < updates; i++)
+                step(in[i]);
+            best = std::min(best, benchTicks() - t0);
+        }
+        return (double)best / updates;
+    };
+    RainFilter tf = f;
+    RainModel tm = m;
+    RainLegacy tl = l;
+    volatile int32_t sink = 0;
+    double fixedT = timeIt([&](const RainInput &x) { sink = sink + rainFilterStep(tf, x.raw, x.hwWet, tune); });
+    double modelT = timeIt([&](const RainInput &x) { sink = sink + modelStep(tm, x.raw, x.hwWet, tune); });
+    double legacyT = timeIt([&](const RainInput &x) { sink = sink + legacyStep(tl, x.raw, x.hwWet); });
+
+#ifdef BENCH_HAVE_TSC
+    const char *unit = "TSC cycles";
+#else
+    const char *unit = "ns";
+#endif
+    printf("rain pipeline, %u updates\n", updates);
+    printf("bit-exact vs double model  %s (%u mismatching updates", mismatches ? "FAIL" : "pass", mismatches);
+    if (mismatches)
+        printf(", first at %u", firstMismatch);
+    printf(")\n");
+    printf("vs previous float pipeline  one update from the same state: max wetness difference %.3f %%,\n"
+           "                            references differ after %u updates (old unsaturated arithmetic)\n",
+           maxDiffPct, legacyDiverged);
+    printf("%-22s %10s\n", "path", unit);
+    printf("%-22s %10.1f\n", "fixed (Q7.8)", fixedT);
+    printf("%-22s %10.1f\n", "double model", modelT);
+    printf("%-22s %10.1f\n", "float (previous)", legacyT);
+    return mismatches ? 1 : 0;
+}
+
+// ---- --bench-suite ----
+
+// What one call cost on the virtual clock, the buses and the CPU (ops:
+// basic blocks of sketch code, see simOps()), summed over calls. Time
+// between calls (simAdvanceUs) is not part of any case.
+enum BenchCounter
+{
+    BC_OPS,
+    BC_SIM_US,
+    BC_SPI_B, // blocking and DMA
+    BC_I2C_B,
+    BC_SERIAL_B,
+    BC_MQTT_B,
+    BC_PUBLISHES,
+    BC_TFT_CALLS,
+    BC_ADC_READS,
+    BC_SERVO_WRITES,
+    BC_COUNTERS
+};
+
+static const char *const COUNTER_NAMES[BC_COUNTERS] = {"ops",       "sim_us",    "spi_B",     "i2c_B",
+                                                       "serial_B",  "mqtt_B",    "publishes", "tft_calls",
+                                                       "adc_reads", "servo_writes"};
+
+struct BenchCase
+{
+    const char *name;
+    uint32_t calls;
+    uint64_t sum[BC_COUNTERS];
+    double hostNs;
+};
+
+static void benchCounters(uint64_t *v)
+{
+    const SimStats &st = simStats();
+    v[BC_OPS] = simOps();
+    v[BC_SIM_US] = simMicros();
+    v[BC_SPI_B] = st.spiBytes + st.spiDmaBytes;
+    v[BC_I2C_B] = st.i2cBytes;
+    v[BC_SERIAL_B] = st.serialBytes;
+    v[BC_MQTT_B] = st.publishBytes;
+    v[BC_PUBLISHES] = st.publishes;
+    v[BC_TFT_CALLS] = st.tftCalls;
+    v[BC_ADC_READS] = st.adcReads;
+    v[BC_SERVO_WRITES] = st.servoWrites;
+}
+
+template <typename F>
+static void benchCall(BenchCase &c, F fn)
+{
+    uint64_t a[BC_COUNTERS], b[BC_COUNTERS];
+    benchCounters(a);
+    auto w0 = std::chrono::steady_clock::now();
+    fn();
+    c.hostNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - w0).count();
+    benchCounters(b);
+    for (int i = 0; i < BC_COUNTERS; i++)
+        c.sum[i] += b[i] - a[i];
+    c.calls++;
+}
+
+// Dry start for the boot calibration, wind picking up to gusts, a shower
+// that trips the servo and dries off again, slow temperature and pressure
+// drift; the link stays up throughout
+static const SimTraceRow SUITE_TRACE[] = {
+    {0, 3400, HIGH, 0, 14.0f, 70, 1013.0f, 1},      {60000, 3400, HIGH, 3, 14.2f, 70, 1012.8f, 1},
+    {240000, 3380, HIGH, 12, 14.5f, 72, 1012.5f, 1}, {300000, 3400, HIGH, 8, 14.0f, 75, 1012.0f, 1},
+    {360000, 1800, LOW, 6, 13.0f, 90, 1011.0f, 1},   {600000, 1750, LOW, 9, 12.5f, 94, 1010.5f, 1},
+    {780000, 3400, HIGH, 4, 13.5f, 85, 1010.0f, 1},  {900000, 3400, HIGH, 2, 16.0f, 70, 1010.0f, 1},
+    {86400000, 3400, HIGH, 2, 16.0f, 70, 1010.0f, 1},
+};
+
+static const uint32_t SUITE_SENSOR_CALLS = 11250; // 15 min of LOGIC_PERIOD_MS ticks
+static const uint32_t SUITE_PUBLISH_CALLS = 300;
+static const uint32_t SUITE_UI_INITS = 10;
+static const uint32_t SUITE_UI_FRAMES = 15000; // 20 min: a dozen chart points
+
+static std::vector<BenchCase> runSuite()
+{
+    std::vector<BenchCase> cases;
+    auto add = [&cases](const char *name) -> BenchCase & {
+        cases.push_back(BenchCase{name, 0, {}, 0});
+        return cases.back();
+    };
+
+    // Sensors at the acquisition cadence, through the scripted weather
+    size_t rain = cases.size();
+    add("rain.update");
+    size_t wind = cases.size();
+    add("wind.read");
+    for (uint32_t i = 0; i < SUITE_SENSOR_CALLS; i++)
+    {
+        benchCall(cases[rain], [] { rainSensorUpdate(servo); });
+        benchCall(cases[wind], [] { readWind(); });
+        simAdvanceUs((uint64_t)LOGIC_PERIOD_MS * 1000);
+    }
+
+    static const struct
+    {
+        const char *name;
+        uint8_t format;
+        uint8_t policy;
+    } formats[] = {{"publish.legacy", PAYLOAD_LEGACY, PUBLISH_EVERY},
+                   {"publish.json", PAYLOAD_JSON, PUBLISH_EVERY},
+                   {"publish.msgpack", PAYLOAD_MSGPACK, PUBLISH_EVERY},
+                   {"publish.change", PAYLOAD_LEGACY, PUBLISH_ON_CHANGE}};
+    for (const auto &f : formats)
+    {
+        mqttSetPayloadFormat(f.format);
+        mqttSetPublishPolicy(f.policy);
+        policyReset();
+        BenchCase &c = add(f.name);
+        for (uint32_t i = 0; i < SUITE_PUBLISH_CALLS; i++)
+        {
+            float wind = 2.0f + (float)(i % 50) * 0.13f;
+            bool wet = i % 7 == 0;
+            // One whole cycle: queue the messages, then write them out
+            benchCall(c, [&] {
+                mqttPublishData(wind, wet, 12.5f + (float)(i % 30) * 0.1f, 65.2f, 1012.8f, wet ? 90 : 0);
+                mqttMaintain();
+            });
+            simAdvanceUs(1000000); // the UART drains between cycles
+        }
+    }
+    mqttSetPayloadFormat(MQTT_PAYLOAD_FORMAT);
+    mqttSetPublishPolicy(MQTT_PUBLISH_POLICY);
+
+    // Layout, frames and surfaces from scratch (what a rotation change costs)
+    BenchCase &init = add("ui.init");
+    for (uint32_t i = 0; i < SUITE_UI_INITS; i++)
+    {
+        benchCall(init, [] { uiInit(tft); });
+        simAdvanceUs(100000);
+    }
+
+    // Card, pill, chip and chart updates at the UI cadence; the history
+    // is fed outside the timed call, as onSample() does
+    BenchCase &ui = add("ui.update");
+    for (uint32_t i = 0; i < SUITE_UI_FRAMES; i++)
+    {
+        float t = (float)i;
+        bool dry = (i / 1500) % 3 != 2;
+        float wetness = dry ? 0.0f : std::min(100.0f, (float)(i % 1500) * 0.2f);
+        float windMs = std::max(0.0f, 3.0f + 2.5f * sinf(t / 40.0f) + ((i / 7) % 5) * 0.1f);
+        float tempC = 14.0f + 2.0f * sinf(t / 3000.0f);
+        float humidity = 70.0f - 10.0f * sinf(t / 2500.0f);
+        float pressure = 1012.0f - t / 4000.0f;
+
+        SensorSample s{millis(), i, !dry, wetness, 0, windMs, windMs, windMs, windMs, windMs, tempC, humidity, pressure};
+        historyAdd(s);
+        benchCall(ui, [&] { uiUpdate(tft, dry, wetness, windMs, tempC, humidity, pressure); });
+        simAdvanceUs((uint64_t)LOGIC_PERIOD_MS * 1000);
+    }
+    tft.dmaWait();
+    return cases;
+}
+
+static const char OPS_BUILD_TAG[] = "# ops build: ";
+
+// "case,metric" → value, and the build its ops were counted with; false if
+// the file cannot be read
+static bool loadBaseline(const char *path, std::map<std::string, double> &out, std::string &opsBuild)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return false;
+    char line[160];
+    while (fgets(line, sizeof(line), f))
+    {
+        char name[64], metric[32];
+        double v;
+        if (!strncmp(line, OPS_BUILD_TAG, sizeof(OPS_BUILD_TAG) - 1))
+        {
+            opsBuild = line + sizeof(OPS_BUILD_TAG) - 1;
+            opsBuild.erase(opsBuild.find_last_not_of("\r\n") + 1);
+            continue;
+        }
+        if (line[0] == '#' || sscanf(line, "%63[^,],%31[^,],%lf", name, metric, &v) != 3)
+            continue;
+        out[std::string(name) + "," + metric] = v;
+    }
+    fclose(f);
+    return true;
+}
+
+int simBenchSuite(const char *baselinePath, bool update, double tolerancePct, bool gateHost)
+{
+    simSetTrace(SUITE_TRACE, sizeof(SUITE_TRACE) / sizeof(SUITE_TRACE[0]));
+    simSetQuiet(true);
+    setup();
+    while (!mqttIsConnected() && simMicros() < 60000000ull)
+    {
+        loop();
+        simAdvanceUs(1000);
+    }
+    if (!mqttIsConnected())
+    {
+        fprintf(stderr, "bench: no MQTT session\n");
+        return 1;
+    }
+    simAdvanceUs(1000000); // let the connect log drain out of the UART
+
+    std::vector<BenchCase> cases = runSuite();
+    if (simOps() == 0)
+    {
+        fprintf(stderr, "bench: no operation count (build src/ with -fsanitize-coverage=trace-pc, as the native envs do)\n");
+        return 1;
+    }
+
+    // Per call; a counter that never moved is not worth a row
+    std::vector<std::pair<std::string, double>> current; // "case,metric" in run order
+    std::map<std::string, bool> hostMetric;
+    for (const BenchCase &c : cases)
+    {
+        for (int i = 0; i < BC_COUNTERS; i++)
+        {
+            if (i == BC_SIM_US || c.sum[i])
+                current.emplace_back(std::string(c.name) + "," + COUNTER_NAMES[i], (double)c.sum[i] / c.calls);
+        }
+        std::string key = std::string(c.name) + ",host_ns";
+        current.emplace_back(key, c.hostNs / c.calls);
+        hostMetric[key] = true;
+    }
+
+    if (update)
+    {
+        FILE *f = fopen(baselinePath, "w");
+        if (!f)
+        {
+            fprintf(stderr, "bench: cannot write %s\n", baselinePath);
+            return 1;
+        }
+        fprintf(f, "# case,metric,value per call (--bench-suite --bench-update); lower is better\n");
+        fprintf(f, "%s%s\n", OPS_BUILD_TAG, simOpsBuild());
+        for (const auto &m : current)
+            fprintf(f, "%s,%.6g\n", m.first.c_str(), m.second);
+        fclose(f);
+        printf("bench suite: %zu metrics written to %s\n", current.size(), baselinePath);
+        return 0;
+    }
+
+    std::map<std::string, double> base;
+    std::string opsBuild;
+    if (!loadBaseline(baselinePath, base, opsBuild))
+    {
+        fprintf(stderr, "bench: no baseline at %s (create one with --bench-update)\n", baselinePath);
+        return 1;
+    }
+    // Block counts only compare within one compiler and optimisation level
+    bool gateOps = opsBuild == simOpsBuild();
+
+    printf("bench suite against %s, tolerance %.1f %%%s\n", baselinePath, tolerancePct,
+           gateHost ? "" : " (host time not gated)");
+    if (!gateOps)
+        printf("ops not gated: baseline counted with \"%s\", this build is \"%s\" (re-run --bench-update)\n",
+               opsBuild.c_str(), simOpsBuild());
+    printf("%-16s %-13s %12s %12s %8s\n", "case", "metric", "baseline", "current", "change");
+    uint32_t regressions = 0;
+    auto row = [&](const std::string &key, double b, double v, bool haveBase) {
+        size_t comma = key.find(',');
+        bool host = hostMetric.count(key) != 0;
+        bool gated = host ? gateHost : gateOps || key.compare(comma + 1, std::string::npos, "ops") != 0;
+        const char *verdict = "";
+        if (!haveBase)
+            verdict = "new";
+        else if (v > b * (1 + tolerancePct / 100) && v - b > 0.0005)
+        {
+            verdict = gated ? "REGRESSION" : host ? "slower (host)" : "more (other build)";
+            if (gated)
+                regressions++;
+        }
+        else if (v < b * (1 - tolerancePct / 100))
+            verdict = "improved";
+        char change[16] = "";
+        if (haveBase && b > 0)
+            snprintf(change, sizeof(change), "%+.1f%%", 100.0 * (v - b) / b);
+        printf("%-16s %-13s %12.6g %12.6g %8s  %s\n", key.substr(0, comma).c_str(), key.substr(comma + 1).c_str(),
+               haveBase ? b : 0.0, v, change, verdict);
+    };
+    for (const auto &m : current)
+    {
+        auto it = base.find(m.first);
+        row(m.first, it == base.end() ? 0.0 : it->second, m.second, it != base.end());
+        if (it != base.end())
+            base.erase(it);
+    }
+    for (const auto &gone : base)
+        row(gone.first, gone.second, 0.0, true); // the counter stopped moving
+
+    printf("%u regression%s\n", regressions, regressions == 1 ? "" : "s");
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,225 @@
+// Minimal MQTT 3.1.1 client (QoS 0) that mirrors the broker model onto a
+// real broker, so a replay can be watched with mosquitto_sub:
+//
+//   mosquitto -p 1883 &
+//   mosquitto_sub -t 'homestations/#' -v &
+//   .pio/build/native/program --broker localhost:1883
+//
+// Uses the host's own sockets, not the lwip_* stand-ins.
+
+#include "sim.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+
+static const uint16_t BRIDGE_KEEPALIVE_S = 60;
+
+static int g_fd = -1;
+static uint16_t g_packetId = 0;
+static std::string g_rx; // bytes received but not yet parsed
+static std::chrono::steady_clock::time_point g_lastTx;
+
+static void bridgeClose(const char *why)
+{
+    if (g_fd < 0)
+        return;
+    fprintf(stderr, "broker bridge: %s, disabled\n", why);
+    close(g_fd);
+    g_fd = -1;
+}
+
+static void putRemaining(std::string &pkt, size_t len)
+{
+    do
+    {
+        uint8_t b = len % 128;
+        len /= 128;
+        pkt += (char)(len ? b | 0x80 : b);
+    } while (len);
+}
+
+static void putString(std::string &pkt, const char *s, size_t len)
+{
+    pkt += (char)(len >> 8);
+    pkt += (char)(len & 0xff);
+    pkt.append(s, len);
+}
+
+static bool sendPacket(uint8_t header, const std::string &body)
+{
+    if (g_fd < 0)
+        return false;
+    std::string pkt(1, (char)header);
+    putRemaining(pkt, body.size());
+    pkt += body;
+    for (size_t off = 0; off < pkt.size();)
+    {
+        ssize_t n = send(g_fd, pkt.data() + off, pkt.size() - off, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            bridgeClose(strerror(errno));
+            return false;
+        }
+        off += (size_t)n;
+    }
+    g_lastTx = std::chrono::steady_clock::now();
+    return true;
+}
+
+// Pull whatever the socket has into g_rx; waits up to timeoutMs for the first byte
+static bool receive(int timeoutMs)
+{
+    struct pollfd p = {g_fd, POLLIN, 0};
+    if (poll(&p, 1, timeoutMs) <= 0)
+        return false;
+    char buf[1024];
+    ssize_t n = recv(g_fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n <= 0)
+    {
+        bridgeClose(n == 0 ? "broker closed the connection" : strerror(errno));
+        return false;
+    }
+    g_rx.append(buf, (size_t)n);
+    return true;
+}
+
+// Split one complete packet off g_rx
+static bool nextPacket(uint8_t &header, std::string &body)
+{
+    size_t len = 0, pos = 1;
+    for (int shift = 0;; shift += 7)
+    {
+        if (pos >= g_rx.size() || shift > 21)
+            return false;
+        uint8_t b = (uint8_t)g_rx[pos++];
+        len |= (size_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            break;
+    }
+    if (g_rx.size() < pos + len)
+        return false;
+    header = (uint8_t)g_rx[0];
+    body = g_rx.substr(pos, len);
+    g_rx.erase(0, pos + len);
+    return true;
+}
+
+bool simBridgeOpen(const char *hostPort)
+{
+    std::string host = hostPort, port = "1883";
+    size_t colon = host.rfind(':');
+    if (colon != std::string::npos)
+    {
+        port = host.substr(colon + 1);
+        host.erase(colon);
+    }
+
+    struct addrinfo hints = {}, *res = nullptr;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0)
+        return false;
+    for (struct addrinfo *ai = res; ai && g_fd < 0; ai = ai->ai_next)
+    {
+        g_fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (g_fd >= 0 && connect(g_fd, ai->ai_addr, ai->ai_addrlen) != 0)
+        {
+            close(g_fd);
+            g_fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (g_fd < 0)
+        return false;
+
+    char clientId[32];
+    snprintf(clientId, sizeof(clientId), "ws-sim-%d", (int)getpid());
+    std::string body;
+    putString(body, "MQTT", 4);
+    body += (char)4;    // protocol level 3.1.1
+    body += (char)0x02; // clean session
+    body += (char)(BRIDGE_KEEPALIVE_S >> 8);
+    body += (char)(BRIDGE_KEEPALIVE_S & 0xff);
+    putString(body, clientId, strlen(clientId));
+    if (!sendPacket(0x10, body))
+        return false;
+
+    uint8_t header;
+    std::string ack;
+    while (!nextPacket(header, ack))
+    {
+        if (!receive(5000))
+        {
+            bridgeClose("no CONNACK");
+            return false;
+        }
+    }
+    if (header != 0x20 || ack.size() < 2 || ack[1] != 0)
+    {
+        bridgeClose("connection refused");
+        return false;
+    }
+    return true;
+}
+
+bool simBridgeActive()
+{
+    return g_fd >= 0;
+}
+
+void simBridgePublish(const char *topic, const uint8_t *payload, unsigned int length)
+{
+    std::string body;
+    putString(body, topic, strlen(topic));
+    body.append((const char *)payload, length);
+    sendPacket(0x30, body);
+}
+
+void simBridgeSubscribe(const char *topic)
+{
+    std::string body;
+    if (++g_packetId == 0)
+        g_packetId = 1;
+    body += (char)(g_packetId >> 8);
+    body += (char)(g_packetId & 0xff);
+    putString(body, topic, strlen(topic));
+    body += (char)0; // QoS 0
+    sendPacket(0x82, body);
+}
+
+bool simBridgePoll(std::string &topic, std::string &payload)
+{
+    if (g_fd < 0)
+        return false;
+    if (std::chrono::steady_clock::now() - g_lastTx > std::chrono::seconds(BRIDGE_KEEPALIVE_S / 2))
+        sendPacket(0xc0, std::string()); // PINGREQ
+    while (g_fd >= 0)
+    {
+        uint8_t header;
+        std::string body;
+        while (nextPacket(header, body))
+        {
+            if ((header & 0xf0) != 0x30 || body.size() < 2)
+                continue; // SUBACK, PINGRESP
+            size_t topicLen = ((uint8_t)body[0] << 8) | (uint8_t)body[1];
+            size_t skip = 2 + topicLen + ((header & 0x06) ? 2 : 0); // packet id for QoS > 0
+            if (body.size() < skip)
+                continue;
+            topic = body.substr(2, topicLen);
+            payload = body.substr(skip);
+            return true;
+        }
+        if (!receive(0))
+            return false;
+    }
+    return false;
+}
@@ -0,0 +1,1144 @@
+// Stand-in device classes backed by the hardware model in sim.cpp
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include <TFT_eSPI.h>
+#include <WiFi.h>
+#include <Wire.h>
+#include <driver/i2s.h>
+#include <driver/pcnt.h>
+#include <lwip/sockets.h>
+
+#include "config.h"
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+
+// =================== BME280 (register model) ===================
+
+// Registers as in the datasheet; data registers are produced by inverting
+// the datasheet compensation for the trace values, so the sketch's driver
+// recovers them to within a count. Calibration words are the typical ones
+// from the Bosch reference examples.
+
+static struct
+{
+    uint8_t reg; // register pointer
+    uint8_t ctrlHum, ctrlMeas, config;
+    uint8_t data[8];
+    bool measuring;
+    uint64_t doneUs;
+    double iirT, iirP; // filter state (raw ADC units)
+    bool iirValid;
+} bme = {0, 0, 0, 0, {0x80, 0, 0, 0x80, 0, 0, 0x80, 0}, false, 0, 0, 0, false};
+
+static const uint16_t BME_T1 = 27504;
+static const int16_t BME_T2 = 26435, BME_T3 = -1000;
+static const uint16_t BME_P1 = 36477;
+static const int16_t BME_P2 = -10685, BME_P3 = 3024, BME_P4 = 2855, BME_P5 = 140, BME_P6 = -7, BME_P7 = 15500,
+                     BME_P8 = -14600, BME_P9 = 6000;
+static const uint8_t BME_H1 = 75, BME_H3 = 0;
+static const int16_t BME_H2 = 362, BME_H4 = 313, BME_H5 = 50;
+static const int8_t BME_H6 = 30;
+
+static int32_t bmeTFine(int32_t adcT)
+{
+    int32_t var1 = ((((adcT >> 3) - ((int32_t)BME_T1 << 1))) * ((int32_t)BME_T2)) >> 11;
+    int32_t var2 = (((((adcT >> 4) - ((int32_t)BME_T1)) * ((adcT >> 4) - ((int32_t)BME_T1))) >> 12) *
+                    ((int32_t)BME_T3)) >> 14;
+    return var1 + var2;
+}
+
+static double bmeTemp(int32_t adcT)
+{
+    return ((bmeTFine(adcT) * 5 + 128) >> 8) / 100.0;
+}
+
+static double bmePress(int32_t adcP, int32_t tFine)
+{
+    int64_t var1 = ((int64_t)tFine) - 128000;
+    int64_t var2 = var1 * var1 * (int64_t)BME_P6;
+    var2 = var2 + ((var1 * (int64_t)BME_P5) << 17);
+    var2 = var2 + (((int64_t)BME_P4) << 35);
+    var1 = ((var1 * var1 * (int64_t)BME_P3) >> 8) + ((var1 * (int64_t)BME_P2) << 12);
+    var1 = (((((int64_t)1) << 47) + var1)) * ((int64_t)BME_P1) >> 33;
+    if (var1 == 0)
+        return 0;
+    int64_t p = 1048576 - adcP;
+    p = (((p << 31) - var2) * 3125) / var1;
+    var1 = (((int64_t)BME_P9) * (p >> 13) * (p >> 13)) >> 25;
+    var2 = (((int64_t)BME_P8) * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + (((int64_t)BME_P7) << 4);
+    return p / 256.0; // Pa
+}
+
+static double bmeHum(int32_t adcH, int32_t tFine)
+{
+    int32_t v = tFine - ((int32_t)76800);
+    v = (((((adcH << 14) - (((int32_t)BME_H4) << 20) - (((int32_t)BME_H5) * v)) + ((int32_t)16384)) >> 15) *
+         (((((((v * ((int32_t)BME_H6)) >> 10) * (((v * ((int32_t)BME_H3)) >> 11) + ((int32_t)32768))) >> 10) +
+            ((int32_t)2097152)) * ((int32_t)BME_H2) + 8192) >> 14));
+    v = (v - (((((v >> 15) * (v >> 15)) >> 7) * ((int32_t)BME_H1)) >> 4));
+    v = std::min(std::max(v, 0), 419430400);
+    return (v >> 12) / 1024.0; // %RH
+}
+
+// Smallest raw value in [0, hi) whose compensated value reaches target
+// (f monotonic; decreasing ones are searched from the other end)
+template <typename F>
+static int32_t bmeInvert(F f, double target, int32_t hi)
+{
+    bool rising = f(hi - 1) > f(0);
+    int32_t lo = 0;
+    while (lo < hi - 1)
+    {
+        int32_t mid = lo + (hi - lo) / 2;
+        if ((f(mid) < target) == rising)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static uint8_t bmeOversampling(uint8_t bits)
+{
+    return bits == 0 ? 0 : 1 << (std::min<uint8_t>(bits, 5) - 1);
+}
+
+// Latch a finished forced conversion into the data registers
+static void bmeConvert()
+{
+    if (!bme.measuring || simMicros() < bme.doneUs)
+        return;
+    bme.measuring = false;
+    bme.ctrlMeas &= ~0x03; // back to sleep
+
+    SimTraceRow r = simTraceAt((uint32_t)(bme.doneUs / 1000));
+    int32_t adcT = bmeInvert([](int32_t a) { return bmeTemp(a); }, r.tempC, 1 << 20);
+    int32_t tFine = bmeTFine(adcT);
+    int32_t adcP = bmeInvert([tFine](int32_t a) { return bmePress(a, tFine); }, r.pressureHPa * 100.0, 1 << 20);
+    int32_t adcH = bmeInvert([tFine](int32_t a) { return bmeHum(a, tFine); }, r.humidity, 1 << 16);
+
+    // IIR filter on temperature and pressure (datasheet 3.4.4)
+    uint8_t coeff = (bme.config >> 2) & 0x07;
+    if (coeff && bme.iirValid)
+    {
+        double c = 1 << coeff;
+        bme.iirT = (bme.iirT * (c - 1) + adcT) / c;
+        bme.iirP = (bme.iirP * (c - 1) + adcP) / c;
+    }
+    else
+    {
+        bme.iirT = adcT;
+        bme.iirP = adcP;
+    }
+    bme.iirValid = true;
+
+    uint32_t t = (uint32_t)lround(bme.iirT), p = (uint32_t)lround(bme.iirP);
+    if (!bmeOversampling((bme.ctrlMeas >> 2) & 0x07))
+        p = 0x80000;
+    if (!bmeOversampling(bme.ctrlHum & 0x07))
+        adcH = 0x8000;
+    uint8_t d[8] = {(uint8_t)(p >> 12), (uint8_t)(p >> 4), (uint8_t)(p << 4),
+                    (uint8_t)(t >> 12), (uint8_t)(t >> 4), (uint8_t)(t << 4),
+                    (uint8_t)(adcH >> 8), (uint8_t)adcH};
+    memcpy(bme.data, d, sizeof(d));
+}
+
+static uint8_t bmeCalibByte(uint8_t reg)
+{
+    uint8_t tp[26] = {};
+    const uint16_t words[12] = {BME_T1, (uint16_t)BME_T2, (uint16_t)BME_T3, BME_P1, (uint16_t)BME_P2,
+                                (uint16_t)BME_P3, (uint16_t)BME_P4, (uint16_t)BME_P5, (uint16_t)BME_P6,
+                                (uint16_t)BME_P7, (uint16_t)BME_P8, (uint16_t)BME_P9};
+    for (int i = 0; i < 12; i++)
+    {
+        tp[2 * i] = (uint8_t)words[i];
+        tp[2 * i + 1] = (uint8_t)(words[i] >> 8);
+    }
+    tp[25] = BME_H1;
+    const uint8_t h[7] = {(uint8_t)BME_H2, (uint8_t)((uint16_t)BME_H2 >> 8), BME_H3, (uint8_t)(BME_H4 >> 4),
+                          (uint8_t)((BME_H4 & 0x0F) | ((BME_H5 & 0x0F) << 4)), (uint8_t)(BME_H5 >> 4),
+                          (uint8_t)BME_H6};
+    if (reg >= 0x88 && reg < 0x88 + 26)
+        return tp[reg - 0x88];
+    if (reg >= 0xE1 && reg < 0xE1 + 7)
+        return h[reg - 0xE1];
+    return 0;
+}
+
+static uint8_t bmeReadReg(uint8_t reg)
+{
+    bmeConvert();
+    if (reg == 0xD0)
+        return 0x60;
+    if (reg == 0xF2)
+        return bme.ctrlHum;
+    if (reg == 0xF3)
+        return bme.measuring ? 0x08 : 0x00;
+    if (reg == 0xF4)
+        return bme.ctrlMeas;
+    if (reg == 0xF5)
+        return bme.config;
+    if (reg >= 0xF7 && reg <= 0xFE)
+        return bme.data[reg - 0xF7];
+    return bmeCalibByte(reg);
+}
+
+static void bmeWriteReg(uint8_t reg, uint8_t value)
+{
+    bmeConvert();
+    if (reg == 0xE0 && value == 0xB6)
+    {
+        bme.ctrlHum = bme.ctrlMeas = bme.config = 0;
+        bme.measuring = bme.iirValid = false;
+        const uint8_t reset[8] = {0x80, 0, 0, 0x80, 0, 0, 0x80, 0};
+        memcpy(bme.data, reset, sizeof(reset));
+    }
+    else if (reg == 0xF2)
+        bme.ctrlHum = value & 0x07;
+    else if (reg == 0xF5)
+        bme.config = value;
+    else if (reg == 0xF4)
+    {
+        bme.ctrlMeas = value;
+        if ((value & 0x03) == 0x01 || (value & 0x03) == 0x02)
+        {
+            // Forced (normal mode is treated as one conversion per write); datasheet 9.1 maximum
+            uint8_t osT = bmeOversampling(value >> 5), osP = bmeOversampling((value >> 2) & 0x07);
+            uint8_t osH = bmeOversampling(bme.ctrlHum);
+            uint32_t us = 1250 + 2300 * osT + (osP ? 2300 * osP + 575 : 0) + (osH ? 2300 * osH + 575 : 0);
+            bme.measuring = true;
+            bme.doneUs = simMicros() + us;
+        }
+    }
+}
+
+static bool bmeAddressed(uint16_t address)
+{
+    return simConfig().bmePresent && address == simConfig().bmeAddress;
+}
+
+void TwoWire::beginTransmission(uint16_t address)
+{
+    txAddress_ = address;
+    tx_.clear();
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    tx_.push_back(data);
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t len)
+{
+    tx_.insert(tx_.end(), data, data + len);
+    return len;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+    (void)sendStop;
+    if (!bmeAddressed(txAddress_))
+    {
+        simI2cTransfer(1);
+        return 2;
+    }
+    simI2cTransfer(1 + (uint32_t)tx_.size());
+    if (!tx_.empty())
+        bme.reg = tx_[0];
+    for (size_t i = 0; i + 1 < tx_.size(); i += 2)
+        bmeWriteReg(tx_[i], tx_[i + 1]); // writes go as register/value pairs
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint16_t address, uint8_t size, bool sendStop)
+{
+    (void)sendStop;
+    rx_.clear();
+    rxPos_ = 0;
+    if (!bmeAddressed(address))
+    {
+        simI2cTransfer(1);
+        return 0;
+    }
+    simI2cTransfer(1 + size);
+    for (uint8_t i = 0; i < size; i++)
+        rx_.push_back(bmeReadReg(bme.reg++));
+    return size;
+}
+
+int TwoWire::available()
+{
+    return (int)(rx_.size() - rxPos_);
+}
+
+int TwoWire::read()
+{
+    return rxPos_ < rx_.size() ? rx_[rxPos_++] : -1;
+}
+
+// =================== I2S built-in ADC (continuous mode) ===================
+
+static struct
+{
+    bool installed;
+    bool enabled;
+    uint32_t rate;
+    uint32_t bufCount;
+    uint32_t bufLen;
+    adc1_channel_t channel;
+    uint64_t startUs;
+    uint64_t generated; // whole DMA buffers produced since enable
+    std::deque<std::vector<uint16_t>> full;
+    size_t offset; // samples already read from full.front()
+} i2sAdc;
+
+// ADC1 channel → GPIO
+static uint8_t adc1Pin(adc1_channel_t ch)
+{
+    static const uint8_t pins[] = {36, 37, 38, 39, 32, 33, 34, 35};
+    return pins[ch & 7];
+}
+
+// Produce the buffers the DMA engine has completed by now
+static void i2sAdcFill()
+{
+    uint64_t done = (simMicros() - i2sAdc.startUs) * i2sAdc.rate / 1000000 / i2sAdc.bufLen;
+    if (done - i2sAdc.generated > i2sAdc.bufCount)
+    {
+        // Nobody read for a while: everything but the newest bufCount buffers is gone
+        uint64_t skip = done - i2sAdc.generated - i2sAdc.bufCount;
+        simStats().adcDmaDropped += skip * i2sAdc.bufLen;
+        i2sAdc.generated += skip;
+    }
+    for (; i2sAdc.generated < done; i2sAdc.generated++)
+    {
+        uint64_t midUs = i2sAdc.startUs + ((i2sAdc.generated * 2 + 1) * i2sAdc.bufLen * 1000000 / i2sAdc.rate) / 2;
+        std::vector<uint16_t> buf(i2sAdc.bufLen);
+        for (uint16_t &v : buf)
+            v = (uint16_t)((i2sAdc.channel << 12) | simAdcSample(adc1Pin(i2sAdc.channel), (uint32_t)(midUs / 1000)));
+        i2sAdc.full.push_back(std::move(buf));
+        if (i2sAdc.full.size() > i2sAdc.bufCount)
+        {
+            simStats().adcDmaDropped += i2sAdc.bufLen - i2sAdc.offset;
+            i2sAdc.full.pop_front();
+            i2sAdc.offset = 0;
+        }
+    }
+}
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t *config, int queue_size, void *queue)
+{
+    (void)queue_size, (void)queue;
+    if (port != I2S_NUM_0 || !config || !(config->mode & I2S_MODE_ADC_BUILT_IN) || config->sample_rate == 0 ||
+        config->dma_buf_count < 2 || config->dma_buf_len < 8)
+        return ESP_ERR_INVALID_ARG;
+    i2sAdc.installed = true;
+    i2sAdc.enabled = false;
+    i2sAdc.rate = config->sample_rate;
+    i2sAdc.bufCount = (uint32_t)config->dma_buf_count;
+    i2sAdc.bufLen = (uint32_t)config->dma_buf_len;
+    return ESP_OK;
+}
+
+esp_err_t i2s_driver_uninstall(i2s_port_t port)
+{
+    (void)port;
+    i2sAdc.installed = i2sAdc.enabled = false;
+    i2sAdc.full.clear();
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_adc_mode(adc_unit_t unit, adc1_channel_t channel)
+{
+    if (unit != ADC_UNIT_1)
+        return ESP_ERR_INVALID_ARG;
+    i2sAdc.channel = channel;
+    return ESP_OK;
+}
+
+esp_err_t i2s_adc_enable(i2s_port_t port)
+{
+    (void)port;
+    if (!i2sAdc.installed)
+        return ESP_ERR_INVALID_STATE;
+    i2sAdc.enabled = true;
+    i2sAdc.startUs = simMicros();
+    i2sAdc.generated = 0;
+    i2sAdc.full.clear();
+    i2sAdc.offset = 0;
+    return ESP_OK;
+}
+
+esp_err_t i2s_adc_disable(i2s_port_t port)
+{
+    (void)port;
+    i2sAdc.enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t i2s_read(i2s_port_t port, void *dest, size_t size, size_t *bytes_read, TickType_t ticks_to_wait)
+{
+    (void)port;
+    *bytes_read = 0;
+    if (!i2sAdc.enabled)
+        return ESP_ERR_INVALID_STATE;
+
+    i2sAdcFill();
+    if (i2sAdc.full.empty() && ticks_to_wait > 0)
+    {
+        // Block until the buffer in flight completes (or the timeout)
+        uint64_t nextUs = i2sAdc.startUs + ((i2sAdc.generated + 1) * i2sAdc.bufLen * 1000000 + i2sAdc.rate - 1) / i2sAdc.rate;
+        simAdvanceUs(std::min<uint64_t>(nextUs - simMicros(), (uint64_t)ticks_to_wait * 1000));
+        i2sAdcFill();
+    }
+
+    uint16_t *out = (uint16_t *)dest;
+    size_t want = size / sizeof(uint16_t), n = 0;
+    while (n < want && !i2sAdc.full.empty())
+    {
+        const std::vector<uint16_t> &buf = i2sAdc.full.front();
+        size_t take = std::min(want - n, buf.size() - i2sAdc.offset);
+        memcpy(out + n, buf.data() + i2sAdc.offset, take * sizeof(uint16_t));
+        n += take;
+        i2sAdc.offset += take;
+        if (i2sAdc.offset == buf.size())
+        {
+            i2sAdc.full.pop_front();
+            i2sAdc.offset = 0;
+        }
+    }
+    simStats().adcDmaSamples += n;
+    *bytes_read = n * sizeof(uint16_t);
+    return ESP_OK;
+}
+
+// =================== Pulse counter ===================
+
+static struct
+{
+    bool configured;
+    bool running;
+    int16_t hLim;
+    uint32_t counted; // edges up to the last pause
+    uint32_t runFrom; // simHallCounterEdges() at the last resume
+} pcnt;
+
+esp_err_t pcnt_unit_config(const pcnt_config_t *cfg)
+{
+    if (!cfg || cfg->unit != PCNT_UNIT_0 || cfg->pulse_gpio_num != HALL_PIN || cfg->counter_h_lim <= 0 ||
+        cfg->neg_mode != PCNT_COUNT_INC || cfg->pos_mode != PCNT_COUNT_DIS)
+        return ESP_ERR_INVALID_ARG;
+    pcnt.configured = true;
+    pcnt.running = true; // the IDF driver starts the unit counting
+    pcnt.hLim = cfg->counter_h_lim;
+    pcnt.counted = 0;
+    pcnt.runFrom = simHallCounterEdges();
+    simHallCounter(true);
+    return ESP_OK;
+}
+
+esp_err_t pcnt_get_counter_value(pcnt_unit_t unit, int16_t *count)
+{
+    if (unit != PCNT_UNIT_0 || !pcnt.configured || !count)
+        return ESP_ERR_INVALID_ARG;
+    uint32_t edges = pcnt.counted + (pcnt.running ? simHallCounterEdges() - pcnt.runFrom : 0);
+    *count = (int16_t)(edges % (uint32_t)pcnt.hLim);
+    return ESP_OK;
+}
+
+esp_err_t pcnt_counter_pause(pcnt_unit_t unit)
+{
+    if (unit != PCNT_UNIT_0 || !pcnt.configured)
+        return ESP_ERR_INVALID_STATE;
+    if (pcnt.running)
+        pcnt.counted += simHallCounterEdges() - pcnt.runFrom;
+    pcnt.running = false;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_counter_resume(pcnt_unit_t unit)
+{
+    if (unit != PCNT_UNIT_0 || !pcnt.configured)
+        return ESP_ERR_INVALID_STATE;
+    if (!pcnt.running)
+        pcnt.runFrom = simHallCounterEdges();
+    pcnt.running = true;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_counter_clear(pcnt_unit_t unit)
+{
+    if (unit != PCNT_UNIT_0 || !pcnt.configured)
+        return ESP_ERR_INVALID_STATE;
+    pcnt.counted = 0;
+    pcnt.runFrom = simHallCounterEdges();
+    return ESP_OK;
+}
+
+esp_err_t pcnt_set_filter_value(pcnt_unit_t unit, uint16_t filter_val)
+{
+    return unit == PCNT_UNIT_0 && filter_val <= 1023 ? ESP_OK : ESP_ERR_INVALID_ARG; // 10-bit register
+}
+
+esp_err_t pcnt_filter_enable(pcnt_unit_t unit)
+{
+    return unit == PCNT_UNIT_0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+// =================== Sockets ===================
+
+// Inbound bytes that arrive together
+struct SimSegment
+{
+    uint64_t atUs; // readable from this time
+    std::vector<uint8_t> bytes;
+    size_t read;
+};
+
+struct SimSocket
+{
+    bool open = false;
+    bool connecting = false;
+    bool established = false;
+    int error = 0;
+    uint64_t startUs = 0;
+    uint32_t unacked = 0;   // bytes in the send buffer
+    uint64_t drainedUs = 0; // unacked is current as of this time
+    bool session = false;   // CONNACK accepted: the broker model delivers publishes here
+    std::deque<SimSegment> rx; // in stream order
+};
+
+static const int SIM_FD_BASE = 48;
+static SimSocket sockets[8];
+
+static SimSocket *sock(int fd)
+{
+    int i = fd - SIM_FD_BASE;
+    if (i < 0 || i >= (int)(sizeof(sockets) / sizeof(sockets[0])) || !sockets[i].open)
+        return nullptr;
+    return &sockets[i];
+}
+
+// Resolve a pending connect against the WiFi/broker model
+static void sockUpdate(SimSocket &s)
+{
+    uint64_t elapsed = simMicros() - s.startUs;
+    if (s.connecting)
+    {
+        if (!simWifiConnected())
+            s.error = EHOSTUNREACH;
+        else if (!simBrokerAvailable() && elapsed >= (uint64_t)simConfig().mqttConnectFailMs * 1000)
+            s.error = ETIMEDOUT;
+        else if (simBrokerAvailable() && elapsed >= (uint64_t)simConfig().tcpConnectMs * 1000)
+            s.established = true;
+        if (s.error || s.established)
+            s.connecting = false;
+    }
+    else if (s.established && (!simWifiConnected() || !simBrokerAvailable()))
+    {
+        s.established = false;
+        s.error = ECONNRESET;
+    }
+}
+
+int simSocketOpen()
+{
+    for (size_t i = 0; i < sizeof(sockets) / sizeof(sockets[0]); i++)
+    {
+        if (!sockets[i].open)
+        {
+            sockets[i] = SimSocket{};
+            sockets[i].open = true;
+            return SIM_FD_BASE + (int)i;
+        }
+    }
+    return -1;
+}
+
+bool simSocketStartConnect(int fd)
+{
+    SimSocket *s = sock(fd);
+    if (!s)
+        return false;
+    s->connecting = true;
+    s->startUs = simMicros();
+    return true;
+}
+
+int simSocketConnectResult(int fd)
+{
+    SimSocket *s = sock(fd);
+    if (!s)
+        return -EBADF;
+    sockUpdate(*s);
+    if (s->error)
+        return -s->error;
+    return s->established ? 1 : 0;
+}
+
+bool simSocketConnected(int fd)
+{
+    SimSocket *s = sock(fd);
+    if (!s)
+        return false;
+    sockUpdate(*s);
+    return s->established;
+}
+
+void simSocketClose(int fd)
+{
+    SimSocket *s = sock(fd);
+    if (s)
+        s->open = false;
+}
+
+// The broker acknowledges uplinkBytesPerSec; unlimited keeps the buffer empty
+static void sockDrain(SimSocket &s)
+{
+    uint64_t now = simMicros();
+    uint32_t bps = simConfig().uplinkBytesPerSec;
+    uint64_t acked = bps ? (now - s.drainedUs) * bps / 1000000 : s.unacked;
+    if (acked == 0)
+        return; // keep the remainder accruing
+    s.unacked -= (uint32_t)std::min<uint64_t>(acked, s.unacked);
+    s.drainedUs = now;
+}
+
+void simSocketSend(int fd, uint32_t bytes)
+{
+    SimSocket *s = sock(fd);
+    if (!s)
+        return;
+    uint32_t room = std::max(simConfig().tcpSendBuf, bytes);
+    uint64_t t0 = simMicros();
+    for (sockDrain(*s); s->unacked + bytes > room && simSocketConnected(fd); sockDrain(*s))
+        simAdvanceUs(1000); // lwip_send() blocks until acks free enough space
+    uint64_t waited = simMicros() - t0;
+    SimStats &st = simStats();
+    st.sendBlockedUs += waited;
+    st.sendBlockedMaxUs = std::max(st.sendBlockedMaxUs, waited);
+    if (s->unacked == 0)
+        s->drainedUs = simMicros();
+    s->unacked += bytes;
+}
+
+bool simSocketWritable(int fd)
+{
+    SimSocket *s = sock(fd);
+    if (!s || !simSocketConnected(fd))
+        return false;
+    sockDrain(*s);
+    return s->unacked < simConfig().tcpSendBuf / 2; // TCP_SNDLOWAT
+}
+
+static const uint8_t CONNACK[4] = {0x20, 0x02, 0x00, 0x00}; // session not present, accepted
+
+static void sockReceive(SimSocket &s, uint64_t atUs, const uint8_t *bytes, size_t len)
+{
+    if (!s.rx.empty())
+        atUs = std::max(atUs, s.rx.back().atUs); // TCP keeps the stream in order
+    s.rx.push_back(SimSegment{atUs, std::vector<uint8_t>(bytes, bytes + len), 0});
+}
+
+// Due broker messages become PUBLISH packets; with mqttSegmentGapMs the
+// second half of each arrives that much later, as a separate TCP segment
+static void sockDeliver(SimSocket &s)
+{
+    SimMqttMessage msg;
+    while (s.session && simMqttNextInbound(msg))
+    {
+        size_t topicLen = strlen(msg.topic), remaining = 2 + topicLen + msg.length;
+        std::vector<uint8_t> p = {0x30}; // PUBLISH, QoS 0
+        for (size_t r = remaining; p.size() == 1 || r > 0; r >>= 7)
+            p.push_back((uint8_t)((r & 0x7f) | (r > 0x7f ? 0x80 : 0)));
+        p.push_back((uint8_t)(topicLen >> 8));
+        p.push_back((uint8_t)topicLen);
+        p.insert(p.end(), msg.topic, msg.topic + topicLen);
+        p.insert(p.end(), msg.payload, msg.payload + msg.length);
+
+        uint64_t now = simMicros(), gapUs = (uint64_t)simConfig().mqttSegmentGapMs * 1000;
+        size_t first = gapUs ? p.size() / 2 : p.size();
+        sockReceive(s, now, p.data(), first);
+        if (first < p.size())
+            sockReceive(s, now + gapUs, p.data() + first, p.size() - first);
+    }
+}
+
+void simSocketMqttConnect(int fd, uint32_t bytes)
+{
+    SimSocket *s = sock(fd);
+    if (!s)
+        return;
+    simSocketSend(fd, bytes);
+    s->session = false;
+    s->rx.clear();
+    sockReceive(*s, simMicros() + (uint64_t)simConfig().mqttConnackMs * 1000, CONNACK, sizeof(CONNACK));
+}
+
+void simSocketMqttOnline(int fd)
+{
+    if (SimSocket *s = sock(fd))
+        s->session = true;
+}
+
+int simSocketAvailable(int fd)
+{
+    SimSocket *s = sock(fd);
+    if (!s || !simSocketConnected(fd))
+        return 0;
+    sockDeliver(*s);
+    uint64_t now = simMicros();
+    size_t n = 0;
+    for (const SimSegment &seg : s->rx)
+    {
+        if (seg.atUs > now)
+            break;
+        n += seg.bytes.size() - seg.read;
+    }
+    return (int)n;
+}
+
+int simSocketRead(int fd, uint8_t *buf, size_t len)
+{
+    int n = std::min<int>(simSocketAvailable(fd), (int)len);
+    if (n <= 0)
+        return -1;
+    SimSocket *s = sock(fd);
+    for (int done = 0; done < n;)
+    {
+        SimSegment &seg = s->rx.front();
+        size_t take = std::min<size_t>(seg.bytes.size() - seg.read, (size_t)(n - done));
+        memcpy(buf + done, seg.bytes.data() + seg.read, take);
+        seg.read += take;
+        done += (int)take;
+        if (seg.read == seg.bytes.size())
+            s->rx.pop_front();
+    }
+    return n;
+}
+
+int lwip_socket(int domain, int type, int protocol)
+{
+    (void)domain, (void)type, (void)protocol;
+    int fd = simSocketOpen();
+    if (fd < 0)
+        errno = ENFILE;
+    return fd;
+}
+
+int lwip_connect(int s, const struct sockaddr *name, socklen_t namelen)
+{
+    (void)name, (void)namelen;
+    if (!simSocketStartConnect(s))
+    {
+        errno = EBADF;
+        return -1;
+    }
+    errno = EINPROGRESS; // every simulated socket connects asynchronously
+    return -1;
+}
+
+int lwip_close(int s)
+{
+    simSocketClose(s);
+    return 0;
+}
+
+ssize_t lwip_recv(int s, void *mem, size_t len, int flags)
+{
+    (void)mem, (void)len, (void)flags; // inbound data goes through the broker model
+    if (!simSocketConnected(s))
+        return 0; // closed by the peer
+    errno = EWOULDBLOCK;
+    return -1;
+}
+
+int lwip_fcntl(int s, int cmd, int val)
+{
+    (void)s, (void)cmd, (void)val; // blocking mode is not modelled
+    return 0;
+}
+
+int lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptset, struct timeval *timeout)
+{
+    (void)readset, (void)exceptset, (void)timeout; // only zero-timeout writability polls are modelled
+    int ready = 0;
+    for (int fd = 0; writeset && fd < maxfdp1; fd++)
+    {
+        if (!FD_ISSET(fd, writeset))
+            continue;
+        SimSocket *s = sock(fd);
+        bool established = s && s->established && !s->connecting;
+        if (established ? simSocketWritable(fd) : simSocketConnectResult(fd) != 0)
+            ready++;
+        else
+            FD_CLR(fd, writeset);
+    }
+    return ready;
+}
+
+int lwip_getsockopt(int s, int level, int optname, void *optval, socklen_t *optlen)
+{
+    if (level != SOL_SOCKET || optname != SO_ERROR || !optval || !optlen || *optlen < sizeof(int))
+    {
+        errno = ENOPROTOOPT;
+        return -1;
+    }
+    int r = simSocketConnectResult(s);
+    *(int *)optval = r < 0 ? -r : 0;
+    return 0;
+}
+
+// =================== WiFiClient ===================
+
+int WiFiClient::connect(const char *host, uint16_t port)
+{
+    (void)host, (void)port;
+    stop();
+    fd_ = simSocketOpen();
+    if (fd_ < 0 || !simSocketStartConnect(fd_))
+        return 0;
+    // Block until the handshake resolves, 1 ms at a time
+    int r;
+    while ((r = simSocketConnectResult(fd_)) == 0)
+        simAdvanceUs(1000);
+    if (r < 0)
+    {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size)
+{
+    if (!connected())
+        return 0;
+    if (size > 0 && buf[0] == 0x10) // CONNECT; publishes are charged by the PubSubClient stand-in
+        simSocketMqttConnect(fd_, (uint32_t)size);
+    return size;
+}
+
+int WiFiClient::available()
+{
+    return fd_ >= 0 ? simSocketAvailable(fd_) : 0;
+}
+
+int WiFiClient::read()
+{
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t size)
+{
+    return fd_ >= 0 ? simSocketRead(fd_, buf, size) : -1;
+}
+
+uint8_t WiFiClient::connected()
+{
+    return fd_ >= 0 && simSocketConnected(fd_);
+}
+
+void WiFiClient::stop()
+{
+    if (fd_ >= 0)
+        simSocketClose(fd_);
+    fd_ = -1;
+}
+
+// =================== PubSubClient ===================
+
+bool PubSubClient::connect(const char *id, const char *user, const char *pass)
+{
+    (void)user;
+    (void)pass;
+    // Like PubSubClient 2.8: reuse an already-open socket, otherwise a blocking TCP connect
+    if (!client_->connected() && !client_->connect("broker", 0))
+    {
+        state_ = MQTT_CONNECT_FAILED;
+        simStats().mqttConnectFails++;
+        return false;
+    }
+    // Write CONNECT, then spin until the CONNACK is readable (socket timeout)
+    uint8_t packet[64] = {0x10};
+    client_->write(packet, std::min(sizeof(packet), 14 + strlen(id)));
+    uint64_t t0 = simMicros();
+    while (!client_->available())
+    {
+        if (simMicros() - t0 >= (uint64_t)socketTimeout_ * 1000000)
+        {
+            state_ = MQTT_CONNECTION_TIMEOUT;
+            client_->stop();
+            simStats().mqttConnectFails++;
+            return false;
+        }
+        simAdvanceUs(1000);
+    }
+    uint8_t connack[4];
+    if (client_->read(connack, sizeof(connack)) != (int)sizeof(connack) || connack[0] != 0x20 || connack[3] != 0)
+    {
+        state_ = MQTT_CONNECT_FAILED;
+        client_->stop();
+        simStats().mqttConnectFails++;
+        return false;
+    }
+    simMqttDisconnect(); // clean session
+    simSocketMqttOnline(client_->fd());
+    state_ = MQTT_CONNECTED;
+    SimStats &st = simStats();
+    st.mqttConnects++;
+    if (SimSocket *s = sock(client_->fd()))
+    {
+        uint64_t took = simMicros() - s->startUs;
+        st.connectUs += took;
+        st.connectMaxUs = std::max(st.connectMaxUs, took);
+    }
+    return true;
+}
+
+void PubSubClient::disconnect()
+{
+    simMqttDisconnect();
+    client_->stop();
+    state_ = MQTT_DISCONNECTED;
+}
+
+bool PubSubClient::connected()
+{
+    if (state_ == MQTT_CONNECTED && !client_->connected())
+    {
+        simMqttDisconnect();
+        client_->stop();
+        state_ = MQTT_CONNECTION_LOST;
+    }
+    return state_ == MQTT_CONNECTED;
+}
+
+bool PubSubClient::publish(const char *topic, const char *payload)
+{
+    return publish(topic, (const uint8_t *)payload, (unsigned int)strlen(payload));
+}
+
+bool PubSubClient::publish(const char *topic, const char *payload, bool retained)
+{
+    (void)retained;
+    return publish(topic, payload);
+}
+
+bool PubSubClient::publish(const char *topic, const uint8_t *payload, unsigned int length)
+{
+    if (!connected())
+        return false;
+    // Like the library: the whole packet (header, topic, payload) must fit the buffer
+    size_t topicLen = strlen(topic);
+    if (5 + 2 + topicLen + length > bufferSize_)
+        return false;
+    simAdvanceUs(simConfig().mqttPublishUs);
+    simSocketSend(client_->fd(), (uint32_t)(5 + 2 + topicLen + length) + simTlsRecordOverhead(client_->fd()));
+    simMqttRecordPublish(topic, payload, length);
+    return true;
+}
+
+bool PubSubClient::subscribe(const char *topic)
+{
+    if (!connected())
+        return false;
+    simMqttSubscribe(topic);
+    return true;
+}
+
+// Like the library: a missing byte is waited for up to the socket timeout
+bool PubSubClient::readByte(uint8_t &b)
+{
+    uint64_t t0 = simMicros();
+    while (!client_->available())
+    {
+        if (simMicros() - t0 >= (uint64_t)socketTimeout_ * 1000000)
+            return false;
+        simAdvanceUs(1000);
+    }
+    b = (uint8_t)client_->read();
+    return true;
+}
+
+// Like the library: at most one packet per call, read a byte at a time as
+// soon as any of it is available
+bool PubSubClient::loop()
+{
+    if (!connected())
+        return false;
+    if (!client_->available())
+        return true;
+
+    uint64_t t0 = simMicros();
+    std::vector<uint8_t> buf; // fixed header byte, then the variable header and payload
+    uint8_t b;
+    bool ok = readByte(b);
+    buf.push_back(b);
+    uint32_t remaining = 0;
+    for (uint8_t shift = 0; ok && shift < 28; shift += 7)
+    {
+        ok = readByte(b);
+        remaining |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            break;
+    }
+    for (uint32_t i = 0; ok && i < remaining; i++)
+    {
+        ok = readByte(b);
+        buf.push_back(b);
+    }
+    SimStats &st = simStats();
+    uint64_t waited = simMicros() - t0;
+    st.mqttLoopBlockedUs += waited;
+    st.mqttLoopBlockedMaxUs = std::max(st.mqttLoopBlockedMaxUs, waited);
+    if (!ok || buf.size() + 4 > bufferSize_ || (buf[0] & 0xf0) != 0x30 || !callback_ || remaining < 2)
+        return true; // a timed-out or oversize packet is dropped, as the library does
+
+    size_t topicLen = ((size_t)buf[1] << 8) | buf[2];
+    if (3 + topicLen > buf.size())
+        return true;
+    std::string topic((const char *)&buf[3], topicLen);
+    size_t at = 3 + topicLen;
+    callback_(&topic[0], buf.data() + at, (unsigned int)(buf.size() - at));
+    return true;
+}
+
+// =================== TFT_eSPI ===================
+
+// Column/row/RAMWR commands with their parameters for one address window
+static const uint32_t TFT_WINDOW_BYTES = 11;
+
+void TFT_eSPI::charge(uint64_t pixels, uint32_t windows)
+{
+    if (offscreen_)
+    {
+        simSpriteDraw(pixels);
+        return;
+    }
+    simStats().tftCalls++;
+    simSpiTransfer((uint64_t)windows * TFT_WINDOW_BYTES + pixels * 2);
+}
+
+void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data)
+{
+    (void)x, (void)y, (void)data;
+    if (w > 0 && h > 0)
+        charge((uint64_t)w * h);
+}
+
+void TFT_eSPI::pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data)
+{
+    (void)x, (void)y, (void)data;
+    if (!dmaReady_ || w <= 0 || h <= 0)
+        return;
+    // the driver waits for the previous transfer and sets the window itself
+    simStats().tftCalls++;
+    simSpiTransfer(TFT_WINDOW_BYTES);
+    simSpiDmaStart((uint64_t)w * h * 2);
+}
+
+void *TFT_eSprite::createSprite(int16_t w, int16_t h)
+{
+    deleteSprite();
+    if (w <= 0 || h <= 0 || !simHeapAlloc((uint32_t)w * h * 2))
+        return nullptr;
+    buf_.assign((size_t)w * h, 0);
+    w0_ = w;
+    h0_ = h;
+    return buf_.data();
+}
+
+void TFT_eSprite::deleteSprite()
+{
+    if (buf_.empty())
+        return;
+    simHeapFree((uint32_t)buf_.size() * 2);
+    buf_.clear();
+    w0_ = h0_ = 0;
+}
+
+void TFT_eSprite::pushSprite(int32_t x, int32_t y)
+{
+    tft_->pushImage(x, y, width(), height(), buf_.data());
+}
+
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+    (void)color;
+    int32_t x1 = std::min<int32_t>(x + w, width()), y1 = std::min<int32_t>(y + h, height());
+    x = std::max<int32_t>(x, 0);
+    y = std::max<int32_t>(y, 0);
+    if (x1 <= x || y1 <= y)
+        return;
+    charge((uint64_t)(x1 - x) * (y1 - y));
+}
+
+void TFT_eSPI::fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color)
+{
+    (void)x, (void)y, (void)color;
+    if (w <= 0 || h <= 0)
+        return;
+    // body rectangle plus one horizontal span per corner row
+    charge((uint64_t)w * h, 1 + 2 * (uint32_t)std::max<int32_t>(r, 0));
+}
+
+void TFT_eSPI::drawRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color)
+{
+    (void)x, (void)y, (void)color;
+    if (w <= 0 || h <= 0)
+        return;
+    // four straight edges plus corner arcs plotted pixel by pixel
+    uint32_t arc = (uint32_t)std::max<int32_t>(r, 0) * 4;
+    charge((uint64_t)2 * (w + h), 4 + arc);
+}
+
+void TFT_eSPI::fillCircle(int32_t x, int32_t y, int32_t r, uint32_t color)
+{
+    (void)x, (void)y, (void)color;
+    charge((uint64_t)(M_PI * r * r), 2 * (uint32_t)r + 1);
+}
+
+void TFT_eSPI::fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color)
+{
+    (void)color;
+    int64_t area2 = (int64_t)(x1 - x0) * (y2 - y0) - (int64_t)(x2 - x0) * (y1 - y0);
+    int32_t rows = std::max({y0, y1, y2}) - std::min({y0, y1, y2}) + 1;
+    charge((uint64_t)(area2 < 0 ? -area2 : area2) / 2, (uint32_t)rows);
+}
+
+void TFT_eSPI::drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color)
+{
+    (void)color;
+    int32_t dx = abs(x1 - x0), dy = abs(y1 - y0);
+    uint32_t len = (uint32_t)std::max(dx, dy) + 1;
+    charge(len, (dx == 0 || dy == 0) ? 1 : len);
+}
+
+int16_t TFT_eSPI::textWidth(const char *s) const
+{
+    // GLCD is a fixed 6x8 cell; font 2 is proportional, ~8 px on average
+    int16_t cell = (font_ == 2) ? 8 : 6;
+    return (int16_t)(strlen(s) * cell * size_);
+}
+
+int16_t TFT_eSPI::fontHeight() const
+{
+    return (int16_t)(((font_ == 2) ? 16 : 8) * size_);
+}
+
+int16_t TFT_eSPI::drawString(const char *s, int32_t x, int32_t y)
+{
+    (void)x, (void)y;
+    int16_t w = textWidth(s);
+    // one window per glyph cell, background painted along with the glyph
+    charge((uint64_t)w * fontHeight(), (uint32_t)strlen(s));
+    return w;
+}
@@ -0,0 +1,118 @@
+// LittleFS stand-in over a host directory
+
+#include <LittleFS.h>
+
+#include <dirent.h>
+#include <string>
+#include <sys/stat.h>
+
+fs::LittleFSFS LittleFS;
+
+static std::string hostPath(const char *path)
+{
+    std::string p = simFlashDir();
+    if (path[0] != '/')
+        p += '/';
+    return p + path;
+}
+
+namespace fs
+{
+
+size_t File::write(const uint8_t *buf, size_t size)
+{
+    if (!f_)
+        return 0;
+    size_t n = fwrite(buf, 1, size, f_.get());
+    simFlashWrite(n);
+    return n;
+}
+
+size_t File::read(uint8_t *buf, size_t size)
+{
+    return f_ ? fread(buf, 1, size, f_.get()) : 0;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode)
+{
+    static const int whence[] = {SEEK_SET, SEEK_CUR, SEEK_END};
+    return f_ && fseek(f_.get(), (long)pos, whence[mode]) == 0;
+}
+
+size_t File::position() const
+{
+    return f_ ? (size_t)ftell(f_.get()) : 0;
+}
+
+size_t File::size() const
+{
+    if (!f_)
+        return 0;
+    struct stat st;
+    fflush(f_.get());
+    return fstat(fileno(f_.get()), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+void File::flush()
+{
+    if (f_)
+        fflush(f_.get());
+}
+
+bool LittleFSFS::begin(bool formatOnFail, const char *basePath, uint8_t maxOpenFiles, const char *partitionLabel)
+{
+    (void)formatOnFail, (void)basePath, (void)maxOpenFiles, (void)partitionLabel;
+    mkdir(simFlashDir(), 0755);
+    struct stat st;
+    return stat(simFlashDir(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool LittleFSFS::format()
+{
+    DIR *d = opendir(simFlashDir());
+    if (!d)
+        return false;
+    while (struct dirent *e = readdir(d))
+    {
+        if (e->d_name[0] != '.')
+            ::remove(hostPath(e->d_name).c_str());
+    }
+    closedir(d);
+    return true;
+}
+
+File LittleFSFS::open(const char *path, const char *mode)
+{
+    // "r+" on a missing file fails, as on the device
+    FILE *f = fopen(hostPath(path).c_str(), mode);
+    return f ? File(f) : File();
+}
+
+bool LittleFSFS::exists(const char *path)
+{
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool LittleFSFS::remove(const char *path)
+{
+    return ::remove(hostPath(path).c_str()) == 0;
+}
+
+size_t LittleFSFS::usedBytes()
+{
+    size_t used = 0;
+    DIR *d = opendir(simFlashDir());
+    if (!d)
+        return 0;
+    while (struct dirent *e = readdir(d))
+    {
+        struct stat st;
+        if (e->d_name[0] != '.' && stat(hostPath(e->d_name).c_str(), &st) == 0)
+            used += (size_t)st.st_size;
+    }
+    closedir(d);
+    return used;
+}
+
+} // namespace fs
@@ -0,0 +1,289 @@
+// Host entry point: runs the sketch's setup()/loop() against a recorded or
+// synthetic sensor trace on the virtual clock and prints a run summary.
+//
+//   .pio/build/native/program [--trace file.csv] [--minutes N] [--seed N]
+//                             [--step-us N] [--dump-trace out.csv] [--verbose]
+//                             [--flash-dir DIR] [--keep-flash] [--broker host:port]
+//                             [--heap BYTES]
+//   .pio/build/native/program --ring-stress N
+//   .pio/build/native/program --bench-publish N
+//   .pio/build/native/program --bench-rain N
+//   .pio/build/native/program --bench-suite [--baseline FILE] [--tolerance PCT]
+//                             [--gate-host] [--bench-update]
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include "config.h"
+#include "profiler.h"
+
+#include <chrono>
+
+void setup();
+void loop();
+void mqttSetPayloadFormat(uint8_t format);
+void mqttSetPublishPolicy(uint8_t policy);
+
+#define BENCH_BASELINE "lib/native_sim/bench_baseline.csv" // relative to the project directory
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --trace FILE       replay a CSV trace (t_ms,rain_raw,rain_d0,hall_hz,temp_c,humidity,pressure_hpa,link)\n"
+            "  --minutes N        length of the synthetic trace when no --trace is given (default 30)\n"
+            "  --seed N           seed for ADC noise (default 1)\n"
+            "  --noise N          ADC noise amplitude in counts (default 6)\n"
+            "  --step-us N        idle time between loop() calls (default 1000)\n"
+            "  --dump-trace FILE  write the trace in use as CSV and continue\n"
+            "  --verbose          echo the sketch's Serial output\n"
+            "  --flash-dir DIR    host directory behind LittleFS (default sim_flash)\n"
+            "  --keep-flash       keep the flash contents of the previous run (simulated reboot)\n"
+            "  --broker HOST:PORT mirror publishes/subscriptions onto a real broker, e.g. mosquitto\n"
+            "  --payload FMT      legacy (default), json or msgpack\n"
+            "  --publish POLICY   every (default) or change (values outside their deadband)\n"
+            "  --split-ms MS      inbound MQTT packets arrive as two TCP segments MS apart\n"
+            "  --uplink BPS       broker acknowledges BPS bytes/s; writes block once the TCP send buffer is full\n"
+            "  --tls-ticket S     broker accepts a TLS session ticket for S seconds (default 300; 0 = never resumes)\n"
+            "  --tls-wrong-ca     broker certificate chains to a CA other than the pinned one\n"
+            "  --heap BYTES       free heap when drawing starts (default 180000; small values force direct UI drawing)\n"
+            "  --inject S:TOPIC=PAYLOAD  deliver an MQTT message S seconds into the run (repeatable)\n"
+            "  --ring-stress N    push N items through SpscRing between two threads and exit\n"
+            "  --bench-publish N  time N mqttPublishData() cycles in each payload format and exit\n"
+            "  --bench-rain N     check N rain-pipeline updates against the floating-point model, time them and exit\n"
+            "  --bench-suite      time the sensor, publish and UI paths, compare with the baseline and exit\n"
+            "                     (non-zero if a metric grew by more than the tolerance)\n"
+            "  --baseline FILE    baseline for --bench-suite (default " BENCH_BASELINE ")\n"
+            "  --tolerance PCT    allowed growth per metric (default 5)\n"
+            "  --gate-host        also fail on host-time regressions (machine dependent, reported only by default)\n"
+            "  --bench-update     write the current results as the new baseline instead of checking\n",
+            argv0);
+}
+
+static bool dumpTrace(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return false;
+    fprintf(f, "t_ms,rain_raw,rain_d0,hall_hz,temp_c,humidity,pressure_hpa,link\n");
+    for (uint32_t t = 0; t <= simTraceEndMs(); t += 1000)
+    {
+        SimTraceRow r = simTraceAt(t);
+        fprintf(f, "%u,%.1f,%u,%.3f,%.2f,%.2f,%.2f,%u\n", r.tMs, r.rainRaw, r.rainD0,
+                r.hallHz, r.tempC, r.humidity, r.pressureHPa, r.link);
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *tracePath = nullptr;
+    const char *dumpPath = nullptr;
+    uint32_t minutes = 30;
+    uint32_t stepUs = 1000;
+    bool verbose = false;
+    bool keepFlash = false;
+    const char *broker = nullptr;
+    bool benchSuite = false;
+    bool benchUpdate = false;
+    bool gateHost = false;
+    const char *baseline = BENCH_BASELINE;
+    double tolerance = 5.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(a, "--trace") && hasValue)
+            tracePath = argv[++i];
+        else if (!strcmp(a, "--minutes") && hasValue)
+            minutes = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(a, "--seed") && hasValue)
+            simConfig().seed = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(a, "--noise") && hasValue)
+            simConfig().adcNoise = atoi(argv[++i]);
+        else if (!strcmp(a, "--step-us") && hasValue)
+            stepUs = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(a, "--dump-trace") && hasValue)
+            dumpPath = argv[++i];
+        else if (!strcmp(a, "--ring-stress") && hasValue)
+            return simRingStress((uint32_t)strtoul(argv[++i], nullptr, 10));
+        else if (!strcmp(a, "--bench-publish") && hasValue)
+            return simBenchPublish((uint32_t)strtoul(argv[++i], nullptr, 10));
+        else if (!strcmp(a, "--bench-rain") && hasValue)
+            return simBenchRain((uint32_t)strtoul(argv[++i], nullptr, 10));
+        else if (!strcmp(a, "--bench-suite"))
+            benchSuite = true;
+        else if (!strcmp(a, "--bench-update"))
+            benchUpdate = true;
+        else if (!strcmp(a, "--gate-host"))
+            gateHost = true;
+        else if (!strcmp(a, "--baseline") && hasValue)
+            baseline = argv[++i];
+        else if (!strcmp(a, "--tolerance") && hasValue)
+            tolerance = atof(argv[++i]);
+        else if (!strcmp(a, "--payload") && hasValue)
+        {
+            const char *fmt = argv[++i];
+            if (!strcmp(fmt, "json"))
+                mqttSetPayloadFormat(PAYLOAD_JSON);
+            else if (!strcmp(fmt, "msgpack"))
+                mqttSetPayloadFormat(PAYLOAD_MSGPACK);
+            else if (strcmp(fmt, "legacy"))
+            {
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        else if (!strcmp(a, "--publish") && hasValue)
+        {
+            const char *policy = argv[++i];
+            if (!strcmp(policy, "change"))
+                mqttSetPublishPolicy(PUBLISH_ON_CHANGE);
+            else if (strcmp(policy, "every"))
+            {
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        else if (!strcmp(a, "--split-ms") && hasValue)
+            simConfig().mqttSegmentGapMs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(a, "--uplink") && hasValue)
+            simConfig().uplinkBytesPerSec = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(a, "--tls-ticket") && hasValue)
+            simConfig().tlsTicketLifetimeS = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(a, "--tls-wrong-ca"))
+            simConfig().tlsWrongCa = true;
+        else if (!strcmp(a, "--heap") && hasValue)
+            simConfig().heapBytes = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(a, "--flash-dir") && hasValue)
+            simSetFlashDir(argv[++i]);
+        else if (!strcmp(a, "--inject") && hasValue)
+        {
+            const char *spec = argv[++i];
+            const char *colon = strchr(spec, ':'), *eq = colon ? strchr(colon, '=') : nullptr;
+            if (!eq)
+            {
+                usage(argv[0]);
+                return 2;
+            }
+            std::string topic(colon + 1, eq);
+            simMqttInject(topic.c_str(), eq + 1, (uint32_t)(atof(spec) * 1000));
+        }
+        else if (!strcmp(a, "--broker") && hasValue)
+            broker = argv[++i];
+        else if (!strcmp(a, "--keep-flash"))
+            keepFlash = true;
+        else if (!strcmp(a, "--verbose"))
+            verbose = true;
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    // A fresh run starts from erased flash; --keep-flash continues the last one
+    if (!keepFlash && LittleFS.begin(true))
+        LittleFS.format();
+
+    if (benchSuite)
+        return simBenchSuite(baseline, benchUpdate, tolerance, gateHost);
+
+    if (tracePath)
+    {
+        if (!simLoadTrace(tracePath))
+        {
+            fprintf(stderr, "cannot read trace %s\n", tracePath);
+            return 1;
+        }
+    }
+    else
+    {
+        simSyntheticTrace(minutes * 60000u);
+    }
+    if (dumpPath && !dumpTrace(dumpPath))
+    {
+        fprintf(stderr, "cannot write %s\n", dumpPath);
+        return 1;
+    }
+
+    if (broker && !simBridgeOpen(broker))
+    {
+        fprintf(stderr, "cannot connect to broker %s\n", broker);
+        return 1;
+    }
+
+    simSetQuiet(!verbose);
+    SimStats &st = simStats();
+    uint64_t endUs = (uint64_t)simTraceEndMs() * 1000;
+    auto wall0 = std::chrono::steady_clock::now();
+
+    setup();
+    while (simMicros() < endUs && !simRestartRequested())
+    {
+        loop();
+        st.loops++;
+        simAdvanceUs(stepUs);
+    }
+
+    double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+    double simS = simMicros() / 1e6;
+
+    printf("=== Simulation summary ===\n");
+    printf("simulated     %.1f s in %.3f s wall (%.0fx real time)\n", simS, wallS, wallS > 0 ? simS / wallS : 0.0);
+    if (simRestartRequested())
+        printf("restart       requested by the sketch at %.1f s, run stopped\n", simS);
+    printf("loop() calls  %u\n", st.loops);
+    printf("boot          ms:");
+    for (uint8_t i = 0; i < BOOT_MILESTONES; i++)
+    {
+        uint32_t ms = profBootMs((BootMilestone)i);
+        printf(ms ? " %s %lu" : " %s -", profBootName((BootMilestone)i), (unsigned long)ms);
+    }
+    printf("\n");
+    printf("delay()       %.1f ms (%.2f %% of simulated time)\n", st.delayUs / 1e3, 100.0 * st.delayUs / (simS * 1e6));
+    printf("serial        %llu bytes, blocked %.1f ms\n", (unsigned long long)st.serialBytes, st.serialUs / 1e3);
+    printf("adc           %u reads, %llu DMA samples, %llu dropped\n", st.adcReads,
+           (unsigned long long)st.adcDmaSamples, (unsigned long long)st.adcDmaDropped);
+    printf("hall edges    %u (%u interrupts)\n", st.hallEdges, st.hallInterrupts);
+    printf("servo writes  %u (final angle %d)\n", st.servoWrites, st.servoAngle);
+    printf("i2c           %u bytes, %.1f ms\n", st.i2cBytes, st.i2cUs / 1e3);
+    printf("tft           %u calls, %llu SPI bytes, %.1f ms blocked\n", st.tftCalls,
+           (unsigned long long)st.spiBytes, st.spiUs / 1e3);
+    printf("tft dma       %llu bytes, waited %.1f ms; sprites %u B, drawing %.1f ms\n",
+           (unsigned long long)st.spiDmaBytes, st.spiDmaWaitUs / 1e3, st.heapUsed, st.spriteUs / 1e3);
+    printf("mqtt          %u connects, %u failed, %u publishes, %llu bytes, digest %08x\n",
+           st.mqttConnects, st.mqttConnectFails, st.publishes,
+           (unsigned long long)st.publishBytes, st.publishDigest);
+    if (st.mqttConnects)
+        printf("connect       mean %.1f ms, longest %.1f ms (TCP connect to CONNACK)\n",
+               st.connectUs / 1e3 / st.mqttConnects, st.connectMaxUs / 1e3);
+    if (st.tlsFull || st.tlsResumed || st.tlsFailed)
+        printf("tls           %u full (mean %.1f ms), %u resumed (mean %.1f ms), %u failed; crypto %.1f ms\n",
+               st.tlsFull, st.tlsFull ? st.tlsFullUs / 1e3 / st.tlsFull : 0.0, st.tlsResumed,
+               st.tlsResumed ? st.tlsResumedUs / 1e3 / st.tlsResumed : 0.0, st.tlsFailed, st.tlsCpuUs / 1e3);
+    if (simConfig().mqttSegmentGapMs)
+        printf("split         %u ms: mqtt.loop() waited %.1f ms for packets (longest %.1f ms)\n",
+               simConfig().mqttSegmentGapMs, st.mqttLoopBlockedUs / 1e3, st.mqttLoopBlockedMaxUs / 1e3);
+    if (simConfig().uplinkBytesPerSec)
+        printf("uplink        %u B/s: socket writes blocked %.1f ms (longest %.1f ms)\n",
+               simConfig().uplinkBytesPerSec, st.sendBlockedUs / 1e3, st.sendBlockedMaxUs / 1e3);
+    printf("backlog       %u messages, %u samples\n", st.backlogMessages, st.backlogSamples);
+    printf("flash         %u writes, %llu bytes, %.1f ms\n", st.flashWrites,
+           (unsigned long long)st.flashBytes, st.flashUs / 1e3);
+    if (st.ulpRuns || st.sleeps)
+    {
+        // Duty cycle and the current it implies (SimConfig supply model)
+        const SimConfig &cfg = simConfig();
+        double awakeS = simS - st.sleepUs / 1e6, ulpS = st.ulpBusyNs / 1e9;
+        double mA = simS > 0 ? (awakeS * cfg.awakeMa + st.sleepUs / 1e6 * cfg.lightSleepMa + ulpS * cfg.ulpMa) / simS : 0.0;
+        printf("power         awake %.1f s (%.2f %% duty), %u sleeps: %u timer, %u ULP wakes\n", awakeS,
+               100.0 * awakeS / simS, st.sleeps, st.timerWakes, st.ulpWakes);
+        printf("ulp           %u runs, busy %.2f %%, %u ADC1 conflicts; modelled mean %.2f mA (always awake %.1f mA)\n",
+               st.ulpRuns, 100.0 * ulpS / simS, st.adcConflicts, mA, cfg.awakeMa);
+        printf("radio         %u WiFi joins, %u associations lost in light sleep\n", st.wifiJoins, st.wifiSleepDrops);
+    }
+    return 0;
+}
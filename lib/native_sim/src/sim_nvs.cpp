@@ -0,0 +1,107 @@
+// Preferences (NVS) stand-in over a host file per namespace: one line per
+// key, "key hexbytes"
+
+#include <Preferences.h>
+
+#include <string.h>
+
+static const uint32_t ENTRY_BYTES = 32;   // one NVS entry
+static const size_t HOST_MAX_BLOB = 511;   // hex line read back below
+
+bool Preferences::begin(const char *name, bool readOnly, const char *partitionLabel)
+{
+    (void)partitionLabel;
+    if (strlen(name) > 15)
+        return false; // NVS_KEY_NAME_MAX_SIZE - 1
+    path_ = std::string(simFlashDir()) + "/nvs_" + name;
+    values_.clear();
+    readOnly_ = readOnly;
+    open_ = true;
+    FILE *f = fopen(path_.c_str(), "r");
+    if (!f)
+        return true; // empty namespace
+    char key[16], hex[1024];
+    while (fscanf(f, "%15s %1023s", key, hex) == 2)
+    {
+        std::vector<uint8_t> bytes;
+        for (size_t i = 0; hex[i] && hex[i + 1]; i += 2)
+        {
+            unsigned b;
+            sscanf(hex + i, "%2x", &b);
+            bytes.push_back((uint8_t)b);
+        }
+        values_[key] = bytes;
+    }
+    fclose(f);
+    return true;
+}
+
+void Preferences::end()
+{
+    open_ = false;
+    values_.clear();
+}
+
+bool Preferences::save()
+{
+    FILE *f = fopen(path_.c_str(), "w");
+    if (!f)
+        return false;
+    for (const auto &kv : values_)
+    {
+        fprintf(f, "%s ", kv.first.c_str());
+        for (uint8_t b : kv.second)
+            fprintf(f, "%02x", b);
+        fprintf(f, "\n");
+    }
+    fclose(f);
+    simFlashWrite(ENTRY_BYTES);
+    return true;
+}
+
+bool Preferences::clear()
+{
+    if (!open_ || readOnly_)
+        return false;
+    values_.clear();
+    return save();
+}
+
+bool Preferences::remove(const char *key)
+{
+    if (!open_ || readOnly_ || !values_.erase(key))
+        return false;
+    return save();
+}
+
+bool Preferences::isKey(const char *key)
+{
+    return open_ && values_.count(key);
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len)
+{
+    if (!open_ || readOnly_ || strlen(key) > 15 || len == 0 || len > HOST_MAX_BLOB)
+        return 0;
+    std::vector<uint8_t> bytes((const uint8_t *)value, (const uint8_t *)value + len);
+    auto it = values_.find(key);
+    if (it != values_.end() && it->second == bytes)
+        return len; // NVS skips unchanged values too
+    values_[key] = bytes;
+    return save() ? len : 0;
+}
+
+size_t Preferences::getBytesLength(const char *key)
+{
+    auto it = values_.find(key);
+    return open_ && it != values_.end() ? it->second.size() : 0;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen)
+{
+    size_t len = getBytesLength(key);
+    if (len == 0 || len > maxLen)
+        return 0;
+    memcpy(buf, values_[key].data(), len);
+    return len;
+}
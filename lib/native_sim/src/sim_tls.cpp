@@ -0,0 +1,507 @@
+// mbedTLS stand-ins over a model of a mosquitto TLS listener (TLS 1.2,
+// session tickets on, OpenSSL defaults). Nothing is encrypted: the model
+// charges the station's crypto on the virtual clock, the handshake flights
+// to the socket and one round trip per flight, and checks the pinned CA by
+// fingerprint against the CA the broker certificate chains to (the one in
+// include/mqtt_ca.h, unless --tls-wrong-ca).
+//
+//   full:    ClientHello -> [RTT] -> verify chain + ECDHE -> Finished -> [RTT]
+//   resumed: ClientHello + ticket -> [RTT] -> Finished (MACs only)
+
+#include "sim.h"
+#include "config.h"
+#include "mqtt_ca.h"
+
+#include <lwip/sockets.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/error.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+
+#include <string.h>
+
+enum
+{
+    HS_HELLO,          // send ClientHello (offering the session, if any)
+    HS_SERVER_HELLO,   // waiting for the broker's first flight
+    HS_SERVER_FINISH,  // full handshake: waiting for the broker's Finished
+    HS_DONE,
+    HS_FAILED
+};
+
+static const uint32_t CLIENT_HELLO_BYTES = 190;
+static const uint32_t TICKET_BYTES = 180;
+static const uint32_t CLIENT_KEYX_BYTES = 140; // ClientKeyExchange, ChangeCipherSpec, Finished
+static const uint32_t CLIENT_FINISH_BYTES = 51; // ChangeCipherSpec, Finished
+static const uint32_t RECORD_OVERHEAD = 29;     // header, explicit nonce, GCM tag
+static const uint32_t SESSION_MAGIC = 0x53455353;
+
+static int g_sessionFd = -1;   // socket with a finished handshake
+static uint32_t g_nextTicket = 1;
+
+static uint32_t fnv1a(const unsigned char *p, size_t n)
+{
+    uint32_t h = 2166136261u;
+    while (n--)
+        h = (h ^ *p++) * 16777619u;
+    return h;
+}
+
+// The CA that signed the broker certificate
+static uint32_t brokerCaFingerprint()
+{
+    uint32_t fp = fnv1a((const unsigned char *)MQTT_CA_PEM, sizeof(MQTT_CA_PEM));
+    return simConfig().tlsWrongCa ? ~fp : fp;
+}
+
+// Broker clock; tickets carry their time of issue
+static uint32_t brokerEpoch()
+{
+    return simConfig().epochStart + (uint32_t)(simMicros() / 1000000);
+}
+
+// A --keep-flash rerun starts the clock over, so a ticket from the previous
+// run looks issued in the future; it counts as fresh
+static bool ticketValid(const mbedtls_ssl_session &s)
+{
+    uint32_t lifetime = simConfig().tlsTicketLifetimeS;
+    return s.ticket != 0 && lifetime > 0 && (int32_t)(brokerEpoch() - s.ticketEpoch) < (int32_t)lifetime;
+}
+
+static void randomBytes(unsigned char *p, size_t n)
+{
+    while (n--)
+        *p++ = (unsigned char)simRandom(256);
+}
+
+static int sslFd(const mbedtls_ssl_context *ssl)
+{
+    return ssl->p_bio ? ((const mbedtls_net_context *)ssl->p_bio)->fd : -1;
+}
+
+uint32_t simTlsRecordOverhead(int fd)
+{
+    return fd >= 0 && fd == g_sessionFd ? RECORD_OVERHEAD : 0;
+}
+
+// =================== Entropy, DRBG, certificates ===================
+
+void mbedtls_entropy_init(mbedtls_entropy_context *ctx)
+{
+    ctx->sources = 1;
+}
+
+void mbedtls_entropy_free(mbedtls_entropy_context *ctx)
+{
+    ctx->sources = 0;
+}
+
+int mbedtls_entropy_func(void *data, unsigned char *output, size_t len)
+{
+    (void)data;
+    randomBytes(output, len);
+    return 0;
+}
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context *ctx)
+{
+    ctx->seeded = 0;
+}
+
+void mbedtls_ctr_drbg_free(mbedtls_ctr_drbg_context *ctx)
+{
+    ctx->seeded = 0;
+}
+
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context *ctx, int (*f_entropy)(void *, unsigned char *, size_t),
+                          void *p_entropy, const unsigned char *custom, size_t len)
+{
+    (void)custom, (void)len;
+    unsigned char seed[48];
+    ctx->seeded = f_entropy(p_entropy, seed, sizeof(seed)) == 0;
+    return ctx->seeded ? 0 : -0x0034; // MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED
+}
+
+int mbedtls_ctr_drbg_random(void *p_rng, unsigned char *output, size_t output_len)
+{
+    (void)p_rng;
+    randomBytes(output, output_len);
+    return 0;
+}
+
+void mbedtls_x509_crt_init(mbedtls_x509_crt *crt)
+{
+    crt->fingerprint = 0;
+    crt->parsed = 0;
+}
+
+void mbedtls_x509_crt_free(mbedtls_x509_crt *crt)
+{
+    mbedtls_x509_crt_init(crt);
+}
+
+int mbedtls_x509_crt_parse(mbedtls_x509_crt *chain, const unsigned char *buf, size_t buflen)
+{
+    // Like mbedTLS: PEM only with the terminating NUL counted in buflen
+    if (buflen == 0 || buf[buflen - 1] != '\0' || !strstr((const char *)buf, "-----BEGIN CERTIFICATE-----") ||
+        !strstr((const char *)buf, "-----END CERTIFICATE-----"))
+        return MBEDTLS_ERR_X509_INVALID_FORMAT;
+    chain->fingerprint = fnv1a(buf, buflen);
+    chain->parsed = 1;
+    return 0;
+}
+
+void mbedtls_strerror(int errnum, char *buffer, size_t buflen)
+{
+    const char *text;
+    switch (errnum)
+    {
+    case MBEDTLS_ERR_SSL_WANT_READ:
+        text = "SSL - No data of requested type currently available on underlying transport";
+        break;
+    case MBEDTLS_ERR_SSL_WANT_WRITE:
+        text = "SSL - Connection requires a write call";
+        break;
+    case MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY:
+        text = "SSL - The peer notified us that the connection is going to be closed";
+        break;
+    case MBEDTLS_ERR_SSL_BAD_INPUT_DATA:
+        text = "SSL - Bad input parameters to function";
+        break;
+    case MBEDTLS_ERR_X509_CERT_VERIFY_FAILED:
+        text = "X509 - Certificate verification failed, e.g. CRL, CA or signature check failed";
+        break;
+    case MBEDTLS_ERR_X509_INVALID_FORMAT:
+        text = "X509 - The CRT/CRL/CSR format is invalid, e.g. different type expected";
+        break;
+    case MBEDTLS_ERR_NET_CONN_RESET:
+        text = "NET - Connection was reset by peer";
+        break;
+    default:
+        text = "UNKNOWN ERROR CODE";
+        break;
+    }
+    snprintf(buffer, buflen, "%s", text);
+}
+
+// =================== Transport ===================
+
+void mbedtls_net_init(mbedtls_net_context *ctx)
+{
+    ctx->fd = -1;
+}
+
+void mbedtls_net_free(mbedtls_net_context *ctx)
+{
+    if (ctx->fd >= 0)
+        lwip_close(ctx->fd);
+    if (ctx->fd == g_sessionFd)
+        g_sessionFd = -1;
+    ctx->fd = -1;
+}
+
+int mbedtls_net_set_nonblock(mbedtls_net_context *ctx)
+{
+    (void)ctx; // every simulated socket is non-blocking
+    return 0;
+}
+
+// Records are charged by the handshake model and PubSubClient; these only
+// exist to be passed to mbedtls_ssl_set_bio()
+int mbedtls_net_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    (void)ctx, (void)buf;
+    return (int)len;
+}
+
+int mbedtls_net_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    (void)ctx, (void)buf, (void)len;
+    return MBEDTLS_ERR_SSL_WANT_READ;
+}
+
+// =================== SSL configuration and context ===================
+
+void mbedtls_ssl_config_init(mbedtls_ssl_config *conf)
+{
+    memset(conf, 0, sizeof(*conf));
+}
+
+void mbedtls_ssl_config_free(mbedtls_ssl_config *conf)
+{
+    mbedtls_ssl_config_init(conf);
+}
+
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config *conf, int endpoint, int transport, int preset)
+{
+    (void)endpoint, (void)transport, (void)preset;
+    conf->authmode = MBEDTLS_SSL_VERIFY_REQUIRED;
+    return 0;
+}
+
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config *conf, int authmode)
+{
+    conf->authmode = authmode;
+}
+
+void mbedtls_ssl_conf_ca_chain(mbedtls_ssl_config *conf, mbedtls_x509_crt *ca_chain, mbedtls_x509_crl *ca_crl)
+{
+    (void)ca_crl;
+    conf->ca_chain = ca_chain;
+}
+
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config *conf, int (*f_rng)(void *, unsigned char *, size_t), void *p_rng)
+{
+    (void)conf, (void)f_rng, (void)p_rng;
+}
+
+void mbedtls_ssl_conf_verify(mbedtls_ssl_config *conf, int (*f_vrfy)(void *, mbedtls_x509_crt *, int, uint32_t *),
+                             void *p_vrfy)
+{
+    conf->f_vrfy = f_vrfy;
+    conf->p_vrfy = p_vrfy;
+}
+
+void mbedtls_ssl_conf_session_tickets(mbedtls_ssl_config *conf, int use_tickets)
+{
+    conf->tickets = use_tickets;
+}
+
+void mbedtls_ssl_init(mbedtls_ssl_context *ssl)
+{
+    memset(ssl, 0, sizeof(*ssl));
+}
+
+void mbedtls_ssl_free(mbedtls_ssl_context *ssl)
+{
+    mbedtls_ssl_init(ssl);
+}
+
+int mbedtls_ssl_setup(mbedtls_ssl_context *ssl, const mbedtls_ssl_config *conf)
+{
+    ssl->conf = conf;
+    return 0;
+}
+
+int mbedtls_ssl_session_reset(mbedtls_ssl_context *ssl)
+{
+    if (sslFd(ssl) == g_sessionFd)
+        g_sessionFd = -1;
+    const mbedtls_ssl_config *conf = ssl->conf;
+    mbedtls_ssl_init(ssl);
+    ssl->conf = conf;
+    return 0;
+}
+
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context *ssl, const char *hostname)
+{
+    (void)ssl; // the broker model has a single name
+    return hostname && strlen(hostname) <= 255 ? 0 : MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+}
+
+void mbedtls_ssl_set_bio(mbedtls_ssl_context *ssl, void *p_bio, mbedtls_ssl_send_t *f_send,
+                         mbedtls_ssl_recv_t *f_recv, mbedtls_ssl_recv_timeout_t *f_recv_timeout)
+{
+    (void)f_send, (void)f_recv, (void)f_recv_timeout;
+    ssl->p_bio = p_bio;
+}
+
+int mbedtls_ssl_set_session(mbedtls_ssl_context *ssl, const mbedtls_ssl_session *session)
+{
+    if (!session || ssl->state != HS_HELLO)
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    ssl->offered = *session;
+    ssl->haveOffered = 1;
+    return 0;
+}
+
+int mbedtls_ssl_get_session(const mbedtls_ssl_context *ssl, mbedtls_ssl_session *session)
+{
+    if (ssl->state != HS_DONE)
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    *session = ssl->session;
+    return 0;
+}
+
+static void finishHandshake(mbedtls_ssl_context *ssl, bool resumed)
+{
+    SimStats &st = simStats();
+    uint64_t took = simMicros() - ssl->startUs;
+    if (resumed)
+    {
+        st.tlsResumed++;
+        st.tlsResumedUs += took;
+    }
+    else
+    {
+        st.tlsFull++;
+        st.tlsFullUs += took;
+    }
+    ssl->state = HS_DONE;
+    g_sessionFd = sslFd(ssl);
+}
+
+int mbedtls_ssl_handshake(mbedtls_ssl_context *ssl)
+{
+    const SimConfig &cfg = simConfig();
+    SimStats &st = simStats();
+    int fd = sslFd(ssl);
+    if (ssl->state == HS_DONE)
+        return 0;
+    if (ssl->state == HS_FAILED)
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    if (!simSocketConnected(fd))
+    {
+        ssl->state = HS_FAILED;
+        st.tlsFailed++;
+        return MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    uint64_t rttUs = (uint64_t)cfg.tcpConnectMs * 1000;
+
+    switch (ssl->state)
+    {
+    case HS_HELLO:
+    {
+        ssl->startUs = simMicros();
+        bool ticket = ssl->haveOffered && ssl->offered.ticket != 0;
+        simSocketSend(fd, CLIENT_HELLO_BYTES + (ticket ? TICKET_BYTES : 0));
+        ssl->resuming = ticket && ssl->conf->tickets && ticketValid(ssl->offered);
+        ssl->waitUntilUs = simMicros() + rttUs;
+        ssl->state = HS_SERVER_HELLO;
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+
+    case HS_SERVER_HELLO:
+        if (simMicros() < ssl->waitUntilUs)
+            return MBEDTLS_ERR_SSL_WANT_READ;
+        if (ssl->resuming)
+        {
+            // ServerHello, ChangeCipherSpec, Finished: keys come from the ticket
+            simAdvanceUs(cfg.tlsResumeUs);
+            st.tlsCpuUs += cfg.tlsResumeUs;
+            simSocketSend(fd, CLIENT_FINISH_BYTES);
+            ssl->session = ssl->offered;
+            finishHandshake(ssl, true);
+            return 0;
+        }
+        // ServerHello, Certificate, ServerKeyExchange, ServerHelloDone
+        simAdvanceUs((uint64_t)cfg.tlsVerifyMs * 1000);
+        st.tlsCpuUs += (uint64_t)cfg.tlsVerifyMs * 1000;
+        // The broker sends its certificate alone: one callback, depth 0
+        ssl->verifyResult = !ssl->conf->ca_chain || !ssl->conf->ca_chain->parsed ||
+                                    ssl->conf->ca_chain->fingerprint != brokerCaFingerprint()
+                                ? MBEDTLS_X509_BADCERT_NOT_TRUSTED
+                                : 0;
+        if (ssl->conf->f_vrfy)
+        {
+            mbedtls_x509_crt peer = {brokerCaFingerprint(), 1};
+            if (ssl->conf->f_vrfy(ssl->conf->p_vrfy, &peer, 0, &ssl->verifyResult) != 0)
+            {
+                ssl->state = HS_FAILED;
+                st.tlsFailed++;
+                return MBEDTLS_ERR_X509_CERT_VERIFY_FAILED;
+            }
+        }
+        if (ssl->verifyResult != 0)
+        {
+            ssl->state = HS_FAILED;
+            st.tlsFailed++;
+            return MBEDTLS_ERR_X509_CERT_VERIFY_FAILED;
+        }
+        simAdvanceUs((uint64_t)cfg.tlsKeyExchangeMs * 1000);
+        st.tlsCpuUs += (uint64_t)cfg.tlsKeyExchangeMs * 1000;
+        simSocketSend(fd, CLIENT_KEYX_BYTES);
+        ssl->waitUntilUs = simMicros() + rttUs;
+        ssl->state = HS_SERVER_FINISH;
+        return MBEDTLS_ERR_SSL_WANT_READ;
+
+    case HS_SERVER_FINISH:
+        if (simMicros() < ssl->waitUntilUs)
+            return MBEDTLS_ERR_SSL_WANT_READ;
+        // NewSessionTicket, ChangeCipherSpec, Finished
+        mbedtls_ssl_session_init(&ssl->session);
+        randomBytes(ssl->session.id, sizeof(ssl->session.id));
+        ssl->session.id_len = sizeof(ssl->session.id);
+        randomBytes(ssl->session.master, sizeof(ssl->session.master));
+        if (ssl->conf->tickets && cfg.tlsTicketLifetimeS)
+        {
+            ssl->session.ticket = g_nextTicket++;
+            ssl->session.ticketEpoch = brokerEpoch();
+        }
+        finishHandshake(ssl, false);
+        return 0;
+    }
+    return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+}
+
+uint32_t mbedtls_ssl_get_verify_result(const mbedtls_ssl_context *ssl)
+{
+    return ssl->state == HS_DONE || ssl->state == HS_FAILED ? ssl->verifyResult : (uint32_t)-1;
+}
+
+// Records pass the socket's inbound bytes through as they are; outbound
+// publishes are charged by the PubSubClient stand-in, apart from CONNECT
+// (simSocketMqttConnect())
+int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len)
+{
+    int fd = sslFd(ssl);
+    if (ssl->state != HS_DONE || !simSocketConnected(fd))
+        return MBEDTLS_ERR_NET_CONN_RESET;
+    if (simSocketAvailable(fd) == 0)
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    return len ? simSocketRead(fd, buf, len) : 0;
+}
+
+int mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len)
+{
+    int fd = sslFd(ssl);
+    if (ssl->state != HS_DONE || !simSocketConnected(fd))
+        return MBEDTLS_ERR_NET_CONN_RESET;
+    if (len > 0 && buf[0] == 0x10)
+        simSocketMqttConnect(fd, (uint32_t)len + RECORD_OVERHEAD);
+    return (int)len;
+}
+
+size_t mbedtls_ssl_get_bytes_avail(const mbedtls_ssl_context *ssl)
+{
+    return ssl->state == HS_DONE ? (size_t)simSocketAvailable(sslFd(ssl)) : 0;
+}
+
+int mbedtls_ssl_close_notify(mbedtls_ssl_context *ssl)
+{
+    if (ssl->state == HS_DONE && simSocketConnected(sslFd(ssl)))
+        simSocketSend(sslFd(ssl), 2 + RECORD_OVERHEAD);
+    return 0;
+}
+
+// =================== Sessions ===================
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session *session)
+{
+    memset(session, 0, sizeof(*session));
+}
+
+void mbedtls_ssl_session_free(mbedtls_ssl_session *session)
+{
+    mbedtls_ssl_session_init(session);
+}
+
+int mbedtls_ssl_session_save(const mbedtls_ssl_session *session, unsigned char *buf, size_t buf_len, size_t *olen)
+{
+    *olen = sizeof(SESSION_MAGIC) + sizeof(*session);
+    if (buf_len < *olen)
+        return MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+    memcpy(buf, &SESSION_MAGIC, sizeof(SESSION_MAGIC));
+    memcpy(buf + sizeof(SESSION_MAGIC), session, sizeof(*session));
+    return 0;
+}
+
+int mbedtls_ssl_session_load(mbedtls_ssl_session *session, const unsigned char *buf, size_t len)
+{
+    if (len != sizeof(SESSION_MAGIC) + sizeof(*session) || memcmp(buf, &SESSION_MAGIC, sizeof(SESSION_MAGIC)) != 0)
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    memcpy(session, buf + sizeof(SESSION_MAGIC), sizeof(*session));
+    return 0;
+}
@@ -0,0 +1,274 @@
+// ULP FSM interpreter, RTC GPIO and light sleep on the virtual clock.
+// The program the sketch loads with ulp_process_macros_and_load() runs
+// here every ulp_set_wakeup_period(), reading HALL_PIN and RAIN_D0 levels
+// and RAIN_A0 conversions from the trace; I_WAKE ends a light sleep.
+
+#include "sim.h"
+#include "config.h"
+
+#include <Arduino.h>
+#include <driver/rtc_io.h>
+#include <esp32/ulp.h>
+#include <esp_sleep.h>
+#include <soc/rtc_io_reg.h>
+
+#include <vector>
+
+uint32_t simRtcSlowMem[2048];
+
+static std::vector<ulp_insn_t> g_program; // labels resolved to indices, M_LABEL entries dropped
+static uint32_t g_loadAddr = 0;
+static uint32_t g_periodUs = 0;
+static bool g_running = false;
+static uint64_t g_nextUs = 0;
+
+static bool g_asleep = false;
+static bool g_ulpWoke = false;
+static bool g_ulpWakeEnabled = false;
+static uint64_t g_timerWakeUs = 0; // 0 = no timer wakeup
+static esp_sleep_wakeup_cause_t g_cause = ESP_SLEEP_WAKEUP_UNDEFINED;
+static bool g_adc1Ulp = true; // SAR1 controller: the ULP, or the cores after an analogRead()
+
+// GPIO → RTC GPIO (ESP32 datasheet, IO_MUX / RTC_MUX table)
+int rtc_io_number_get(gpio_num_t gpio_num)
+{
+    static const int8_t map[40] = {11, -1, 12, -1, 10, -1, -1, -1, -1, -1, -1, -1, 15, 14, 16, 13, -1, -1, -1, -1,
+                                   -1, -1, -1, -1, -1, 6,  7,  17, -1, -1, -1, -1, 9,  8,  4,  5,  0,  1,  2,  3};
+    int g = (int)gpio_num;
+    return g >= 0 && g < 40 ? map[g] : -1;
+}
+
+esp_err_t rtc_gpio_init(gpio_num_t gpio_num)
+{
+    return rtc_io_number_get(gpio_num) >= 0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+// RTC_GPIO_IN_REG: the pins the sim models, everything else idles high
+static uint32_t rtcGpioIn()
+{
+    uint32_t v = 0x3FFFFu << RTC_GPIO_IN_NEXT_S;
+    auto put = [&v](int pin, int level) {
+        int bit = RTC_GPIO_IN_NEXT_S + rtc_io_number_get((gpio_num_t)pin);
+        v = level ? v | (1u << bit) : v & ~(1u << bit);
+    };
+    put(HALL_PIN, simHallLevel());
+    put(RAIN_D0, simDigitalRead(RAIN_D0));
+    return v;
+}
+
+esp_err_t ulp_process_macros_and_load(uint32_t load_addr, const ulp_insn_t *program, size_t *psize)
+{
+    if (!program || !psize || load_addr >= 2048)
+        return ESP_ERR_INVALID_ARG;
+    std::vector<int> labels;
+    g_program.clear();
+    for (size_t i = 0; i < *psize; i++)
+    {
+        if (program[i].op != ULP_OP_LABEL)
+        {
+            g_program.push_back(program[i]);
+            continue;
+        }
+        size_t n = (size_t)program[i].imm;
+        if (labels.size() <= n)
+            labels.resize(n + 1, -1);
+        labels[n] = (int)g_program.size();
+    }
+    for (ulp_insn_t &in : g_program)
+    {
+        if (in.op < ULP_OP_BL || in.op > ULP_OP_BXF)
+            continue;
+        if (in.imm < 0 || (size_t)in.imm >= labels.size() || labels[in.imm] < 0)
+            return ESP_ERR_INVALID_ARG; // undefined label
+        in.imm = labels[in.imm];
+    }
+    if (load_addr + g_program.size() > 2048)
+        return ESP_ERR_INVALID_ARG;
+    g_loadAddr = load_addr;
+    *psize = g_program.size();
+    return ESP_OK;
+}
+
+esp_err_t ulp_set_wakeup_period(size_t period_index, uint32_t period_us)
+{
+    if (period_index != 0 || period_us == 0)
+        return ESP_ERR_INVALID_ARG;
+    g_periodUs = period_us;
+    return ESP_OK;
+}
+
+esp_err_t ulp_run(uint32_t entry_point)
+{
+    if (g_program.empty() || entry_point != g_loadAddr || g_periodUs == 0)
+        return ESP_ERR_INVALID_STATE;
+    g_running = true;
+    g_nextUs = simMicros();
+    return ESP_OK;
+}
+
+bool simUlpRunning()
+{
+    return g_running;
+}
+
+uint64_t simUlpNextUs()
+{
+    return g_running ? g_nextUs : UINT64_MAX;
+}
+
+void simUlpRun()
+{
+    uint16_t r[4] = {0, 0, 0, 0};
+    bool zero = false, overflow = false;
+    uint64_t ns = 0;
+    auto alu = [&](uint8_t rd, uint32_t result, bool borrow) {
+        r[rd] = (uint16_t)result;
+        zero = r[rd] == 0;
+        overflow = borrow || result > 0xFFFF;
+    };
+
+    size_t pc = 0;
+    for (uint32_t steps = 0; pc < g_program.size() && steps < 10000; steps++)
+    {
+        const ulp_insn_t &in = g_program[pc++];
+        ns += simConfig().ulpInstrNs;
+        switch (in.op)
+        {
+        case ULP_OP_MOVI:
+            alu(in.a, (uint16_t)in.imm, false);
+            break;
+        case ULP_OP_MOVR:
+            alu(in.a, r[in.b], false);
+            break;
+        case ULP_OP_ADDI:
+            alu(in.a, (uint32_t)r[in.b] + (uint16_t)in.imm, false);
+            break;
+        case ULP_OP_SUBI:
+            alu(in.a, (uint32_t)r[in.b] - (uint16_t)in.imm, r[in.b] < (uint16_t)in.imm);
+            break;
+        case ULP_OP_ADDR:
+            alu(in.a, (uint32_t)r[in.b] + r[in.c], false);
+            break;
+        case ULP_OP_SUBR:
+            alu(in.a, (uint32_t)r[in.b] - r[in.c], r[in.b] < r[in.c]);
+            break;
+        case ULP_OP_LD:
+            r[in.a] = (uint16_t)(simRtcSlowMem[(r[in.b] + in.imm) & 2047] & 0xFFFF);
+            break;
+        case ULP_OP_ST:
+            // The hardware puts the PC into the upper half; the sketch must mask it off
+            simRtcSlowMem[(r[in.b] + in.imm) & 2047] = ((uint32_t)(pc - 1 + g_loadAddr) << 21) | r[in.a];
+            break;
+        case ULP_OP_RD_REG:
+        {
+            uint32_t v = in.reg == RTC_GPIO_IN_REG ? rtcGpioIn() : 0;
+            uint32_t width = in.b - in.a + 1;
+            r[0] = (uint16_t)((v >> in.a) & ((1u << width) - 1));
+            break;
+        }
+        case ULP_OP_ADC:
+            if (!g_adc1Ulp)
+                simStats().adcConflicts++; // on the chip a garbage reading, or a corrupted one on the cores' side
+            r[in.a] = in.b == 0 && in.c == 6 ? (uint16_t)simAdcSample(RAIN_A0, millis()) : 0; // ADC1 pad 6 = GPIO34
+            ns += (uint64_t)simConfig().ulpAdcUs * 1000;
+            break;
+        case ULP_OP_BL:
+            if (r[0] < in.reg)
+                pc = (size_t)in.imm;
+            break;
+        case ULP_OP_BGE:
+            if (r[0] >= in.reg)
+                pc = (size_t)in.imm;
+            break;
+        case ULP_OP_BX:
+            pc = (size_t)in.imm;
+            break;
+        case ULP_OP_BXZ:
+            if (zero)
+                pc = (size_t)in.imm;
+            break;
+        case ULP_OP_BXF:
+            if (overflow)
+                pc = (size_t)in.imm;
+            break;
+        case ULP_OP_WAKE:
+            if (g_asleep)
+                g_ulpWoke = true; // ignored while the cores are awake
+            break;
+        case ULP_OP_HALT:
+            pc = g_program.size();
+            break;
+        }
+    }
+
+    SimStats &st = simStats();
+    st.ulpRuns++;
+    st.ulpBusyNs += ns;
+    g_nextUs += g_periodUs;
+}
+
+void simAdc1Owner(bool ulp)
+{
+    g_adc1Ulp = ulp;
+}
+
+void adc1_ulp_enable()
+{
+    simAdc1Owner(true);
+}
+
+// =================== Light sleep ===================
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us)
+{
+    g_timerWakeUs = time_in_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_ulp_wakeup()
+{
+    g_ulpWakeEnabled = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_light_sleep_start()
+{
+    uint64_t t0 = simMicros();
+    uint64_t until = g_timerWakeUs ? t0 + g_timerWakeUs : UINT64_MAX;
+    if (until == UINT64_MAX && !(g_ulpWakeEnabled && g_running))
+        return ESP_ERR_INVALID_STATE; // nothing would ever wake it
+
+    // The RF is off in light sleep: the station misses its beacons and
+    // keepalives, so past wifiSleepDropMs the AP has dropped it
+    bool associated = simWifiConnected();
+    g_asleep = true;
+    g_ulpWoke = false;
+    while (simMicros() < until && !(g_ulpWakeEnabled && g_ulpWoke))
+        simAdvanceUs(std::min<uint64_t>(until - simMicros(), 1000));
+    g_asleep = false;
+
+    SimStats &st = simStats();
+    if (associated && simMicros() - t0 >= (uint64_t)simConfig().wifiSleepDropMs * 1000)
+    {
+        st.wifiSleepDrops++;
+        simWifiLeave();
+    }
+    st.sleeps++;
+    st.sleepUs += simMicros() - t0;
+    if (g_ulpWoke && g_ulpWakeEnabled)
+    {
+        g_cause = ESP_SLEEP_WAKEUP_ULP;
+        st.ulpWakes++;
+    }
+    else
+    {
+        g_cause = ESP_SLEEP_WAKEUP_TIMER;
+        st.timerWakes++;
+    }
+    return ESP_OK;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause()
+{
+    return g_cause;
+}
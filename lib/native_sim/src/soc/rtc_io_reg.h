@@ -0,0 +1,9 @@
+#ifndef NATIVE_SIM_SOC_RTC_IO_REG_H
+#define NATIVE_SIM_SOC_RTC_IO_REG_H
+
+// RTC GPIO input levels; RTC GPIO n is bit RTC_GPIO_IN_NEXT_S + n
+#define DR_REG_RTCIO_BASE 0x3ff48400
+#define RTC_GPIO_IN_REG (DR_REG_RTCIO_BASE + 0x24)
+#define RTC_GPIO_IN_NEXT_S 14
+
+#endif // NATIVE_SIM_SOC_RTC_IO_REG_H
@@ -0,0 +1,94 @@
+#ifndef RAIN_FILTER_H
+#define RAIN_FILTER_H
+
+#include <stdint.h>
+
+#include "config.h"
+
+// Integer wetness pipeline behind rain_sensor.cpp: references in raw ADC
+// counts, wetness and its easing in Q7.8 percent (value / 256 = %), easing
+// factors in Q0.8. Every subtraction that could go below zero saturates,
+// every quotient truncates and every shift floors, so a floating-point
+// model doing the same steps in exact arithmetic matches it bit for bit
+// (sim --bench-rain checks that). Thresholds and easing come in a
+// RainTuning, so they can change between updates (runtime settings).
+
+static const int32_t RAIN_PCT_ONE = 100 << 8; // 100 % in Q7.8
+
+static_assert((-1 >> 1) == -1, "easing relies on an arithmetic right shift");
+static_assert(PCT_EASE_WET_Q8 > 0 && PCT_EASE_WET_Q8 <= 256 && PCT_EASE_DRY_Q8 > 0 && PCT_EASE_DRY_Q8 <= 256,
+              "easing factors are Q0.8 in (0, 1]");
+
+struct RainTuning
+{
+    uint16_t wetMargin;   // initial wet reference below a fresh dry one
+    uint16_t triggerDrop; // raw below dryRef by more than this is wet
+    uint16_t dryHyst;     // dry drift window below dryRef
+    uint16_t minDenom;    // smallest dry-wet span the wetness is scaled to
+    uint16_t easeWetQ8;   // 1..256
+    uint16_t easeDryQ8;   // 1..256
+};
+
+static const RainTuning RAIN_TUNING_DEFAULT = {WET_MARGIN, TRIGGER_DROP, DRY_HYST,
+                                               MIN_DENOM, PCT_EASE_WET_Q8, PCT_EASE_DRY_Q8};
+
+struct RainFilter
+{
+    uint16_t dryRef; // raw counts of the dry plate (tracks slow upward drift)
+    uint16_t wetRef; // wettest recent reading, recovers towards dryRef
+    int32_t pctQ8;   // eased wetness, 0..RAIN_PCT_ONE
+};
+
+// a - b, or 0 when b > a
+static inline uint16_t rainSubSat(uint16_t a, uint16_t b)
+{
+    return a > b ? (uint16_t)(a - b) : 0;
+}
+
+// Wet reference a fresh dry reference starts from
+static inline uint16_t rainInitialWetRef(uint16_t dry, const RainTuning &t)
+{
+    return (dry > t.wetMargin) ? dry - t.wetMargin : (dry > 20 ? dry - 20 : dry);
+}
+
+static inline void rainFilterReset(RainFilter &f, uint16_t dryRef, const RainTuning &t)
+{
+    f.dryRef = dryRef;
+    f.wetRef = rainInitialWetRef(dryRef, t);
+}
+
+// Unfiltered wetness of raw between the references, Q7.8, saturated to 0..100 %
+static inline int32_t rainTargetQ8(const RainFilter &f, uint16_t raw, const RainTuning &t)
+{
+    uint32_t denom = rainSubSat(f.dryRef, f.wetRef);
+    if (denom < t.minDenom)
+        denom = t.minDenom;
+    uint32_t q = (uint32_t)rainSubSat(f.dryRef, raw) * RAIN_PCT_ONE / denom;
+    return q > (uint32_t)RAIN_PCT_ONE ? RAIN_PCT_ONE : (int32_t)q;
+}
+
+// One update; returns whether the plate counts as wet now
+static inline bool rainFilterStep(RainFilter &f, uint16_t raw, bool hwWet, const RainTuning &t)
+{
+    bool wetNow = hwWet || (uint32_t)raw + t.triggerDrop < f.dryRef;
+
+    if (wetNow)
+    {
+        if (raw < f.wetRef)
+            f.wetRef = raw;
+    }
+    else
+    {
+        f.wetRef = (uint16_t)(f.wetRef + rainSubSat(f.dryRef, f.wetRef) / 300);
+    }
+
+    // Dry drift only upwards (the hysteresis bound is implied, kept for tuning)
+    if (!wetNow && raw > rainSubSat(f.dryRef, t.dryHyst) && raw > f.dryRef)
+        f.dryRef = (uint16_t)((199u * f.dryRef + raw) / 200);
+
+    int32_t ease = wetNow ? t.easeWetQ8 : t.easeDryQ8;
+    f.pctQ8 += ((rainTargetQ8(f, raw, t) - f.pctQ8) * ease) >> 8;
+    return wetNow;
+}
+
+#endif // RAIN_FILTER_H
@@ -0,0 +1,73 @@
+#ifndef TIME_SERIES_H
+#define TIME_SERIES_H
+
+#include <stdint.h>
+#include <math.h>
+
+// Fixed-capacity history of the last N values with O(1) min() and max().
+// Each extreme is tracked by a monotonic deque of buffer slots: a new value
+// drops every queued one it dominates from the back, and the front leaves
+// when its slot is overwritten, so each value enters and leaves each deque
+// once (amortised O(1) push, no rescans). NAN is stored as a gap and never
+// becomes an extreme. Single-threaded.
+template <typename T, uint16_t N>
+class TimeSeries
+{
+    static_assert(N >= 2, "TimeSeries needs room for two values");
+
+public:
+    void push(T v)
+    {
+        uint16_t slot = (uint16_t)(count_ % N);
+        if (count_ >= N)
+        {
+            // The value being overwritten may sit at either front
+            if (minLen_ && minQ_[minHead_] == slot)
+                popFront(minHead_, minLen_);
+            if (maxLen_ && maxQ_[maxHead_] == slot)
+                popFront(maxHead_, maxLen_);
+        }
+        buf_[slot] = v;
+        count_++;
+        if (isnan((float)v))
+            return;
+
+        while (minLen_ && !(buf_[minQ_[back(minHead_, minLen_)]] < v))
+            minLen_--;
+        minQ_[(minHead_ + minLen_++) % N] = slot;
+        while (maxLen_ && !(buf_[maxQ_[back(maxHead_, maxLen_)]] > v))
+            maxLen_--;
+        maxQ_[(maxHead_ + maxLen_++) % N] = slot;
+    }
+
+    // Values held (at most N)
+    uint16_t size() const { return count_ < N ? (uint16_t)count_ : N; }
+    // Values pushed since the start; the newest is number count() - 1
+    uint32_t count() const { return count_; }
+    static constexpr uint16_t capacity() { return N; }
+
+    // i = 0 is the oldest value held, size() - 1 the newest
+    T at(uint16_t i) const { return buf_[(count_ - size() + i) % N]; }
+    T latest() const { return buf_[(count_ - 1) % N]; }
+
+    // False while every value held is NAN
+    bool hasRange() const { return minLen_ != 0; }
+    T min() const { return buf_[minQ_[minHead_]]; }
+    T max() const { return buf_[maxQ_[maxHead_]]; }
+
+private:
+    static uint16_t back(uint16_t head, uint16_t len) { return (uint16_t)((head + len - 1) % N); }
+    static void popFront(uint16_t &head, uint16_t &len)
+    {
+        head = (uint16_t)((head + 1) % N);
+        len--;
+    }
+
+    T buf_[N];
+    uint16_t minQ_[N], maxQ_[N]; // slots in buf_, oldest at the head
+    uint16_t minHead_ = 0, minLen_ = 0;
+    uint16_t maxHead_ = 0, maxLen_ = 0;
+    uint32_t count_ = 0;
+};
+
+#endif // TIME_SERIES_H
@@ -0,0 +1,115 @@
+#include "acquisition.h"
+#include "bme_sensor.h"
+#include "config.h"
+#include "profiler.h"
+#include "rain_sensor.h"
+#include "wind_sensor.h"
+
+#include <spsc_ring.h>
+
+static Servo *servoPtr = nullptr;
+
+static SpscRing<SensorSample, SAMPLE_RING_SIZE> ring;
+static uint32_t seq = 0;
+
+// Written by the producer only; read by the consumer for reporting
+static volatile uint32_t ticks = 0;
+static volatile uint32_t maxTickUs = 0;
+static volatile uint32_t overruns = 0;
+
+void acquisitionInit(Servo &servo)
+{
+    servoPtr = &servo;
+}
+
+void acquisitionStep()
+{
+    uint32_t startUs = micros();
+
+    SensorSample s;
+    s.tMs = millis();
+    s.seq = seq++;
+
+    // Rain sensor and servo
+    uint32_t t0 = profBegin();
+    rainSensorUpdate(*servoPtr);
+    profEnd(PROF_RAIN, t0);
+    s.raining = isRaining();
+    s.wetnessPct = getWetnessPercent();
+
+    // Wind
+    t0 = profBegin();
+    WindSample w = readWind();
+    profEnd(PROF_WIND, t0);
+    s.windRpm = w.rpm;
+    s.windMs = w.ms;
+    s.windGust = w.gust;
+    s.windGustMax = w.gustMax;
+    s.windMean2m = w.mean2m;
+    s.windMean10m = w.mean10m;
+
+    // BME280 (own cadence; cached in between)
+    t0 = profBegin();
+    bmeSensorUpdate();
+    BmeReading env = bmeSensorRead();
+    profEnd(PROF_BME, t0);
+    s.tempC = env.tempC;
+    s.humidity = env.humidity;
+    s.pressureHPa = env.pressureHPa;
+
+    ring.push(s);
+
+    uint32_t tickUs = micros() - startUs;
+    ticks = ticks + 1;
+    if (tickUs > maxTickUs)
+        maxTickUs = tickUs;
+    if (tickUs > LOGIC_PERIOD_MS * 1000UL)
+        overruns = overruns + 1;
+}
+
+bool acquisitionPoll(SensorSample &latest, SampleSink each)
+{
+    bool fresh = false;
+    while (ring.pop(latest))
+    {
+        fresh = true;
+        if (each)
+            each(latest);
+    }
+    return fresh;
+}
+
+AcquisitionStats acquisitionStats()
+{
+    return AcquisitionStats{ticks, maxTickUs, overruns, ring.drops()};
+}
+
+#if ACQ_DUAL_CORE
+
+static void acquisitionTask(void *)
+{
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;)
+    {
+        acquisitionStep();
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(LOGIC_PERIOD_MS));
+    }
+}
+
+void acquisitionStart()
+{
+    // Same core as loop() (UI, MQTT) but a higher priority, so a tick preempts
+    // TFT/MQTT work; core 0 stays with the WiFi/lwIP tasks
+    xTaskCreatePinnedToCore(acquisitionTask, "acquisition", ACQ_STACK_SIZE, nullptr,
+                            ACQ_TASK_PRIORITY, nullptr, ACQ_CORE);
+    Serial.printf("Acquisition task pinned to core %d\n", ACQ_CORE);
+}
+
+#else
+
+void acquisitionStart()
+{
+    Serial.println("Acquisition runs in the loop scheduler (single core)");
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+#include <Arduino.h>
+#include <ESP32Servo.h>
+
+// One acquisition tick: everything the UI and MQTT side need
+struct SensorSample
+{
+    uint32_t tMs; // millis() when the tick started
+    uint32_t seq;
+    bool raining;
+    float wetnessPct;
+    float windRpm;     // instantaneous
+    float windMs;      // instantaneous
+    float windGust;    // current WIND_GUST_S mean
+    float windGustMax; // highest gust over WIND_MEAN_LONG_S
+    float windMean2m;
+    float windMean10m;
+    float tempC;       // NAN if no BME280
+    float humidity;    // NAN if no BME280
+    float pressureHPa; // NAN if no BME280
+};
+
+struct AcquisitionStats
+{
+    uint32_t ticks;
+    uint32_t maxTickUs; // longest acquisition tick
+    uint32_t overruns;  // ticks longer than LOGIC_PERIOD_MS
+    uint32_t drops;     // samples lost because the consumer fell behind
+};
+
+// Hand the sensors to the acquisition side (call after the sensor inits)
+void acquisitionInit(Servo &servo);
+
+// Start sampling: a pinned FreeRTOS task when ACQ_DUAL_CORE, otherwise
+// nothing (call acquisitionStep() from a scheduler task instead)
+void acquisitionStart();
+
+// Read rain, wind and BME280 once and queue the sample (producer side)
+void acquisitionStep();
+
+typedef void (*SampleSink)(const SensorSample &s);
+
+// Drain queued samples into `latest`, handing each one to `each` on the
+// way (aggregates must not miss the ones the UI skips); true if at least
+// one was new (consumer side)
+bool acquisitionPoll(SensorSample &latest, SampleSink each = nullptr);
+
+AcquisitionStats acquisitionStats();
+
+#endif // ACQUISITION_H
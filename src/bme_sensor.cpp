@@ -0,0 +1,291 @@
+#include "bme_sensor.h"
+#include "config.h"
+
+// Register-level BME280 driver. The Adafruit driver reads each channel in
+// its own transaction and re-reads temperature for humidity and pressure;
+// here one forced-mode conversion is triggered every BME_PERIOD_MS and,
+// once it has had time to finish, all eight data bytes come back in one
+// burst. Compensation is the integer reference code from the datasheet.
+
+static const uint8_t REG_CALIB_TP = 0x88; // 26 bytes: T1..T3, P1..P9, -, H1
+static const uint8_t REG_CHIP_ID = 0xD0;
+static const uint8_t REG_RESET = 0xE0;
+static const uint8_t REG_CALIB_H = 0xE1; // 7 bytes: H2..H6
+static const uint8_t REG_CTRL_HUM = 0xF2;
+static const uint8_t REG_STATUS = 0xF3;
+static const uint8_t REG_CTRL_MEAS = 0xF4;
+static const uint8_t REG_CONFIG = 0xF5;
+static const uint8_t REG_DATA = 0xF7; // press[3], temp[3], hum[2]
+
+static const uint8_t CHIP_ID = 0x60;
+static const uint8_t MODE_FORCED = 0x01;
+static const uint32_t ADC_SKIPPED = 0x80000; // data register value when a channel did not convert
+static const uint32_t STALE_MS = 5 * BME_PERIOD_MS;
+
+struct Calib
+{
+    uint16_t t1;
+    int16_t t2, t3;
+    uint16_t p1;
+    int16_t p2, p3, p4, p5, p6, p7, p8, p9;
+    uint8_t h1, h3;
+    int16_t h2, h4, h5;
+    int8_t h6;
+};
+
+static TwoWire *bus = nullptr;
+static uint8_t addr = 0;
+static bool present = false;
+static Calib cal;
+static uint8_t ctrlMeas = 0; // osrs_t, osrs_p, forced mode: writing it starts a conversion
+static uint32_t measureMs = 0;
+static bool pending = false; // a conversion was triggered and not collected yet
+static uint32_t triggerMs = 0;
+static BmeReading reading = {NAN, NAN, NAN, 0};
+static BmeStats stats = {};
+
+// Oversampling 0 (skipped), 1..16 → register field
+static uint8_t osrsBits(uint8_t n)
+{
+    switch (n)
+    {
+    case 0:
+        return 0;
+    case 1:
+        return 1;
+    case 2:
+        return 2;
+    case 4:
+        return 3;
+    case 8:
+        return 4;
+    default:
+        return 5;
+    }
+}
+
+// IIR coefficient 0 (off), 2..16 → register field
+static uint8_t filterBits(uint8_t n)
+{
+    switch (n)
+    {
+    case 0:
+        return 0;
+    case 2:
+        return 1;
+    case 4:
+        return 2;
+    case 8:
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+static bool writeReg(uint8_t reg, uint8_t value)
+{
+    bus->beginTransmission(addr);
+    bus->write(reg);
+    bus->write(value);
+    return bus->endTransmission() == 0;
+}
+
+static bool readRegs(uint8_t reg, uint8_t *buf, uint8_t len)
+{
+    bus->beginTransmission(addr);
+    bus->write(reg);
+    if (bus->endTransmission(false) != 0 || bus->requestFrom(addr, len) != len)
+        return false;
+    for (uint8_t i = 0; i < len; i++)
+        buf[i] = (uint8_t)bus->read();
+    return true;
+}
+
+static bool readCalibration()
+{
+    uint8_t tp[26], h[7];
+    if (!readRegs(REG_CALIB_TP, tp, sizeof(tp)) || !readRegs(REG_CALIB_H, h, sizeof(h)))
+        return false;
+    auto u16 = [](const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); };
+    cal.t1 = u16(tp + 0);
+    cal.t2 = (int16_t)u16(tp + 2);
+    cal.t3 = (int16_t)u16(tp + 4);
+    cal.p1 = u16(tp + 6);
+    cal.p2 = (int16_t)u16(tp + 8);
+    cal.p3 = (int16_t)u16(tp + 10);
+    cal.p4 = (int16_t)u16(tp + 12);
+    cal.p5 = (int16_t)u16(tp + 14);
+    cal.p6 = (int16_t)u16(tp + 16);
+    cal.p7 = (int16_t)u16(tp + 18);
+    cal.p8 = (int16_t)u16(tp + 20);
+    cal.p9 = (int16_t)u16(tp + 22);
+    cal.h1 = tp[25];
+    cal.h2 = (int16_t)u16(h + 0);
+    cal.h3 = h[2];
+    cal.h4 = (int16_t)(((int8_t)h[3] * 16) | (h[4] & 0x0F));
+    cal.h5 = (int16_t)(((int8_t)h[5] * 16) | (h[4] >> 4));
+    cal.h6 = (int8_t)h[6];
+    return true;
+}
+
+// ===== Datasheet compensation (section 4.2.3) =====
+
+static int32_t compensateT(int32_t adcT, int32_t &tFine)
+{
+    int32_t var1 = ((((adcT >> 3) - ((int32_t)cal.t1 << 1))) * ((int32_t)cal.t2)) >> 11;
+    int32_t var2 = (((((adcT >> 4) - ((int32_t)cal.t1)) * ((adcT >> 4) - ((int32_t)cal.t1))) >> 12) *
+                    ((int32_t)cal.t3)) >> 14;
+    tFine = var1 + var2;
+    return (tFine * 5 + 128) >> 8; // 0.01 °C
+}
+
+static uint32_t compensateP(int32_t adcP, int32_t tFine)
+{
+    int64_t var1 = ((int64_t)tFine) - 128000;
+    int64_t var2 = var1 * var1 * (int64_t)cal.p6;
+    var2 = var2 + ((var1 * (int64_t)cal.p5) << 17);
+    var2 = var2 + (((int64_t)cal.p4) << 35);
+    var1 = ((var1 * var1 * (int64_t)cal.p3) >> 8) + ((var1 * (int64_t)cal.p2) << 12);
+    var1 = (((((int64_t)1) << 47) + var1)) * ((int64_t)cal.p1) >> 33;
+    if (var1 == 0)
+        return 0; // avoid division by zero
+    int64_t p = 1048576 - adcP;
+    p = (((p << 31) - var2) * 3125) / var1;
+    var1 = (((int64_t)cal.p9) * (p >> 13) * (p >> 13)) >> 25;
+    var2 = (((int64_t)cal.p8) * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + (((int64_t)cal.p7) << 4);
+    return (uint32_t)p; // Pa in Q24.8
+}
+
+static uint32_t compensateH(int32_t adcH, int32_t tFine)
+{
+    int32_t v = tFine - ((int32_t)76800);
+    v = (((((adcH << 14) - (((int32_t)cal.h4) << 20) - (((int32_t)cal.h5) * v)) + ((int32_t)16384)) >> 15) *
+         (((((((v * ((int32_t)cal.h6)) >> 10) * (((v * ((int32_t)cal.h3)) >> 11) + ((int32_t)32768))) >> 10) +
+            ((int32_t)2097152)) * ((int32_t)cal.h2) + 8192) >> 14));
+    v = (v - (((((v >> 15) * (v >> 15)) >> 7) * ((int32_t)cal.h1)) >> 4));
+    v = (v < 0 ? 0 : v);
+    v = (v > 419430400 ? 419430400 : v);
+    return (uint32_t)(v >> 12); // %RH in Q22.10
+}
+
+// ===== Acquisition =====
+
+static bool collect()
+{
+    uint8_t d[8];
+    if (!readRegs(REG_DATA, d, sizeof(d)))
+        return false;
+    int32_t adcP = ((uint32_t)d[0] << 12) | ((uint32_t)d[1] << 4) | (d[2] >> 4);
+    int32_t adcT = ((uint32_t)d[3] << 12) | ((uint32_t)d[4] << 4) | (d[5] >> 4);
+    int32_t adcH = ((uint32_t)d[6] << 8) | d[7];
+    if (adcT == (int32_t)ADC_SKIPPED)
+        return false; // no conversion since reset
+
+    int32_t tFine;
+    reading.tempC = compensateT(adcT, tFine) / 100.0f;
+    reading.pressureHPa = BME_OSRS_P ? compensateP(adcP, tFine) / 25600.0f : NAN;
+    reading.humidity = BME_OSRS_H ? compensateH(adcH, tFine) / 1024.0f : NAN;
+    reading.tMs = millis();
+    stats.conversions++;
+    return true;
+}
+
+static bool trigger()
+{
+    if (!writeReg(REG_CTRL_MEAS, ctrlMeas))
+        return false;
+    pending = true;
+    triggerMs = millis();
+    return true;
+}
+
+bool bmeSensorInit(TwoWire &wire)
+{
+    static_assert(BME_OSRS_T > 0, "temperature is needed to compensate the other channels");
+    bus = &wire;
+
+    static const uint8_t candidates[] = {0x76, 0x77};
+    uint8_t id = 0;
+    for (uint8_t a : candidates)
+    {
+        addr = a;
+        if (readRegs(REG_CHIP_ID, &id, 1) && id == CHIP_ID)
+            break;
+    }
+    if (id != CHIP_ID)
+        return false;
+
+    // Soft reset, then wait for the NVM copy (im_update) to finish
+    writeReg(REG_RESET, 0xB6);
+    delay(2);
+    uint8_t status = 1;
+    for (uint8_t i = 0; i < 10 && readRegs(REG_STATUS, &status, 1) && (status & 0x01); i++)
+        delay(1);
+    if (!readCalibration())
+        return false;
+
+    // config is only writable in sleep mode; ctrl_hum takes effect with the next ctrl_meas write
+    ctrlMeas = (osrsBits(BME_OSRS_T) << 5) | (osrsBits(BME_OSRS_P) << 2) | MODE_FORCED;
+    if (!writeReg(REG_CONFIG, filterBits(BME_IIR) << 2) || !writeReg(REG_CTRL_HUM, osrsBits(BME_OSRS_H)))
+        return false;
+
+    // Datasheet 9.1, maximum conversion time
+    uint32_t us = 1250 + 2300 * BME_OSRS_T;
+    if (BME_OSRS_P)
+        us += 2300 * BME_OSRS_P + 575;
+    if (BME_OSRS_H)
+        us += 2300 * BME_OSRS_H + 575;
+    measureMs = (us + 999) / 1000;
+
+    present = trigger();
+    Serial.printf("BME280 at 0x%02X: forced mode every %u ms, %lu ms per conversion\n", addr,
+                  (unsigned)BME_PERIOD_MS, (unsigned long)measureMs);
+    return present;
+}
+
+void bmeSensorUpdate()
+{
+    if (!present)
+        return;
+
+    uint32_t startUs = micros();
+    bool busy = false;
+    uint32_t now = millis();
+    if (pending && now - triggerMs >= measureMs)
+    {
+        busy = true;
+        pending = false;
+        if (!collect())
+            stats.errors++;
+    }
+    if (!pending && now - triggerMs >= BME_PERIOD_MS)
+    {
+        busy = true;
+        if (!trigger())
+        {
+            stats.errors++;
+            triggerMs = now; // retry next period
+        }
+    }
+    if (reading.tMs && millis() - reading.tMs > STALE_MS)
+        reading = {NAN, NAN, NAN, 0}; // sensor stopped answering
+
+    if (busy)
+    {
+        uint32_t us = micros() - startUs;
+        stats.i2cUs += us;
+        if (us > stats.maxI2cUs)
+            stats.maxI2cUs = us;
+    }
+}
+
+BmeReading bmeSensorRead()
+{
+    return reading;
+}
+
+BmeStats bmeSensorStats()
+{
+    return stats;
+}
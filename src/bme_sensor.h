@@ -0,0 +1,37 @@
+#ifndef BME_SENSOR_H
+#define BME_SENSOR_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+struct BmeReading
+{
+    float tempC;       // NAN until the first conversion (or without a sensor)
+    float humidity;    // %
+    float pressureHPa;
+    uint32_t tMs; // millis() when the conversion was collected
+};
+
+struct BmeStats
+{
+    uint32_t conversions; // forced-mode measurements collected
+    uint32_t errors;      // bus errors (NACK, short read)
+    uint32_t i2cUs;       // time spent on the bus, all transactions
+    uint32_t maxI2cUs;    // longest single update
+};
+
+// Probe 0x76, then 0x77, read the calibration and configure forced mode
+// (BME_OSRS_*, BME_IIR); false if no BME280 answers
+bool bmeSensorInit(TwoWire &wire);
+
+// Call every acquisition tick: collects a finished conversion with one
+// burst read and triggers the next one every BME_PERIOD_MS. Never waits
+// on the sensor.
+void bmeSensorUpdate();
+
+// Latest compensated values (cached; no bus traffic)
+BmeReading bmeSensorRead();
+
+BmeStats bmeSensorStats();
+
+#endif // BME_SENSOR_H
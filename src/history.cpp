@@ -0,0 +1,44 @@
+#include "history.h"
+
+static HistorySeries series[HIST_METRICS];
+static float sums[HIST_METRICS];
+static uint16_t counts[HIST_METRICS];
+static uint32_t periodStartMs = 0;
+static bool started = false;
+
+static void accumulate(HistoryMetric m, float v)
+{
+    if (isnan(v))
+        return;
+    sums[m] += v;
+    counts[m]++;
+}
+
+void historyAdd(const SensorSample &s)
+{
+    if (!started)
+    {
+        periodStartMs = s.tMs;
+        started = true;
+    }
+    if (s.tMs - periodStartMs >= HISTORY_PERIOD_MS)
+    {
+        for (uint8_t m = 0; m < HIST_METRICS; m++)
+        {
+            series[m].push(counts[m] ? sums[m] / counts[m] : NAN);
+            sums[m] = 0;
+            counts[m] = 0;
+        }
+        periodStartMs += HISTORY_PERIOD_MS;
+        if (s.tMs - periodStartMs >= HISTORY_PERIOD_MS)
+            periodStartMs = s.tMs; // stalled for more than a period: restart the grid
+    }
+    accumulate(HIST_WIND, s.windMs);
+    accumulate(HIST_TEMP, s.tempC);
+    accumulate(HIST_PRESSURE, s.pressureHPa);
+}
+
+const HistorySeries &historySeries(HistoryMetric m)
+{
+    return series[m];
+}
@@ -0,0 +1,28 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <Arduino.h>
+#include <time_series.h>
+
+#include "acquisition.h"
+#include "config.h"
+
+// Charted metrics, one HISTORY_LEN-point series each
+enum HistoryMetric
+{
+    HIST_WIND,     // m/s
+    HIST_TEMP,     // °C
+    HIST_PRESSURE, // hPa
+    HIST_METRICS
+};
+
+typedef TimeSeries<float, HISTORY_LEN> HistorySeries;
+
+// Fold one acquisition sample into the current point; every
+// HISTORY_PERIOD_MS the means become a new point in each series (NAN when
+// the metric had no valid value during the period)
+void historyAdd(const SensorSample &s);
+
+const HistorySeries &historySeries(HistoryMetric m);
+
+#endif // HISTORY_H
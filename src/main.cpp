@@ -1,7 +1,6 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <TFT_eSPI.h>
-#include <Adafruit_BME280.h>
 #include <ESP32Servo.h>
 
 #include "config.h"
@@ -9,90 +8,287 @@
 #include "rain_sensor.h"
 #include "ui.h"
 #include "mqtt_client.h"
+#include "scheduler.h"
+#include "acquisition.h"
+#include "bme_sensor.h"
+#include "mqtt_queue.h"
+#include "offline_buffer.h"
+#include "history.h"
+#include "rollup.h"
+#include "profiler.h"
+#include "power.h"
+#include "publish_policy.h"
+#include "tls_client.h"
+#include "settings.h"
+
+// The Unity tests under test/ link the sketch modules and bring their own
+// setup()/loop()
+#ifndef PIO_UNIT_TESTING
 
 // === Hardware instances ===
 TFT_eSPI tft;
-Adafruit_BME280 bme;
 Servo servo;
 
 // === State ===
 bool bmeOk = false;
-uint32_t lastLogic = 0;
-uint32_t lastUi = 0;
+
+// Latest sample from the acquisition side
+SensorSample latest{0, 0, false, 0, 0, 0, 0, 0, 0, 0, NAN, NAN, NAN};
+
+// === Tasks ===
+// Priorities (0 = most urgent) keep the original order within one tick:
+// sensors first, then the display, then publishing.
+
+#if !ACQ_DUAL_CORE
+static void taskAcquire()
+{
+  acquisitionStep();
+}
+#endif
+
+// Every sample, including the ones the display skips
+static void onSample(const SensorSample &s)
+{
+  historyAdd(s);
+  rollupAdd(s);
+}
+
+static void taskUi()
+{
+  bool fresh = acquisitionPoll(latest, onSample);
+  uint32_t t0 = profBegin();
+  uiUpdate(tft, !latest.raining, latest.wetnessPct, latest.windMs, latest.tempC, latest.humidity, latest.pressureHPa);
+  profEnd(PROF_UI, t0);
+  if (fresh)
+  {
+    profBootMark(BOOT_FIRST_SAMPLE);
+    profBootMark(BOOT_FIRST_FRAME); // drawn from it just now
+  }
+}
+
+static void taskPublish()
+{
+  int servoAngle = latest.raining ? 90 : 0;
+  // Rain and motor changes go out at once; the rest waits for the interval
+  if (shouldPublish() || mqttPublishUrgent(latest.raining, servoAngle))
+  {
+    uint32_t t0 = profBegin();
+    mqttPublishData(latest.windMs, latest.raining, latest.tempC, latest.humidity, latest.pressureHPa, servoAngle);
+    profEnd(PROF_PUBLISH, t0);
+  }
+}
+
+static void taskHeartbeat()
+{
+  uiHeartbeat(tft);
+}
+
+static void taskMqtt()
+{
+  uint32_t t0 = profBegin();
+  mqttMaintain();
+  profEnd(PROF_MQTT, t0);
+}
+
+static void taskRainCal()
+{
+  rainSensorSaveCalibration();
+}
+
+static void taskDiag()
+{
+  profPublish();
+}
+
+static void taskReport()
+{
+  schedulerReport();
+  profReport();
+  AcquisitionStats acq = acquisitionStats();
+  Serial.printf("acquisition: %lu ticks, max %lu us, %lu overruns, %lu dropped\n",
+                (unsigned long)acq.ticks, (unsigned long)acq.maxTickUs,
+                (unsigned long)acq.overruns, (unsigned long)acq.drops);
+  OfflineStats off = offlineStats();
+  Serial.printf("offline: %lu pending, %lu stored, %lu replayed, %lu lost, %lu corrupt, %lu flash writes (%lu B)\n",
+                (unsigned long)offlineCount(), (unsigned long)off.stored, (unsigned long)off.replayed,
+                (unsigned long)off.overwritten, (unsigned long)off.corrupt, (unsigned long)off.flashWrites,
+                (unsigned long)off.flashBytes);
+  Serial.printf("wind: %.2f m/s, gust %.2f (max %.2f), 2 min %.2f, 10 min %.2f, %d pulses\n",
+                latest.windMs, latest.windGust, latest.windGustMax, latest.windMean2m, latest.windMean10m,
+                getWindPulseCount());
+  BmeStats bmeSt = bmeSensorStats();
+  Serial.printf("bme280: %lu conversions, %lu errors, I2C %lu us total (max %lu us per tick)\n",
+                (unsigned long)bmeSt.conversions, (unsigned long)bmeSt.errors, (unsigned long)bmeSt.i2cUs,
+                (unsigned long)bmeSt.maxI2cUs);
+  UiStats ui = uiStats();
+  Serial.printf("ui: %lu SPI B/s (estimated), %lu field redraws, %lu unchanged, %u sprites (%lu B), %lu DMA pushes\n",
+                (unsigned long)ui.spiBytesPerSec, (unsigned long)ui.fieldRedraws, (unsigned long)ui.fieldSkips,
+                ui.sprites, (unsigned long)ui.spriteBytes, (unsigned long)ui.dmaPushes);
+  Serial.printf("charts: %lu columns, %lu full redraws\n", (unsigned long)ui.chartColumns,
+                (unsigned long)ui.chartRedraws);
+  RollupStats roll = rollupStats();
+  Serial.printf("rollup: %lu/%lu/%lu published (1m/10m/1h), %lu skipped offline\n",
+                (unsigned long)roll.published[ROLL_1M], (unsigned long)roll.published[ROLL_10M],
+                (unsigned long)roll.published[ROLL_1H], (unsigned long)roll.skipped);
+  MqttQueueStats q = mqttQueueStats();
+  Serial.printf("mqtt queue: %u deep (max %u, %u B max), %lu queued, %lu sent, %lu dropped, %lu coalesced, %lu rejected\n",
+                q.depth, q.maxDepth, q.maxBytes, (unsigned long)q.queued, (unsigned long)q.sent,
+                (unsigned long)q.dropped, (unsigned long)q.coalesced, (unsigned long)q.rejected);
+#if MQTT_TLS
+  TlsStats tls = tlsStats();
+  Serial.printf("tls: %lu full (max %lu ms), %lu resumed (max %lu ms), %lu failed, %lu session saves\n",
+                (unsigned long)tls.full, (unsigned long)tls.maxFullMs, (unsigned long)tls.resumed,
+                (unsigned long)tls.maxResumedMs, (unsigned long)tls.failed, (unsigned long)tls.sessionSaves);
+#endif
+  PublishStats pub = policyStats();
+  Serial.printf("publish: sent/suppressed");
+  for (uint8_t i = 0; i < PUB_METRICS; i++)
+    Serial.printf(" %s %lu/%lu", policyMetricName((PublishMetric)i), (unsigned long)pub.sent[i],
+                  (unsigned long)pub.suppressed[i]);
+  Serial.printf(", %lu immediate, %lu heartbeats\n", (unsigned long)pub.immediate, (unsigned long)pub.heartbeats);
+#if POWER_LOW_POWER
+  PowerStats pw = powerStats();
+  Serial.printf("power: %lu sleeps (%lu timer, %lu rain wakes), %.1f s asleep, radio off %lu times\n",
+                (unsigned long)pw.sleeps, (unsigned long)pw.timerWakes, (unsigned long)pw.ulpWakes, pw.sleepUs / 1e6,
+                (unsigned long)pw.radioOffs);
+#endif
+}
+
+// === MQTT commands ===
+
+// Motor topic: "1" = wet angle, "0" = dry angle; the acquisition side
+// moves the servo, never the network task
+static void onMotorCommand(const uint8_t *payload, unsigned int length)
+{
+  long motorCommand;
+  if (!mqttPayloadInt(payload, length, motorCommand) || (motorCommand != 0 && motorCommand != 1))
+    return;
+  rainSensorRequestServo(motorCommand == 1);
+  Serial.printf("Motor command: %s\n", motorCommand ? "ON" : "OFF");
+}
+
+static void onCalibrateCommand(const uint8_t *payload, unsigned int length)
+{
+  long dryRaw = 0;
+  if (length == 0 || mqttPayloadIs(payload, length, "dry"))
+    rainSensorRequestCalibration(0);
+  else if (mqttPayloadInt(payload, length, dryRaw) && dryRaw > 0 && dryRaw < 4096)
+    rainSensorRequestCalibration((uint16_t)dryRaw);
+  else
+    Serial.println("calibrate: expected \"dry\" or a raw ADC value (1-4095)");
+}
+
+static void onIntervalCommand(const uint8_t *payload, unsigned int length)
+{
+  long seconds;
+  if (!mqttPayloadInt(payload, length, seconds) || seconds < PUBLISH_INTERVAL_MIN_S || seconds > PUBLISH_INTERVAL_MAX_S)
+  {
+    Serial.printf("interval: expected %d-%d seconds\n", PUBLISH_INTERVAL_MIN_S, PUBLISH_INTERVAL_MAX_S);
+    return;
+  }
+  settingsSet(SET_PUBLISH_MS, seconds * 1000.0, true);
+  Serial.printf("Publish interval: %ld s\n", seconds);
+}
+
+static void onConfigCommand(const uint8_t *payload, unsigned int length)
+{
+  static char json[768]; // all settings, ~600 B
+  if (!settingsApplyText(payload, length))
+    return;
+  size_t n = settingsFormatJson(json, sizeof(json));
+  if (n)
+    mqttPublishConfig(json, n);
+}
+
+static void onRebootCommand(const uint8_t *payload, unsigned int length)
+{
+  if (!mqttPayloadIs(payload, length, "reboot"))
+    return;
+  if (millis() < REBOOT_MIN_UPTIME_MS)
+  {
+    Serial.println("reboot: ignored this soon after boot");
+    return;
+  }
+  Serial.println("Rebooting on request");
+  Serial.flush();
+  ESP.restart();
+}
 
 void setup()
 {
+  // Staged boot: only what the first live frame needs runs here, in an
+  // order that starts the slow parts first. The WiFi join, TLS setup,
+  // broker connect and the rain dry calibration carry on in the background
+  // (mqttMaintain(), rainSensorUpdate()). Phases and milestones are logged
+  // as "Boot: ..." lines.
   Serial.begin(115200);
-  delay(140);
   Serial.println("\n=== Weather Station Starting ===");
+  profInit();
+  profBootPhase("serial");
+
+  // Runtime settings before anything reads them
+  settingsInit();
+  profBootPhase("settings");
+
+  // ULP first: the wind and rain inits hand their pins to it (low-power mode)
+  powerInit();
+  profBootPhase("power");
+
+  // Samples buffered during an outage before the last reset are replayed
+  // after connecting; LittleFS is mounted here (TLS sessions live there too)
+  offlineInit();
+  profBootPhase("storage");
+
+  // WiFi join starts now and runs while the rest comes up
+  mqttInit();
+  mqttOnCommand(MQTT_TOPIC_MOTOR, onMotorCommand);
+  mqttOnCommand(MQTT_TOPIC_CMD_CALIBRATE, onCalibrateCommand);
+  mqttOnCommand(MQTT_TOPIC_CMD_INTERVAL, onIntervalCommand);
+  mqttOnCommand(MQTT_TOPIC_CMD_REBOOT, onRebootCommand);
+  mqttOnCommand(MQTT_TOPIC_CMD_CONFIG, onConfigCommand);
+  // Publish GPS coordinates once at startup (saved to database; sent on the first connect)
+  mqttPublishGPS(51.81208300695626, 4.516824735424278);
+  profBootPhase("network");
 
   // Initialize UI (display)
   uiInit(tft);
+  profBootPhase("display");
 
-  // Initialize rain sensor and servo
+  // Rain sensor and servo (warm start from the saved calibration, or the
+  // dry reference learned from the first updates),
+  // BME280 (first conversion triggered), wind sensor
   rainSensorInit(servo);
-
-  // Initialize I2C and BME280
   Wire.begin(I2C_SDA, I2C_SCL);
-  bmeOk = bme.begin(0x76, &Wire);
-  if (!bmeOk)
-  {
-    bmeOk = bme.begin(0x77, &Wire);
-  }
+  bmeOk = bmeSensorInit(Wire);
   Serial.printf("BME280: %s\n", bmeOk ? "OK" : "NOT FOUND");
-
-  // Initialize wind sensor
   windSensorInit();
+  profBootPhase("sensors");
 
-  // Initialize MQTT (WiFi + MQTT broker connection) - pass servo for remote control
-  mqttInit(servo);
+  // Start sampling (own core when ACQ_DUAL_CORE)
+  acquisitionInit(servo);
+  acquisitionStart();
 
-  // Publish GPS coordinates once at startup (saved to database)
-  mqttPublishGPS(51.81208300695626, 4.516824735424278);
+  // Register periodic tasks
+#if !ACQ_DUAL_CORE
+  schedulerAdd("acquire", taskAcquire, LOGIC_PERIOD_MS, 0);
+#endif
+  schedulerAdd("ui", taskUi, LOGIC_PERIOD_MS, 3);
+  schedulerAdd("publish", taskPublish, LOGIC_PERIOD_MS, 4);
+  schedulerAdd("heartbeat", taskHeartbeat, HEARTBEAT_MS, 5);
+  schedulerAdd("mqtt", taskMqtt, MQTT_MAINTAIN_MS, 6);
+  schedulerAdd("report", taskReport, SCHED_REPORT_MS, 7);
+  schedulerAdd("diag", taskDiag, DIAG_PUBLISH_MS, 8);
+  schedulerAdd("raincal", taskRainCal, RAIN_CAL_CHECK_MS, 9);
+  profBootPhase("tasks");
 
   Serial.println("=== Setup Complete ===\n");
+  profBootMark(BOOT_SETUP);
 }
 
 void loop()
 {
-  // Main sensor logic tick (every 80ms)
-  if (millis() - lastLogic >= LOGIC_PERIOD_MS)
-  {
-    lastLogic = millis();
-
-    // Update rain sensor and servo
-    rainSensorUpdate(servo);
-
-    // Read wind sensor
-    WindSample wind = readWind();
-
-    // Read BME280 environmental sensors
-    float tempC = NAN, humidity = NAN, pressure = NAN;
-    if (bmeOk)
-    {
-      tempC = bme.readTemperature();          // °C
-      humidity = bme.readHumidity();          // %
-      pressure = bme.readPressure() / 100.0f; // Pa → hPa
-    }
-
-    // Update UI
-    uiUpdate(tft, !isRaining(), getWetnessPercent(), wind.ms, tempC, humidity, pressure);
-
-    // Publish to MQTT if interval elapsed
-    if (shouldPublish())
-    {
-      int servoAngle = isRaining() ? 90 : 0;
-      mqttPublishData(wind.ms, isRaining(), tempC, humidity, pressure, servoAngle);
-    }
-  }
-
-  // UI heartbeat indicator (every 400ms)
-  if (millis() - lastUi >= 400)
-  {
-    lastUi = millis();
-    uiHeartbeat(tft);
-  }
-
-  // Maintain MQTT connection
-  mqttMaintain();
+  schedulerRun();
+  powerIdle(tft);
 }
+
+#endif // PIO_UNIT_TESTING
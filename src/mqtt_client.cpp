@@ -1,216 +1,953 @@
 #include "mqtt_client.h"
 #include "config.h"
+#include "tcp_connect.h"
+#include "mqtt_queue.h"
+#include "offline_buffer.h"
+#include "publish_policy.h"
+#include "settings.h"
+#include "tls_client.h"
+#include "profiler.h"
 #include <WiFi.h>
 #include <ArduinoJson.h>
+#include <ctype.h>
+#include <limits.h>
+#include <time.h>
 
 static WiFiClient network;
-static PubSubClient mqtt(network);
-static unsigned long lastPublishTime = 0;
-static Servo *servoPtr = nullptr; // Pointer to servo for callback access
+static Client *transport = &network; // or the TLS stream, see mqttInit()
+
+static int sessionFd();
+
+// === Session client ===
+// PubSubClient 2.8 only connects synchronously: connect() writes CONNECT
+// and spins on available() until CONNACK arrives. So mqttMaintain() sends
+// CONNECT itself, polls for the CONNACK and calls connect() only once it
+// is waiting in the socket; this wrapper swallows the library's second
+// CONNECT during that call, which then returns without waiting.
+//
+// Reads are framed here as well. loop() reads a packet a byte at a time and
+// waits up to the socket timeout for every byte that has not arrived, so a
+// packet split across TCP segments would stall it. fill() takes what the
+// transport already holds, without waiting, and available() only counts
+// complete packets: loop() never starts on one it cannot finish.
+class SessionClient : public Client
+{
+public:
+    bool mute = false; // inside mqtt.connect(): drop its CONNECT
+
+    int connect(IPAddress ip, uint16_t port) override { return transport->connect(ip, port); }
+    int connect(const char *host, uint16_t port) override { return transport->connect(host, port); }
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t *buf, size_t size) override { return mute ? size : transport->write(buf, size); }
+    int available() override { return (int)(framed - inPos); }
+    int read() override { return inPos < framed ? in[inPos++] : -1; }
+    int read(uint8_t *buf, size_t size) override;
+    int peek() override { return inPos < framed ? in[inPos] : -1; }
+    void flush() override { transport->flush(); }
+    void stop() override
+    {
+        reset();
+        transport->stop();
+    }
+    uint8_t connected() override { return transport->connected(); }
+    operator bool() override { return transport->connected(); }
+    int fd() const { return sessionFd(); }
+
+    void fill();
+    void reset() { inLen = inPos = framed = skip = 0; }
+
+private:
+    uint8_t in[MQTT_BUFFER_SIZE]; // larger packets are dropped, as PubSubClient does
+    size_t inLen = 0;  // bytes received
+    size_t inPos = 0;  // bytes handed to PubSubClient
+    size_t framed = 0; // end of the last complete packet
+    size_t skip = 0;   // rest of an oversize packet, dropped as it arrives
+};
+
+int SessionClient::read(uint8_t *buf, size_t size)
+{
+    size_t n = framed - inPos < size ? framed - inPos : size;
+    if (n == 0)
+        return -1;
+    memcpy(buf, in + inPos, n);
+    inPos += n;
+    return (int)n;
+}
 
-static void connectWiFi()
+void SessionClient::fill()
 {
-    Serial.print("Connecting to WiFi");
-    WiFi.mode(WIFI_STA); // Set WiFi to station mode
-    WiFi.begin(WIFI_SSID, WIFI_PASS);
+    uint8_t scrap[64];
+    while (skip > 0)
+    {
+        int n = transport->available();
+        if (n <= 0)
+            return;
+        size_t want = (size_t)n < skip ? (size_t)n : skip;
+        int r = transport->read(scrap, want < sizeof(scrap) ? want : sizeof(scrap));
+        if (r <= 0)
+            return;
+        skip -= r;
+    }
 
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 20)
+    if (inPos > 0)
+    {
+        memmove(in, in + inPos, inLen - inPos);
+        inLen -= inPos;
+        framed -= inPos;
+        inPos = 0;
+    }
+    int n = transport->available();
+    if (n > 0 && inLen < sizeof(in))
     {
-        delay(500);
-        Serial.print(".");
-        attempts++;
+        size_t room = sizeof(in) - inLen;
+        int r = transport->read(in + inLen, (size_t)n < room ? (size_t)n : room);
+        if (r > 0)
+            inLen += r;
+    }
+
+    // Fixed header byte, 1-4 remaining-length bytes, then the rest
+    while (framed < inLen)
+    {
+        size_t pos = framed + 1;
+        uint32_t remaining = 0;
+        uint8_t shift = 0;
+        bool done = false;
+        while (!done && pos < inLen && shift < 28)
+        {
+            uint8_t b = in[pos++];
+            remaining |= (uint32_t)(b & 0x7f) << shift;
+            shift += 7;
+            done = !(b & 0x80);
+        }
+        if (!done)
+        {
+            if (shift >= 28)
+                stop(); // malformed length: the stream cannot be resynchronised
+            return;
+        }
+        size_t total = pos - framed + remaining;
+        if (total > sizeof(in))
+        {
+            skip = total - (inLen - framed);
+            inLen = framed;
+            return;
+        }
+        if (framed + total > inLen)
+            return;
+        framed += total;
     }
+}
+
+static SessionClient session;
+static PubSubClient mqtt(session);
 
-    if (WiFi.status() == WL_CONNECTED)
+static unsigned long lastPublishTime = 0;
+static uint32_t publishSeq = 0; // per boot; document formats only
+
+// GPS fix to publish once the first session is up
+static bool gpsPending = false;
+static float gpsLat = 0, gpsLon = 0;
+
+// === Connection manager ===
+// Every step is non-blocking: WiFi joins are driven by events, the TCP
+// connect and the CONNACK are polled on a non-blocking socket, and failures back off
+// exponentially with jitter instead of retrying in a delay() loop.
+enum LinkState
+{
+    LINK_WIFI_WAIT,      // no WiFi, waiting for the next join attempt
+    LINK_WIFI_JOINING,   // join requested, waiting for GOT_IP
+    LINK_BROKER_WAIT,    // WiFi up, waiting for the next broker attempt
+    LINK_TCP_CONNECTING, // non-blocking TCP connect in flight
+    LINK_TLS_HANDSHAKE,  // TLS on the new socket (MQTT_TLS)
+    LINK_WAIT_CONNACK,   // CONNECT sent, polling for CONNACK
+    LINK_ONLINE          // MQTT session up
+};
+
+static const char *const linkStateNames[] = {"wifi-wait",     "wifi-joining", "broker-wait", "tcp-connecting",
+                                              "tls-handshake", "wait-connack", "online"};
+
+static LinkState linkState = LINK_WIFI_WAIT;
+static uint32_t linkDeadline = 0; // next attempt (wait states) or timeout (in-flight states)
+static uint8_t wifiFailures = 0;
+static uint8_t brokerFailures = 0;
+static bool wifiStarted = false;
+static bool sntpStarted = false;
+#if MQTT_TLS
+static bool tlsPrepared = false; // tlsInit() ran (on the first join)
+#endif
+static int pendingFd = -1;
+static uint32_t connectStartMs = 0; // broker attempt started (TCP connect)
+static bool suspended = false;      // session closed by mqttSuspend(), not lost
+static uint32_t nextReplay = 0;
+
+// Set from the WiFi event task, consumed by mqttMaintain()
+static volatile bool wifiUp = false;
+static volatile bool wifiLost = false;       // was up, went down
+static volatile bool wifiJoinFailed = false; // join attempt ended without an IP
+
+static void onWiFiEvent(arduino_event_id_t event)
+{
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP)
     {
-        Serial.println("\nWiFi connected!");
-        Serial.print("IP: ");
-        Serial.println(WiFi.localIP());
+        wifiUp = true;
     }
-    else
+    else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED || event == ARDUINO_EVENT_WIFI_STA_LOST_IP)
     {
-        Serial.println("\nWiFi connection failed!");
+        if (wifiUp)
+            wifiLost = true;
+        else
+            wifiJoinFailed = true;
+        wifiUp = false;
     }
 }
 
-// Callback function for incoming MQTT messages
+// Wrap-safe "now is at or after t"
+static inline bool reached(uint32_t now, uint32_t t)
+{
+    return (int32_t)(now - t) >= 0;
+}
+
+// Exponential backoff with equal jitter: half of the window is fixed, half
+// random, so a fleet that lost the same AP does not reconnect in lockstep.
+static uint32_t backoffDelay(uint8_t &failures)
+{
+    uint32_t window = RECONNECT_BACKOFF_MAX_MS;
+    if (failures < 16)
+        window = min((uint32_t)RECONNECT_BACKOFF_MIN_MS << failures, (uint32_t)RECONNECT_BACKOFF_MAX_MS);
+    if (failures < 255)
+        failures++;
+    return window / 2 + (uint32_t)random(window / 2 + 1);
+}
+
+static void setLinkState(LinkState next)
+{
+    if (next != linkState)
+        Serial.printf("[link] %s -> %s\n", linkStateNames[linkState], linkStateNames[next]);
+    linkState = next;
+}
+
+static void wifiRetryLater(uint32_t now)
+{
+    uint32_t wait = backoffDelay(wifiFailures);
+    Serial.printf("WiFi connection failed, retry in %lu ms\n", (unsigned long)wait);
+    linkDeadline = now + wait;
+    setLinkState(LINK_WIFI_WAIT);
+}
+
+static void brokerRetryLater(uint32_t now)
+{
+    uint32_t wait = backoffDelay(brokerFailures);
+    Serial.printf("MQTT connection failed (rc=%d), retry in %lu ms\n", mqtt.state(), (unsigned long)wait);
+    linkDeadline = now + wait;
+    setLinkState(LINK_BROKER_WAIT);
+}
+
+// Socket under the MQTT session, plain or TLS
+static int sessionFd()
+{
+#if MQTT_TLS
+    return tlsFd();
+#else
+    return network.fd();
+#endif
+}
+
+// A publish now would be written whole, without waiting
+static bool sessionWritable()
+{
+#if MQTT_TLS
+    return tlsWritable();
+#else
+    return tcpWritable(network.fd());
+#endif
+}
+
+static void closeSession()
+{
+    session.reset();
+#if MQTT_TLS
+    tlsClient().stop();
+#endif
+    network.stop();
+}
+
+// === Inbound commands ===
+// Topics are registered once at init; a message is matched on length and
+// FNV-1a hash before the final memcmp, and handlers parse the payload in
+// place, so nothing inside mqtt.loop() touches the heap.
+struct Command
+{
+    const char *topic;
+    uint16_t length;
+    uint32_t hash;
+    MqttCommandHandler handler;
+};
+
+static Command commands[MQTT_MAX_COMMANDS];
+static uint8_t commandCount = 0;
+
+static uint32_t topicHash(const char *s, size_t len)
+{
+    uint32_t h = 2166136261u;
+    while (len--)
+        h = (h ^ (uint8_t)*s++) * 16777619u;
+    return h;
+}
+
 static void mqttMessageCallback(char *topic, byte *payload, unsigned int length)
 {
-    Serial.print("Message received on topic: ");
-    Serial.println(topic);
+    size_t len = strlen(topic);
+    uint32_t hash = topicHash(topic, len);
+    Serial.printf("Message on %s: %.*s\n", topic, (int)min(length, 64u), (const char *)payload);
 
-    // Parse the message
-    String message = "";
-    for (unsigned int i = 0; i < length; i++)
+    for (uint8_t i = 0; i < commandCount; i++)
     {
-        message += (char)payload[i];
+        const Command &c = commands[i];
+        if (c.length == len && c.hash == hash && memcmp(c.topic, topic, len) == 0)
+        {
+            c.handler(payload, length);
+            return;
+        }
     }
-    Serial.print("Payload: ");
-    Serial.println(message);
+}
+
+bool mqttOnCommand(const char *topic, MqttCommandHandler handler)
+{
+    if (commandCount >= MQTT_MAX_COMMANDS || topic == nullptr || handler == nullptr)
+        return false;
+    size_t len = strlen(topic);
+    commands[commandCount++] = Command{topic, (uint16_t)len, topicHash(topic, len), handler};
+    if (linkState == LINK_ONLINE)
+        mqtt.subscribe(topic);
+    return true;
+}
 
-    // Check if it's the motor topic
-    if (String(topic) == String(MQTT_TOPIC_MOTOR))
+bool mqttPayloadInt(const uint8_t *payload, unsigned int length, long &value)
+{
+    unsigned int i = 0;
+    while (i < length && isspace(payload[i]))
+        i++;
+    bool negative = false;
+    if (i < length && (payload[i] == '-' || payload[i] == '+'))
+        negative = payload[i++] == '-';
+    if (i >= length || !isdigit(payload[i]))
+        return false;
+
+    long v = 0;
+    for (; i < length && isdigit(payload[i]); i++)
     {
-        // Parse JSON or simple value
-        int motorCommand = message.toInt();
+        if (v > (LONG_MAX - 9) / 10)
+            return false;
+        v = v * 10 + (payload[i] - '0');
+    }
+    while (i < length && isspace(payload[i]))
+        i++;
+    if (i != length)
+        return false;
+    value = negative ? -v : v;
+    return true;
+}
 
-        if (motorCommand == 1 && servoPtr != nullptr)
-        {
-            servoPtr->write(SERVO_ANGLE_WET);
-            Serial.printf("Motor command: ON (%d°)\n", SERVO_ANGLE_WET);
-        }
-        else if (motorCommand == 0 && servoPtr != nullptr)
-        {
-            servoPtr->write(SERVO_ANGLE_DRY);
-            Serial.printf("Motor command: OFF (%d°)\n", SERVO_ANGLE_DRY);
-        }
+bool mqttPayloadIs(const uint8_t *payload, unsigned int length, const char *word)
+{
+    while (length > 0 && isspace(payload[length - 1]))
+        length--;
+    return strlen(word) == length && memcmp(payload, word, length) == 0;
+}
+
+// Append one sample as a JSON object; NaN (sensor missing) becomes null
+static int formatBacklogSample(char *buf, size_t size, const OfflineSample &s)
+{
+    char t[12], h[12], p[12];
+    snprintf(t, sizeof(t), isnan(s.tempC) ? "null" : "%.2f", s.tempC);
+    snprintf(h, sizeof(h), isnan(s.humidity) ? "null" : "%.2f", s.humidity);
+    snprintf(p, sizeof(p), isnan(s.pressure) ? "null" : "%.2f", s.pressure);
+    return snprintf(buf, size,
+                    "{\"seq\":%lu,\"ts\":%lu,\"wind\":%.2f,\"rain\":%s,\"temp\":%s,\"hum\":%s,\"pressure\":%s,\"motor\":%u}",
+                    (unsigned long)s.seq, (unsigned long)s.epoch, s.windMs, s.raining ? "true" : "false", t, h, p,
+                    s.servoAngle);
+}
+
+// Replay the oldest buffered samples as one JSON array on MQTT_TOPIC_BACKLOG.
+// At most one batch per OFFLINE_REPLAY_MS and never while a live publish is
+// due, so the backlog drains in the background without delaying current data.
+static void replayBacklog(uint32_t now)
+{
+    if (offlineCount() == 0 || !reached(now, nextReplay) || shouldPublish())
+        return;
+    nextReplay = now + OFFLINE_REPLAY_MS;
+
+    OfflineSample batch[OFFLINE_REPLAY_BATCH];
+    size_t n = offlineRead(batch, OFFLINE_REPLAY_BATCH);
+    if (n == 0)
+        return;
+
+    static char payload[MQTT_BUFFER_SIZE - 64]; // room for the fixed header and topic
+    size_t len = 1, sent = 0;
+    payload[0] = '[';
+    for (; sent < n; sent++)
+    {
+        int w = formatBacklogSample(payload + len + (sent ? 1 : 0), sizeof(payload) - len - 2, batch[sent]);
+        if (w < 0 || len + (sent ? 1 : 0) + w >= sizeof(payload) - 1)
+            break;
+        if (sent)
+            payload[len++] = ',';
+        len += w;
+    }
+    payload[len++] = ']';
+
+    if (sent > 0 && mqtt.publish(MQTT_TOPIC_BACKLOG, (const uint8_t *)payload, len))
+    {
+        offlineConsumeThrough(batch[sent - 1].seq);
+        Serial.printf("Backlog: replayed %u samples, %lu left\n", (unsigned)sent, (unsigned long)offlineCount());
     }
 }
 
-static void connectMQTT()
+// Write queued messages while the socket has send-buffer room, for at most
+// MQTT_DRAIN_BUDGET_US (at least one message per call). A write the client
+// refuses while still connected can never succeed (larger than its buffer)
+// and is dropped; one that failed because the session went down stays
+// queued for the next session.
+static void drainQueue()
 {
-    int attempts = 0;
-    const int maxAttempts = 3; // Only try 3 times during setup
+    uint32_t t0 = micros();
+    const char *topic;
+    const uint8_t *payload;
+    size_t length;
+    while (mqttQueuePeek(topic, payload, length) && sessionWritable())
+    {
+        bool ok = mqtt.publish(topic, payload, length);
+        if (!ok && !mqtt.connected())
+            return;
+        mqttQueuePop(ok);
+        if (micros() - t0 >= MQTT_DRAIN_BUDGET_US)
+            return;
+    }
+}
 
-    while (!mqtt.connected() && attempts < maxAttempts)
+// Session established: subscriptions and anything queued for the first connect
+static void onMqttConnected()
+{
+    unsigned long ms = millis() - connectStartMs;
+#if MQTT_TLS
+    Serial.printf("MQTT connected in %lu ms (TLS %s)\n", ms, tlsResumed() ? "resumed" : "full handshake");
+#else
+    Serial.printf("MQTT connected in %lu ms\n", ms);
+#endif
+    brokerFailures = 0;
+    if (!profBootMs(BOOT_MQTT))
     {
-        Serial.print("Connecting to MQTT...");
-        if (mqtt.connect(MQTT_CLIENT_ID, MQTT_USER, MQTT_PASS))
-        {
-            Serial.println("connected!");
+        profBootMark(BOOT_MQTT);
+        lastPublishTime = millis() - settings.publishIntervalMs; // first data now, not an interval after boot
+    }
 
-            // Subscribe to motor topic to receive commands
-            if (mqtt.subscribe(MQTT_TOPIC_MOTOR))
-            {
-                Serial.print("Subscribed to: ");
-                Serial.println(MQTT_TOPIC_MOTOR);
-            }
-            else
-            {
-                Serial.println("Failed to subscribe to motor topic!");
-            }
-        }
+    // Clean session: subscribe to every command topic again
+    for (uint8_t i = 0; i < commandCount; i++)
+    {
+        if (mqtt.subscribe(commands[i].topic))
+            Serial.printf("Subscribed to: %s\n", commands[i].topic);
         else
-        {
-            Serial.print("failed, rc=");
-            Serial.print(mqtt.state());
-            Serial.println(" retrying in 2s");
-            delay(2000);
-            attempts++;
-        }
+            Serial.printf("Failed to subscribe to %s!\n", commands[i].topic);
     }
 
-    if (!mqtt.connected())
+    if (gpsPending)
+        mqttPublishGPS(gpsLat, gpsLon);
+
+    // The broker may have restarted or a value changed while we were away;
+    // a suspended link was not away, the deadbands still hold
+    if (!suspended)
+        policyReset();
+    suspended = false;
+}
+
+// Append an MQTT string (length-prefixed)
+static size_t putString(uint8_t *p, const char *s)
+{
+    size_t n = strlen(s);
+    p[0] = n >> 8;
+    p[1] = n & 0xff;
+    memcpy(p + 2, s, n);
+    return n + 2;
+}
+
+// Transport is up (TCP, or TLS on top): send an MQTT 3.1.1 CONNECT with
+// the fields PubSubClient would use (clean session, user and password)
+static void mqttSessionStart(uint32_t now)
+{
+    static const char PROTOCOL[] = "MQTT";
+    uint8_t packet[5 + 10 + 2 + sizeof(MQTT_CLIENT_ID) + 2 + sizeof(MQTT_USER) + 2 + sizeof(MQTT_PASS)];
+    size_t len = 5; // fixed header: at most 4 remaining-length bytes, moved up below
+    len += putString(packet + len, PROTOCOL);
+    packet[len++] = 4;                 // protocol level 3.1.1
+    packet[len++] = 0x80 | 0x40 | 0x02; // user name, password, clean session
+    packet[len++] = MQTT_KEEPALIVE_S >> 8;
+    packet[len++] = MQTT_KEEPALIVE_S & 0xff;
+    len += putString(packet + len, MQTT_CLIENT_ID);
+    len += putString(packet + len, MQTT_USER);
+    len += putString(packet + len, MQTT_PASS);
+
+    size_t remaining = len - 5;
+    static_assert(sizeof(packet) - 5 < 16384, "remaining length takes at most two bytes");
+    size_t start = remaining < 128 ? 3 : 2;
+    packet[start] = 0x10; // CONNECT
+    if (remaining < 128)
+    {
+        packet[4] = remaining;
+    }
+    else
     {
-        Serial.println("MQTT connection failed after 3 attempts. Continuing without MQTT...");
+        packet[3] = 0x80 | (remaining & 0x7f);
+        packet[4] = remaining >> 7;
     }
+
+    size_t size = len - start;
+    if (session.write(packet + start, size) != size)
+    {
+        closeSession();
+        brokerRetryLater(now);
+        return;
+    }
+    linkDeadline = now + MQTT_CONNACK_TIMEOUT_MS;
+    setLinkState(LINK_WAIT_CONNACK);
 }
 
-void mqttInit(Servo &servo)
+void mqttInit()
 {
-    servoPtr = &servo; // Store servo pointer for callback access
-
-    connectWiFi();
+    WiFi.mode(WIFI_STA);          // Set WiFi to station mode
+    WiFi.setAutoReconnect(false); // Reconnects follow our backoff instead
+    WiFi.onEvent(onWiFiEvent);
 
     mqtt.setServer(MQTT_BROKER_ADDRESS, MQTT_BROKER_PORT);
     mqtt.setCallback(mqttMessageCallback); // Set callback for incoming messages
-    connectMQTT();
-    Serial.println("MQTT client initialized");
+    mqtt.setSocketTimeout(MQTT_SOCKET_TIMEOUT_S);
+    mqtt.setKeepAlive(MQTT_KEEPALIVE_S);
+    mqtt.setBufferSize(MQTT_BUFFER_SIZE); // backlog batches exceed the 256-byte default
+#if MQTT_TLS
+    transport = &tlsClient(); // the context is set up while the first join runs
+#endif
+
+    // Start the first join now: the radio associates while the display and
+    // sensors come up, and mqttMaintain() carries on from there
+    linkState = LINK_WIFI_WAIT;
+    linkDeadline = millis();
+    mqttMaintain();
+    Serial.println("MQTT client initialized (connecting in background)");
 }
 
 void mqttMaintain()
 {
-    static unsigned long lastReconnectAttempt = 0;
-    const unsigned long reconnectInterval = 30000; // Try reconnecting every 30 seconds
+    uint32_t now = millis();
 
-    if (WiFi.status() != WL_CONNECTED)
+    if (wifiLost)
     {
-        connectWiFi();
+        wifiLost = false;
+        Serial.println("WiFi connection lost");
+        if (pendingFd >= 0)
+        {
+            tcpConnectAbort(pendingFd);
+            pendingFd = -1;
+        }
+        closeSession();
+        wifiRetryLater(now);
     }
 
-    if (!mqtt.connected())
+    switch (linkState)
+    {
+    case LINK_WIFI_WAIT:
+        if (!reached(now, linkDeadline))
+            break;
+        Serial.println("Connecting to WiFi...");
+        if (!wifiStarted)
+        {
+            WiFi.begin(WIFI_SSID, WIFI_PASS);
+            wifiStarted = true;
+        }
+        else
+        {
+            WiFi.reconnect();
+        }
+        wifiJoinFailed = false;
+        linkDeadline = now + WIFI_JOIN_TIMEOUT_MS;
+        setLinkState(LINK_WIFI_JOINING);
+        break;
+
+    case LINK_WIFI_JOINING:
+#if MQTT_TLS
+        if (!tlsPrepared)
+        {
+            // CA parse and RNG seed while the radio associates; after
+            // offlineInit() has mounted LittleFS. On failure every attempt
+            // fails and backs off.
+            tlsPrepared = true;
+            tlsInit();
+            break;
+        }
+#endif
+        if (wifiUp)
+        {
+            wifiFailures = 0;
+            Serial.print("WiFi connected! IP: ");
+            Serial.println(WiFi.localIP());
+            profBootMark(BOOT_WIFI);
+            if (!sntpStarted)
+            {
+                configTime(0, 0, NTP_SERVER); // UTC; SNTP keeps it synced from here on
+                sntpStarted = true;
+            }
+            linkDeadline = now;
+            setLinkState(LINK_BROKER_WAIT);
+        }
+        else if (wifiJoinFailed || reached(now, linkDeadline))
+        {
+            WiFi.disconnect();
+            wifiRetryLater(now);
+        }
+        break;
+
+    case LINK_BROKER_WAIT:
+        if (!reached(now, linkDeadline))
+            break;
+        Serial.println("Connecting to MQTT...");
+        connectStartMs = now;
+        pendingFd = tcpConnectStart(MQTT_BROKER_ADDRESS, MQTT_BROKER_PORT);
+        if (pendingFd < 0)
+        {
+            brokerRetryLater(now);
+            break;
+        }
+        linkDeadline = now + MQTT_TCP_TIMEOUT_MS;
+        setLinkState(LINK_TCP_CONNECTING);
+        break;
+
+    case LINK_TCP_CONNECTING:
     {
-        unsigned long now = millis();
-        if (now - lastReconnectAttempt >= reconnectInterval)
+        int r = tcpConnectPoll(pendingFd);
+        if (r == 0 && !reached(now, linkDeadline))
+            break;
+        if (r <= 0)
         {
-            lastReconnectAttempt = now;
-            connectMQTT();
+            if (r == 0)
+                tcpConnectAbort(pendingFd); // timed out
+            pendingFd = -1;
+            brokerRetryLater(now);
+            break;
         }
+
+#if MQTT_TLS
+        if (!tlsStart(pendingFd))
+        {
+            pendingFd = -1;
+            brokerRetryLater(now);
+            break;
+        }
+        pendingFd = -1;
+        linkDeadline = now + MQTT_TLS_HANDSHAKE_TIMEOUT_MS;
+        setLinkState(LINK_TLS_HANDSHAKE);
+#else
+        network = WiFiClient(pendingFd);
+        pendingFd = -1;
+        mqttSessionStart(now);
+#endif
+        break;
+    }
+
+    case LINK_TLS_HANDSHAKE:
+    {
+        int r = tlsPoll();
+        if (r == 0 && !reached(now, linkDeadline))
+            break;
+        if (r <= 0)
+        {
+            if (r == 0)
+                closeSession(); // timed out
+            brokerRetryLater(now);
+            break;
+        }
+        mqttSessionStart(now);
+        break;
+    }
+
+    case LINK_WAIT_CONNACK:
+    {
+        // CONNACK is 4 bytes and the broker sends nothing before it, so
+        // once they are in, connect() reads them without waiting
+        session.fill();
+        bool ready = session.available() >= 4;
+        if (!ready && session.connected() && !reached(now, linkDeadline))
+            break;
+        bool ok = false;
+        if (ready)
+        {
+            session.mute = true;
+            ok = mqtt.connect(MQTT_CLIENT_ID, MQTT_USER, MQTT_PASS);
+            session.mute = false;
+        }
+        if (!ok)
+        {
+            Serial.println(ready ? "MQTT: broker refused the connection" : "MQTT: no CONNACK");
+            closeSession();
+            brokerRetryLater(now);
+            break;
+        }
+        setLinkState(LINK_ONLINE);
+        onMqttConnected();
+        break;
     }
 
-    mqtt.loop();
+    case LINK_ONLINE:
+        session.fill(); // loop() only sees complete packets, so it never waits
+        if (!mqtt.loop())
+        {
+            Serial.println("MQTT connection lost");
+            closeSession();
+            brokerRetryLater(now);
+            break;
+        }
+        drainQueue();
+        if (mqttQueueDepth() == 0 && sessionWritable())
+            replayBacklog(now); // live data first; a batch fits the free send buffer
+        break;
+    }
+}
+
+bool mqttRadioOn()
+{
+    return linkState != LINK_WIFI_WAIT;
+}
+
+void mqttSuspend(uint32_t ms)
+{
+    uint32_t now = millis();
+    if (pendingFd >= 0)
+    {
+        tcpConnectAbort(pendingFd);
+        pendingFd = -1;
+    }
+    if (linkState == LINK_ONLINE)
+        mqtt.disconnect(); // DISCONNECT, then closes the transport
+    closeSession();
+    suspended = suspended || linkState == LINK_ONLINE;
+
+    // Radio off (esp_wifi_stop()); the next join starts with WiFi.begin()
+    wifiUp = false; // the DISCONNECTED event that follows is not a loss
+    WiFi.disconnect(true);
+    wifiStarted = false;
+    linkDeadline = now + ms;
+    setLinkState(LINK_WIFI_WAIT);
+}
+
+bool mqttIsConnected()
+{
+    return linkState == LINK_ONLINE;
+}
+
+const char *mqttLinkStateName()
+{
+    return linkStateNames[linkState];
 }
 
 bool shouldPublish()
 {
-    return (millis() - lastPublishTime >= PUBLISH_INTERVAL);
+    return (millis() - lastPublishTime >= settings.publishIntervalMs);
 }
 
-void mqttPublishData(float windMs, bool isRaining, float tempC, float humidity, float pressure, int servoAngle)
+uint32_t mqttIdleMs()
 {
-    if (!mqtt.connected())
+    uint32_t now = millis();
+    uint32_t elapsed = now - lastPublishTime;
+    uint32_t idle = elapsed >= settings.publishIntervalMs ? 0 : settings.publishIntervalMs - elapsed;
+    switch (linkState)
     {
-        // Update lastPublishTime to prevent spam
-        lastPublishTime = millis();
-        return; // Silently skip if not connected
+    case LINK_WIFI_JOINING:
+    case LINK_TCP_CONNECTING:
+    case LINK_TLS_HANDSHAKE:
+    case LINK_WAIT_CONNACK:
+        return 0; // the radio has to stay on
+    case LINK_WIFI_WAIT:
+    case LINK_BROKER_WAIT:
+        return reached(now, linkDeadline) ? 0 : min(idle, linkDeadline - now);
+    case LINK_ONLINE:
+        return offlineCount() || mqttQueueDepth() ? 0 : idle;
     }
+    return idle;
+}
 
-    char buffer[64];
+void mqttSetPublishInterval(uint32_t ms)
+{
+    settingsSet(SET_PUBLISH_MS, ms, false);
+}
 
-    Serial.println("\n=== Publishing Sensor Data ===");
+void mqttSetPublishPolicy(uint8_t policy)
+{
+    settingsSet(SET_PUBLISH_POLICY, policy, false);
+}
+
+bool mqttPublishUrgent(bool isRaining, int servoAngle)
+{
+    return linkState == LINK_ONLINE && policyUrgent(isRaining, servoAngle);
+}
 
-    // Wind speed (raw float)
-    snprintf(buffer, sizeof(buffer), "%.2f", windMs);
-    mqtt.publish(MQTT_TOPIC_WIND, buffer);
-    Serial.printf("  Wind: %s\n", buffer);
+void mqttSetPayloadFormat(uint8_t format)
+{
+    settingsSet(SET_PAYLOAD_FORMAT, format, false);
+}
 
-    // Rain (raw boolean: "true" or "false")
-    mqtt.publish(MQTT_TOPIC_RAIN, isRaining ? "true" : "false");
-    Serial.printf("  Rain: %s\n", isRaining ? "true" : "false");
+// UTC seconds once SNTP has synced, 0 before
+static uint32_t utcNow()
+{
+    time_t t = time(nullptr);
+    return t >= 1600000000 ? (uint32_t)t : 0;
+}
 
-    // Temperature (raw float)
-    snprintf(buffer, sizeof(buffer), "%.2f", tempC);
-    mqtt.publish(MQTT_TOPIC_TEMP, buffer);
-    Serial.printf("  Temp: %s\n", buffer);
+static float round2(float v)
+{
+    return roundf(v * 100.0f) / 100.0f;
+}
 
-    // Humidity (raw float)
-    snprintf(buffer, sizeof(buffer), "%.2f", humidity);
-    mqtt.publish(MQTT_TOPIC_HUM, buffer);
-    Serial.printf("  Humidity: %s\n", buffer);
+static uint8_t publishLegacy(uint8_t due, float windMs, bool isRaining, float tempC, float humidity, float pressure,
+                             int servoAngle)
+{
+    static const char *const TOPICS[PUB_METRICS] = {MQTT_TOPIC_WIND, MQTT_TOPIC_RAIN, MQTT_TOPIC_TEMP,
+                                                    MQTT_TOPIC_HUM,  MQTT_TOPIC_PRESSURE, MQTT_TOPIC_MOTOR};
+    static const char *const LABELS[PUB_METRICS] = {"Wind", "Rain", "Temp", "Humidity", "Pressure", "Motor"};
+    char text[PUB_METRICS][16];
+
+    snprintf(text[PUB_WIND], sizeof(text[0]), "%.2f", windMs);
+    snprintf(text[PUB_RAIN], sizeof(text[0]), "%s", isRaining ? "true" : "false");
+    snprintf(text[PUB_TEMP], sizeof(text[0]), "%.2f", tempC);
+    snprintf(text[PUB_HUM], sizeof(text[0]), "%.2f", humidity);
+    snprintf(text[PUB_PRESSURE], sizeof(text[0]), "%.2f", pressure);
+    snprintf(text[PUB_MOTOR], sizeof(text[0]), "%d", servoAngle);
 
-    // Pressure (raw float)
-    snprintf(buffer, sizeof(buffer), "%.2f", pressure);
-    mqtt.publish(MQTT_TOPIC_PRESSURE, buffer);
-    Serial.printf("  Pressure: %s\n", buffer);
+    Serial.println("\n=== Publishing Sensor Data ===");
 
-    // Motor/servo angle (raw int)
-    snprintf(buffer, sizeof(buffer), "%d", servoAngle);
-    mqtt.publish(MQTT_TOPIC_MOTOR, buffer);
-    Serial.printf("  Motor: %s\n", buffer);
+    // Raw values as text, one topic each
+    uint8_t sent = 0;
+    for (uint8_t i = 0; i < PUB_METRICS; i++)
+    {
+        if (!(due & PUB_MASK(i)))
+            continue;
+        if (mqttQueuePush(TOPICS[i], (const uint8_t *)text[i], strlen(text[i]), MQ_COALESCE))
+            sent |= PUB_MASK(i);
+        Serial.printf("  %s: %s\n", LABELS[i], text[i]);
+    }
 
     // Send update notification (raw string)
-    mqtt.publish(MQTT_TOPIC_UPDATE, "updated");
+    mqttQueuePush(MQTT_TOPIC_UPDATE, (const uint8_t *)"updated", 7, MQ_COALESCE);
     Serial.println("  Update: updated");
 
-    lastPublishTime = millis();
     Serial.println("=== Publish Complete ===\n");
+    return sent;
+}
+
+// One document per cycle: a single socket write and one log line instead of seven.
+// The sequence number lets the receiver spot gaps; it restarts with "up" after a reset.
+// Metrics that are not due are left out (the receiver keeps their last value).
+static uint8_t publishDocument(uint8_t due, float windMs, bool isRaining, float tempC, float humidity, float pressure,
+                               int servoAngle)
+{
+    JsonDocument doc;
+    doc["seq"] = publishSeq++;
+    doc["ts"] = utcNow();
+    doc["up"] = millis();
+    if (due & PUB_MASK(PUB_WIND))
+        doc["wind"] = round2(windMs);
+    if (due & PUB_MASK(PUB_RAIN))
+        doc["rain"] = isRaining;
+    if (due & PUB_MASK(PUB_TEMP))
+        doc["temp"] = round2(tempC); // NaN (no BME280) is written as null
+    if (due & PUB_MASK(PUB_HUM))
+        doc["hum"] = round2(humidity);
+    if (due & PUB_MASK(PUB_PRESSURE))
+        doc["pressure"] = round2(pressure);
+    if (due & PUB_MASK(PUB_MOTOR))
+        doc["motor"] = servoAngle;
+
+    static uint8_t buffer[192];
+    bool msgpack = settings.payloadFormat == PAYLOAD_MSGPACK;
+    size_t len = msgpack ? serializeMsgPack(doc, buffer, sizeof(buffer))
+                         : serializeJson(doc, (char *)buffer, sizeof(buffer));
+    const char *topic = msgpack ? MQTT_TOPIC_DATA_MSGPACK : MQTT_TOPIC_DATA;
+
+    // Drop-oldest: a document may carry only some values, so a newer one cannot stand in for it
+    if (len > 0 && mqttQueuePush(topic, buffer, len, MQ_DROP_OLDEST))
+    {
+        Serial.printf("Queued %s (%u bytes)\n", topic, (unsigned)len);
+        return due;
+    }
+    Serial.printf("Publish to %s failed\n", topic);
+    return 0;
+}
+
+void mqttPublishData(float windMs, bool isRaining, float tempC, float humidity, float pressure, int servoAngle)
+{
+    if (!mqtt.connected())
+    {
+        // Keep it for replay once the broker is back
+        offlineStore(isRaining, servoAngle, windMs, tempC, humidity, pressure);
+        lastPublishTime = millis();
+        return;
+    }
+
+    uint32_t now = millis();
+    const float values[PUB_METRICS] = {windMs, isRaining ? 1.0f : 0.0f, tempC, humidity, pressure, (float)servoAngle};
+    uint8_t due = policySelect(values, now);
+    if (due != 0) // nothing moved: no message at all
+    {
+        uint8_t sent = settings.payloadFormat == PAYLOAD_LEGACY
+                           ? publishLegacy(due, windMs, isRaining, tempC, humidity, pressure, servoAngle)
+                           : publishDocument(due, windMs, isRaining, tempC, humidity, pressure, servoAngle);
+        policySent(sent, values, now);
+        profBootMark(BOOT_FIRST_PUBLISH);
+    }
+
+    lastPublishTime = millis();
+}
+
+bool mqttPublishRollup(const char *topic, const char *payload, size_t length)
+{
+    // Every window is distinct data: drop-oldest
+    if (!mqtt.connected() || !mqttQueuePush(topic, (const uint8_t *)payload, length, MQ_DROP_OLDEST))
+        return false;
+    Serial.printf("Queued %s (%u bytes)\n", topic, (unsigned)length);
+    return true;
+}
+
+bool mqttPublishDiagnostics(const char *payload, size_t length)
+{
+    if (!mqtt.connected() || !mqttQueuePush(MQTT_TOPIC_DIAG, (const uint8_t *)payload, length, MQ_COALESCE))
+        return false;
+    Serial.printf("Queued %s (%u bytes)\n", MQTT_TOPIC_DIAG, (unsigned)length);
+    return true;
+}
+
+bool mqttPublishConfig(const char *payload, size_t length)
+{
+    if (!mqtt.connected() || !mqttQueuePush(MQTT_TOPIC_CONFIG, (const uint8_t *)payload, length, MQ_COALESCE))
+        return false;
+    Serial.printf("Queued %s (%u bytes)\n", MQTT_TOPIC_CONFIG, (unsigned)length);
+    return true;
 }
 
 void mqttPublishGPS(float latitude, float longitude)
 {
     if (!mqtt.connected())
     {
-        Serial.println("MQTT not connected, skipping GPS publish");
+        // Sent from onMqttConnected() once the first session is up
+        gpsPending = true;
+        gpsLat = latitude;
+        gpsLon = longitude;
+        Serial.println("MQTT not connected, GPS publish deferred");
         return;
     }
+    gpsPending = false;
 
     char buffer[64];
 
     // GPS coordinates as "lat,lon" format
     snprintf(buffer, sizeof(buffer), "%.8f,%.8f", latitude, longitude);
-    mqtt.publish(MQTT_TOPIC_GPS, buffer);
+    mqttQueuePush(MQTT_TOPIC_GPS, (const uint8_t *)buffer, strlen(buffer), MQ_COALESCE);
 
-    Serial.print("Published GPS coordinates: ");
+    Serial.print("Queued GPS coordinates: ");
     Serial.println(buffer);
 }
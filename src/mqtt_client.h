@@ -2,18 +2,78 @@
 #define MQTT_CLIENT_H
 
 #include <PubSubClient.h>
-#include <ESP32Servo.h>
 
-// Initialize WiFi and MQTT connection
-void mqttInit(Servo &servo);
+#define MQTT_MAX_COMMANDS 8
 
-// Maintain MQTT connection (reconnect if needed)
+// Inbound command handler; payload points into the client's receive buffer
+// and is only valid during the call (not NUL-terminated)
+typedef void (*MqttCommandHandler)(const uint8_t *payload, unsigned int length);
+
+// Initialize WiFi and MQTT (connection is brought up by mqttMaintain)
+void mqttInit();
+
+// Advance the connection state machine and service MQTT (never blocks on the network)
 void mqttMaintain();
 
-// Publish sensor data to MQTT topics
+// True while the MQTT session is up
+bool mqttIsConnected();
+
+// Current connection state, for logging
+const char *mqttLinkStateName();
+
+// Publish sensor data to MQTT topics (offline: buffer it for replay).
+// With PUBLISH_ON_CHANGE only the values outside their deadband go out.
+// Like every publish below it only queues the messages (mqtt_queue);
+// mqttMaintain() writes them as the socket takes them.
 void mqttPublishData(float windMs, bool isRaining, float tempC, float humidity, float pressure, int servoAngle);
 
-// Publish GPS coordinates once at startup
+// True while online if rain or motor changed since it was last sent:
+// publish now rather than at the next interval (PUBLISH_ON_CHANGE only)
+bool mqttPublishUrgent(bool isRaining, int servoAngle);
+
+// Route messages on topic to handler (subscribed on every connect).
+// topic must stay valid (string literal); false if the table is full.
+bool mqttOnCommand(const char *topic, MqttCommandHandler handler);
+
+// In-place payload parsing for handlers
+bool mqttPayloadInt(const uint8_t *payload, unsigned int length, long &value); // whole payload is an integer
+bool mqttPayloadIs(const uint8_t *payload, unsigned int length, const char *word);
+
+// How long the client can be left alone (low-power mode): 0 while a join
+// or connect is in flight or the backlog is replaying, otherwise ms until
+// the next publish or connection attempt
+uint32_t mqttIdleMs();
+
+// False while the radio is idle: not associated, waiting for the next
+// join attempt (a failed join, or mqttSuspend())
+bool mqttRadioOn();
+
+// Low-power mode: close the session and switch the radio off; the link
+// rejoins in ms (through the usual join and connect states). Not a
+// failure: the backoff is untouched and the publish deadbands are kept.
+void mqttSuspend(uint32_t ms);
+
+// Publish interval used by shouldPublish(), until the next reboot
+// (settingsSet() with persist keeps it)
+void mqttSetPublishInterval(uint32_t ms);
+
+// PUBLISH_EVERY or PUBLISH_ON_CHANGE (config.h), until the next reboot
+void mqttSetPublishPolicy(uint8_t policy);
+
+// Select the payload format of mqttPublishData (PAYLOAD_* in config.h),
+// until the next reboot
+void mqttSetPayloadFormat(uint8_t format);
+
+// Publish a rollup document (rollup.cpp); false if offline or it could not be queued
+bool mqttPublishRollup(const char *topic, const char *payload, size_t length);
+
+// Publish a diagnostics document (profiler.cpp); false if offline or it could not be queued
+bool mqttPublishDiagnostics(const char *payload, size_t length);
+
+// Publish the settings in force (settingsFormatJson); false if offline or it could not be queued
+bool mqttPublishConfig(const char *payload, size_t length);
+
+// Publish GPS coordinates (deferred until the first connect if offline)
 void mqttPublishGPS(float latitude, float longitude);
 
 // Check if it's time to publish
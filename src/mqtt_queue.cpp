@@ -0,0 +1,148 @@
+#include "mqtt_queue.h"
+#include "config.h"
+
+// Messages live in a ring of MQTT_QUEUE_SLOTS descriptors; their payloads
+// in a byte arena used as a ring in the same order, each one contiguous (a
+// payload that does not fit before the end starts over at 0 and the end
+// stays unused until the queue passes it). Coalescing only marks the older
+// message dead; its space comes back when it reaches the head. Everything
+// is static, and all calls come from the loop task.
+
+static_assert(MQTT_QUEUE_BYTES <= 65535, "arena offsets are 16-bit");
+
+struct Slot
+{
+    const char *topic;
+    uint16_t offset;
+    uint16_t length;
+    bool live; // false once coalesced away
+};
+
+static Slot slots[MQTT_QUEUE_SLOTS];
+static uint8_t arena[MQTT_QUEUE_BYTES];
+static uint16_t first = 0; // oldest slot
+static uint16_t count = 0; // slots in use, live or dead
+static uint16_t arenaTail = 0;
+static MqttQueueStats stats = {};
+
+static Slot &slotAt(uint16_t i)
+{
+    return slots[(first + i) % MQTT_QUEUE_SLOTS];
+}
+
+// Free one live message's accounting
+static void retire(Slot &s)
+{
+    s.live = false;
+    stats.depth--;
+    stats.bytes -= s.length;
+}
+
+static void removeHead()
+{
+    if (slots[first].live)
+        retire(slots[first]);
+    first = (first + 1) % MQTT_QUEUE_SLOTS;
+    count--;
+}
+
+// Offset of `need` contiguous free bytes, false if there are none
+static bool place(uint16_t need, uint16_t &offset)
+{
+    if (count == 0)
+    {
+        arenaTail = 0;
+        offset = 0;
+        return need <= MQTT_QUEUE_BYTES;
+    }
+    uint16_t head = slots[first].offset;
+    if (arenaTail > head)
+    {
+        // In use: [head, arenaTail); free: the end, then [0, head)
+        offset = MQTT_QUEUE_BYTES - arenaTail >= need ? arenaTail : 0;
+        return offset == arenaTail || head >= need;
+    }
+    // Wrapped: free is [arenaTail, head)
+    offset = arenaTail;
+    return head - arenaTail >= need;
+}
+
+bool mqttQueuePush(const char *topic, const uint8_t *payload, size_t length, MqttQueuePolicy policy)
+{
+    if (length > MQTT_QUEUE_BYTES)
+    {
+        stats.rejected++;
+        return false;
+    }
+
+    if (policy == MQ_COALESCE)
+    {
+        for (uint16_t i = 0; i < count; i++)
+        {
+            Slot &s = slotAt(i);
+            if (s.live && strcmp(s.topic, topic) == 0)
+            {
+                retire(s);
+                stats.coalesced++;
+            }
+        }
+    }
+
+    uint16_t need = length ? (uint16_t)length : 1; // an empty message still owns a byte
+    uint16_t offset;
+    while (count == MQTT_QUEUE_SLOTS || !place(need, offset))
+    {
+        if (slots[first].live)
+            stats.dropped++;
+        removeHead(); // empties the queue at worst, and then it fits
+    }
+
+    memcpy(arena + offset, payload, length);
+    slotAt(count) = Slot{topic, offset, (uint16_t)length, true};
+    count++;
+    arenaTail = offset + need;
+
+    stats.queued++;
+    stats.depth++;
+    stats.bytes += (uint16_t)length;
+    stats.maxDepth = max(stats.maxDepth, stats.depth);
+    stats.maxBytes = max(stats.maxBytes, stats.bytes);
+    return true;
+}
+
+bool mqttQueuePeek(const char *&topic, const uint8_t *&payload, size_t &length)
+{
+    while (count > 0 && !slots[first].live)
+        removeHead();
+    if (count == 0)
+        return false;
+    const Slot &s = slots[first];
+    topic = s.topic;
+    payload = arena + s.offset;
+    length = s.length;
+    return true;
+}
+
+void mqttQueuePop(bool sent)
+{
+    if (count == 0)
+        return;
+    if (slots[first].live)
+    {
+        if (sent)
+            stats.sent++;
+        else
+            stats.rejected++;
+    }
+    removeHead();
+}
+
+uint16_t mqttQueueDepth()
+{
+    return stats.depth;
+}
+
+MqttQueueStats mqttQueueStats()
+{
+    return stats;
+}
@@ -0,0 +1,39 @@
+#ifndef MQTT_QUEUE_H
+#define MQTT_QUEUE_H
+
+#include <Arduino.h>
+
+// What happens to a topic's messages that are still queued
+enum MqttQueuePolicy
+{
+    MQ_DROP_OLDEST, // keep every message; when full the oldest in the queue goes
+    MQ_COALESCE     // a new message replaces the queued one on the same topic
+};
+
+struct MqttQueueStats
+{
+    uint32_t queued;    // messages accepted
+    uint32_t sent;      // handed to the socket
+    uint32_t dropped;   // oldest messages evicted to make room
+    uint32_t coalesced; // replaced by a newer message on the same topic
+    uint32_t rejected;  // larger than the whole arena, or sending failed for good
+    uint16_t depth, maxDepth;
+    uint16_t bytes, maxBytes; // payload arena in use
+};
+
+// Copy a message into the preallocated pool (never blocks, never
+// allocates). topic must stay valid until the message is sent (string
+// literal). False only if the payload can never fit.
+bool mqttQueuePush(const char *topic, const uint8_t *payload, size_t length, MqttQueuePolicy policy);
+
+// Oldest message, without removing it; false if the queue is empty
+bool mqttQueuePeek(const char *&topic, const uint8_t *&payload, size_t &length);
+
+// Remove the oldest message: sent, or rejected if it can never be sent
+void mqttQueuePop(bool sent);
+
+uint16_t mqttQueueDepth();
+
+MqttQueueStats mqttQueueStats();
+
+#endif // MQTT_QUEUE_H
@@ -0,0 +1,280 @@
+#include "offline_buffer.h"
+#include "config.h"
+#include <LittleFS.h>
+#include <time.h>
+
+// /offline.dat is an array of OFFLINE_CAPACITY fixed-size records used as
+// a ring (slot = seq % capacity); /offline.idx holds the head/tail
+// sequence numbers. To keep flash wear down nothing is written while
+// online, samples are staged in RAM and written OFFLINE_FLUSH_RECORDS at a
+// time, and the index is rewritten once per flush and at most every
+// OFFLINE_INDEX_SAVE_MS while replaying; LittleFS is copy-on-write and
+// spreads the erases over the whole partition. A reset between a publish
+// and the next index write replays a few samples twice (receivers can
+// drop duplicates by seq); a reset while offline loses the staged ones.
+
+struct Record
+{
+    OfflineSample s;
+    uint32_t crc;
+};
+static_assert(sizeof(Record) == 36, "on-flash record layout changed");
+
+struct Index
+{
+    uint32_t magic;
+    uint32_t capacity;
+    uint32_t head; // next seq to be written to flash
+    uint32_t tail; // oldest seq not yet delivered
+    uint16_t boot;
+    uint16_t version;
+    uint32_t crc;
+};
+
+static const char *const DATA_PATH = "/offline.dat";
+static const char *const INDEX_PATH = "/offline.idx";
+static const uint32_t INDEX_MAGIC = 0x4C46464F; // "OFFL"
+static const uint16_t INDEX_VERSION = 1;
+static const time_t EPOCH_VALID = 1600000000; // time() below this: SNTP has not synced yet
+
+static bool flashOk = false;
+static uint16_t bootCount = 0;
+static uint32_t head = 0; // flash holds [tail, head), staged holds [head, head + stagedCount)
+static uint32_t tail = 0;
+static OfflineSample staged[OFFLINE_FLUSH_RECORDS];
+static uint8_t stagedCount = 0;
+static uint32_t lastIndexSave = 0;
+static OfflineStats stats = {};
+
+static uint32_t crc32(const uint8_t *data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    while (len--)
+    {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static uint32_t epochNow()
+{
+    time_t t = time(nullptr);
+    return t >= EPOCH_VALID ? (uint32_t)t : 0;
+}
+
+static void saveIndex()
+{
+    if (!flashOk)
+        return;
+    Index idx = {INDEX_MAGIC, OFFLINE_CAPACITY, head, tail, bootCount, INDEX_VERSION, 0};
+    idx.crc = crc32((const uint8_t *)&idx, offsetof(Index, crc));
+    // LittleFS commits on close, so a reset leaves either the old or the new index
+    File f = LittleFS.open(INDEX_PATH, "w");
+    if (f && f.write((const uint8_t *)&idx, sizeof(idx)) == sizeof(idx))
+    {
+        stats.flashWrites++;
+        stats.flashBytes += sizeof(idx);
+    }
+    f.close();
+    lastIndexSave = millis();
+}
+
+// Write n consecutive samples to their slots (split in two at the end of the ring)
+static bool writeRecords(const OfflineSample *src, uint8_t n)
+{
+    File f = LittleFS.open(DATA_PATH, "r+");
+    if (!f)
+        return false;
+
+    Record recs[OFFLINE_FLUSH_RECORDS];
+    for (uint8_t i = 0; i < n; i++)
+    {
+        recs[i].s = src[i];
+        recs[i].crc = crc32((const uint8_t *)&src[i], sizeof(OfflineSample));
+    }
+
+    uint8_t done = 0;
+    while (done < n)
+    {
+        uint32_t slot = src[done].seq % OFFLINE_CAPACITY;
+        uint8_t run = (uint8_t)min<uint32_t>(n - done, OFFLINE_CAPACITY - slot);
+        size_t pos = slot * sizeof(Record);
+
+        // The file grows as the ring fills; pad skipped slots (they fail the CRC)
+        static const uint8_t zeros[sizeof(Record)] = {};
+        for (size_t size = f.size(); size < pos; size += sizeof(Record))
+        {
+            f.seek(size);
+            f.write(zeros, min(sizeof(Record), pos - size));
+        }
+
+        size_t bytes = run * sizeof(Record);
+        if (!f.seek(pos) || f.write((const uint8_t *)&recs[done], bytes) != bytes)
+            return false;
+        stats.flashWrites++;
+        stats.flashBytes += bytes;
+        done += run;
+    }
+    return true;
+}
+
+static bool flushStaged()
+{
+    if (!flashOk)
+        return false;
+    if (!writeRecords(staged, stagedCount))
+    {
+        Serial.println("Offline buffer: flash write failed, buffering in RAM only");
+        flashOk = false;
+        return false;
+    }
+    head += stagedCount;
+    stagedCount = 0;
+    if (head - tail > OFFLINE_CAPACITY)
+    {
+        stats.overwritten += head - tail - OFFLINE_CAPACITY;
+        tail = head - OFFLINE_CAPACITY;
+    }
+    saveIndex();
+    return true;
+}
+
+bool offlineInit()
+{
+    flashOk = LittleFS.begin(true); // formats the partition on first boot
+    if (!flashOk)
+    {
+        Serial.println("Offline buffer: LittleFS mount failed, buffering in RAM only");
+        return false;
+    }
+
+    Index idx;
+    File f = LittleFS.open(INDEX_PATH, "r");
+    bool valid = f && f.read((uint8_t *)&idx, sizeof(idx)) == sizeof(idx) && idx.magic == INDEX_MAGIC &&
+                 idx.version == INDEX_VERSION && idx.capacity == OFFLINE_CAPACITY &&
+                 idx.crc == crc32((const uint8_t *)&idx, offsetof(Index, crc)) &&
+                 idx.head - idx.tail <= OFFLINE_CAPACITY && LittleFS.exists(DATA_PATH);
+    f.close();
+
+    if (valid)
+    {
+        head = idx.head;
+        tail = idx.tail;
+        bootCount = idx.boot + 1;
+    }
+    else
+    {
+        head = tail = 0;
+        bootCount = 1;
+        File d = LittleFS.open(DATA_PATH, "w"); // start with an empty ring
+        d.close();
+    }
+    saveIndex();
+
+    Serial.printf("Offline buffer: %lu samples pending (boot %u, %u/%u KB used)\n", (unsigned long)(head - tail),
+                  bootCount, (unsigned)(LittleFS.usedBytes() / 1024), (unsigned)(LittleFS.totalBytes() / 1024));
+    return true;
+}
+
+void offlineStore(bool raining, int servoAngle, float windMs, float tempC, float humidity, float pressure)
+{
+    OfflineSample &s = staged[stagedCount++];
+    s.seq = head + stagedCount - 1;
+    s.epoch = epochNow();
+    s.uptimeMs = millis();
+    s.boot = bootCount;
+    s.raining = raining;
+    s.servoAngle = (uint8_t)constrain(servoAngle, 0, 180);
+    s.windMs = windMs;
+    s.tempC = tempC;
+    s.humidity = humidity;
+    s.pressure = pressure;
+    stats.stored++;
+
+    if (stagedCount == OFFLINE_FLUSH_RECORDS && !flushStaged())
+    {
+        // No flash: keep the newest OFFLINE_FLUSH_RECORDS samples in RAM
+        memmove(staged, staged + 1, sizeof(staged[0]) * (OFFLINE_FLUSH_RECORDS - 1));
+        stagedCount--;
+        if (tail == head)
+            tail++;
+        head++;
+        stats.overwritten++;
+    }
+}
+
+uint32_t offlineCount()
+{
+    return head - tail + stagedCount;
+}
+
+size_t offlineRead(OfflineSample *out, size_t max)
+{
+    size_t n = 0;
+    uint32_t seq = tail;
+
+    if (seq != head)
+    {
+        File f = flashOk ? LittleFS.open(DATA_PATH, "r") : File();
+        for (; seq != head && n < max; seq++)
+        {
+            Record r;
+            uint32_t slot = seq % OFFLINE_CAPACITY;
+            bool ok = f && (seq == tail || slot == 0 ? f.seek(slot * sizeof(Record)) : true) &&
+                      f.read((uint8_t *)&r, sizeof(r)) == sizeof(r) && r.s.seq == seq &&
+                      r.crc == crc32((const uint8_t *)&r.s, sizeof(OfflineSample));
+            if (ok)
+            {
+                out[n++] = r.s;
+                continue;
+            }
+            stats.corrupt++;
+            if (n == 0)
+            {
+                // Nothing valid before it: drop it now (later ones go with offlineConsumeThrough)
+                tail = seq + 1;
+            }
+        }
+    }
+    if (seq == head)
+    {
+        for (uint8_t i = 0; i < stagedCount && n < max; i++)
+            out[n++] = staged[i];
+    }
+
+    // Captured before SNTP synced: derive the time from uptime, same boot only
+    uint32_t now = epochNow();
+    for (size_t i = 0; i < n && now; i++)
+    {
+        if (out[i].epoch == 0 && out[i].boot == bootCount)
+            out[i].epoch = now - (millis() - out[i].uptimeMs) / 1000;
+    }
+    return n;
+}
+
+void offlineConsumeThrough(uint32_t seq)
+{
+    uint32_t next = seq + 1;
+    if ((int32_t)(next - tail) <= 0)
+        return;
+    if ((int32_t)(next - head) > 0)
+    {
+        // Delivered straight from RAM: these never need to reach flash
+        uint8_t k = (uint8_t)min<uint32_t>(next - head, stagedCount);
+        memmove(staged, staged + k, sizeof(staged[0]) * (stagedCount - k));
+        stagedCount -= k;
+        head += k;
+    }
+    stats.replayed += next - tail;
+    tail = next;
+
+    if (offlineCount() == 0 || millis() - lastIndexSave >= OFFLINE_INDEX_SAVE_MS)
+        saveIndex();
+}
+
+OfflineStats offlineStats()
+{
+    return stats;
+}
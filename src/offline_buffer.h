@@ -0,0 +1,49 @@
+#ifndef OFFLINE_BUFFER_H
+#define OFFLINE_BUFFER_H
+
+#include <Arduino.h>
+
+// One buffered sample (32 bytes on flash plus a CRC)
+struct OfflineSample
+{
+    uint32_t seq;      // assigned by offlineStore(), increases across reboots
+    uint32_t epoch;    // UTC seconds, 0 if unknown
+    uint32_t uptimeMs; // millis() at capture
+    uint16_t boot;     // boot count at capture
+    uint8_t raining;
+    uint8_t servoAngle;
+    float windMs;
+    float tempC;
+    float humidity;
+    float pressure;
+};
+
+struct OfflineStats
+{
+    uint32_t stored;      // samples accepted
+    uint32_t replayed;    // samples consumed after a successful publish
+    uint32_t overwritten; // oldest samples lost to a full ring (or no flash)
+    uint32_t corrupt;     // records skipped on a CRC/sequence mismatch
+    uint32_t flashWrites; // data + index writes
+    uint32_t flashBytes;
+};
+
+// Mount LittleFS and restore the ring; without flash the buffer is RAM only
+bool offlineInit();
+
+// Buffer one sample (timestamped here); written to flash every OFFLINE_FLUSH_RECORDS
+void offlineStore(bool raining, int servoAngle, float windMs, float tempC, float humidity, float pressure);
+
+// Samples waiting for replay (flash and RAM)
+uint32_t offlineCount();
+
+// Copy up to max of the oldest samples, without removing them. Timestamps
+// of samples captured before the clock was set are filled in when possible.
+size_t offlineRead(OfflineSample *out, size_t max);
+
+// Drop everything up to and including seq (after it was delivered)
+void offlineConsumeThrough(uint32_t seq);
+
+OfflineStats offlineStats();
+
+#endif // OFFLINE_BUFFER_H
@@ -0,0 +1,283 @@
+#include "power.h"
+#include "config.h"
+#include "mqtt_client.h"
+#include "scheduler.h"
+
+#if POWER_LOW_POWER
+#include <driver/adc.h>
+#include <driver/rtc_io.h>
+#include <esp32/ulp.h>
+#include <esp_sleep.h>
+#include <soc/rtc_io_reg.h>
+#endif
+
+static PowerStats stats = {};
+
+#if POWER_LOW_POWER
+
+// The ULP program runs every ULP_PERIOD_US whether the cores sleep or not.
+// Each run it samples HALL_PIN and counts debounced falling edges; every
+// ULP_RAIN_EVERY runs it reads RAIN_A0 and RAIN_D0, applies the cores' wet
+// rule and wakes them if the answer has differed from theirs for
+// ULP_RAIN_CONFIRM checks in a row; it skips the check while the cores
+// hold ADC1 (powerAdcClaim()). Shared variables sit at the start of
+// RTC slow memory, the program behind them. The ULP's registers and ALU
+// are 16 bits wide and it writes its own bookkeeping into the upper half
+// of every word it stores, so only the low half is read back.
+
+static_assert(RAIN_A0 == 34, "ULP_ADC_CHANNEL assumes GPIO34");
+static const adc1_channel_t ULP_ADC_CHANNEL = ADC1_CHANNEL_6;
+static const uint16_t DEBOUNCE_TICKS = (MIN_PULSE_US + ULP_PERIOD_US - 1) / ULP_PERIOD_US;
+static const uint16_t LEVEL_NONE = 2; // never equals a pin level: rain check inert until configured
+
+enum UlpVar
+{
+    ULP_TICK,           // runs, wraps
+    ULP_HALL_LEVEL,     // HALL_PIN at the previous run
+    ULP_EDGES,          // debounced falling edges, wraps
+    ULP_EDGE_TICK,      // ULP_TICK at the latest edge
+    ULP_RAIN_COUNTDOWN, // runs until the next rain check
+    ULP_RAIN_BELOW,     // ADC reading below this is wet (from the cores)
+    ULP_RAIN_LEVEL,     // RAIN_D0 level that means wet (from the cores)
+    ULP_RAIN_STATE,     // 1 = wet, as the cores last saw it
+    ULP_RAIN_DISAGREE,  // checks in a row that disagreed
+    ULP_RAIN_RAW,       // latest ADC reading
+    ULP_ADC_CORES,      // 1 while the cores hold ADC1: no conversions
+    ULP_VARS
+};
+
+enum UlpLabel
+{
+    L_RAIN,
+    L_CHECK,
+    L_WET,
+    L_COMPARE,
+    L_AGREE,
+    L_DONE
+};
+
+static bool running = false;
+static uint32_t holdUntilMs = 0;
+
+static uint16_t ulpGet(UlpVar v)
+{
+    return (uint16_t)(RTC_SLOW_MEM[v] & 0xFFFF);
+}
+
+static void ulpSet(UlpVar v, uint16_t value)
+{
+    RTC_SLOW_MEM[v] = value;
+}
+
+void powerInit()
+{
+    int hallBit = RTC_GPIO_IN_NEXT_S + rtc_io_number_get((gpio_num_t)HALL_PIN);
+    int d0Bit = RTC_GPIO_IN_NEXT_S + rtc_io_number_get((gpio_num_t)RAIN_D0);
+    const ulp_insn_t program[] = {
+        I_MOVI(R3, 0), // variable base
+
+        // Tick; R2 keeps it
+        I_LD(R0, R3, ULP_TICK),
+        I_ADDI(R0, R0, 1),
+        I_ST(R0, R3, ULP_TICK),
+        I_MOVR(R2, R0),
+
+        // Falling edge: high last run, low now, and not within the debounce time
+        I_RD_REG(RTC_GPIO_IN_REG, hallBit, hallBit),
+        I_LD(R1, R3, ULP_HALL_LEVEL),
+        I_ST(R0, R3, ULP_HALL_LEVEL),
+        M_BGE(L_RAIN, 1),
+        I_MOVR(R0, R1),
+        M_BL(L_RAIN, 1),
+        I_LD(R1, R3, ULP_EDGE_TICK),
+        I_SUBR(R0, R2, R1),
+        M_BL(L_RAIN, DEBOUNCE_TICKS),
+        I_ST(R2, R3, ULP_EDGE_TICK),
+        I_LD(R0, R3, ULP_EDGES),
+        I_ADDI(R0, R0, 1),
+        I_ST(R0, R3, ULP_EDGES),
+
+        // Rain every ULP_RAIN_EVERY runs
+        M_LABEL(L_RAIN),
+        I_LD(R0, R3, ULP_RAIN_COUNTDOWN),
+        M_BL(L_CHECK, 1),
+        I_SUBI(R0, R0, 1),
+        I_ST(R0, R3, ULP_RAIN_COUNTDOWN),
+        M_BX(L_DONE),
+
+        M_LABEL(L_CHECK),
+        I_MOVI(R0, ULP_RAIN_EVERY - 1),
+        I_ST(R0, R3, ULP_RAIN_COUNTDOWN),
+        I_LD(R0, R3, ULP_ADC_CORES),
+        M_BGE(L_DONE, 1),
+        I_ADC(R1, 0, ULP_ADC_CHANNEL),
+        I_ST(R1, R3, ULP_RAIN_RAW),
+        I_LD(R2, R3, ULP_RAIN_BELOW),
+        I_SUBR(R0, R1, R2), // borrows when raw < below
+        M_BXF(L_WET),
+        I_RD_REG(RTC_GPIO_IN_REG, d0Bit, d0Bit),
+        I_LD(R1, R3, ULP_RAIN_LEVEL),
+        I_SUBR(R0, R0, R1),
+        M_BXZ(L_WET),
+        I_MOVI(R1, 0),
+        M_BX(L_COMPARE),
+        M_LABEL(L_WET),
+        I_MOVI(R1, 1),
+
+        // R1 = wet now; wake the cores once it has disagreed long enough
+        M_LABEL(L_COMPARE),
+        I_LD(R0, R3, ULP_RAIN_STATE),
+        I_SUBR(R0, R0, R1),
+        M_BXZ(L_AGREE),
+        I_LD(R0, R3, ULP_RAIN_DISAGREE),
+        I_ADDI(R0, R0, 1),
+        I_ST(R0, R3, ULP_RAIN_DISAGREE),
+        M_BL(L_DONE, ULP_RAIN_CONFIRM),
+        I_ST(R1, R3, ULP_RAIN_STATE), // one wake per transition even if the cores never answer
+        I_MOVI(R0, 0),
+        I_ST(R0, R3, ULP_RAIN_DISAGREE),
+        I_WAKE(),
+        M_BX(L_DONE),
+        M_LABEL(L_AGREE),
+        I_MOVI(R0, 0),
+        I_ST(R0, R3, ULP_RAIN_DISAGREE),
+
+        M_LABEL(L_DONE),
+        I_HALT(),
+    };
+
+    for (int v = 0; v < ULP_VARS; v++)
+        ulpSet((UlpVar)v, 0);
+    ulpSet(ULP_HALL_LEVEL, 1);
+    ulpSet(ULP_RAIN_LEVEL, LEVEL_NONE);
+
+    size_t size = sizeof(program) / sizeof(program[0]);
+    if (ulp_process_macros_and_load(ULP_VARS, program, &size) != ESP_OK ||
+        ulp_set_wakeup_period(0, ULP_PERIOD_US) != ESP_OK || ulp_run(ULP_VARS) != ESP_OK)
+    {
+        Serial.println("Power: ULP program did not load, staying awake");
+        return;
+    }
+    esp_sleep_enable_ulp_wakeup();
+    running = true;
+    Serial.printf("Power: ULP running every %u us (%u words), light sleep up to %u ms\n", (unsigned)ULP_PERIOD_US,
+                  (unsigned)size, (unsigned)POWER_MAX_SLEEP_MS);
+}
+
+bool powerHallBegin()
+{
+    if (!running || rtc_gpio_init((gpio_num_t)HALL_PIN) != ESP_OK)
+        return false;
+    rtc_gpio_set_direction((gpio_num_t)HALL_PIN, RTC_GPIO_MODE_INPUT_ONLY);
+    return true;
+}
+
+PowerHall powerHallRead()
+{
+    return PowerHall{ulpGet(ULP_EDGES), (uint16_t)(ulpGet(ULP_TICK) - ulpGet(ULP_EDGE_TICK))};
+}
+
+void powerRainBegin()
+{
+    if (!running)
+        return;
+    rtc_gpio_init((gpio_num_t)RAIN_D0);
+    rtc_gpio_set_direction((gpio_num_t)RAIN_D0, RTC_GPIO_MODE_INPUT_ONLY);
+    rtc_gpio_pullup_en((gpio_num_t)RAIN_D0);
+    adc1_config_channel_atten(ULP_ADC_CHANNEL, ADC_ATTEN_DB_11);
+    adc1_ulp_enable();
+}
+
+void powerAdcClaim()
+{
+    if (!running)
+        return;
+    ulpSet(ULP_ADC_CORES, 1);
+    delayMicroseconds(ULP_ADC_HANDOVER_US); // a run that read the flag before it was set finishes its conversion
+}
+
+void powerAdcRelease()
+{
+    if (!running)
+        return;
+    adc1_ulp_enable(); // analogRead() switched the SAR1 controller to the cores
+    ulpSet(ULP_ADC_CORES, 0);
+}
+
+void powerRainWatch(uint16_t wetBelowRaw, uint8_t wetLevel, bool wet)
+{
+    ulpSet(ULP_RAIN_BELOW, wetBelowRaw);
+    ulpSet(ULP_RAIN_LEVEL, wetLevel);
+    ulpSet(ULP_RAIN_STATE, wet ? 1 : 0);
+}
+
+void powerIdle(TFT_eSPI &tft)
+{
+    if (!running || schedulerIdleUs() == 0)
+        return; // tasks still due from this wake
+    uint32_t now = millis();
+    if ((int32_t)(holdUntilMs - now) > 0)
+        return; // a rain transition is being debounced
+    if (ulpGet(ULP_ADC_CORES))
+        return; // a rain reading holds ADC1; the ULP needs it while the cores sleep
+
+    // Light sleep powers the RF down and the AP drops a station that misses
+    // its beacons, so the link is closed and the radio switched off first;
+    // it rejoins POWER_REJOIN_MS before the next publish or retry is due
+    uint32_t idleMs = mqttIdleMs();
+    if (mqttRadioOn())
+    {
+        if (idleMs < POWER_REJOIN_MS + POWER_MIN_SLEEP_MS)
+            return; // not worth a rejoin
+        mqttSuspend(idleMs - POWER_REJOIN_MS);
+        stats.radioOffs++;
+        idleMs = mqttIdleMs();
+    }
+    uint32_t sleepMs = min<uint32_t>(idleMs, min(POWER_DISPLAY_MS, POWER_MAX_SLEEP_MS));
+    if (sleepMs < POWER_MIN_SLEEP_MS)
+        return;
+
+    // Clocks stop in light sleep: let the display DMA and the UART finish
+    tft.dmaWait();
+    Serial.flush();
+
+    esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000);
+    uint32_t t0 = micros();
+    esp_light_sleep_start();
+    stats.sleepUs += (uint32_t)(micros() - t0);
+    stats.sleeps++;
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_ULP)
+    {
+        stats.ulpWakes++;
+        holdUntilMs = millis() + POWER_RAIN_AWAKE_MS;
+    }
+    else
+    {
+        stats.timerWakes++;
+    }
+    schedulerResync();
+}
+
+#else
+
+void powerInit() {}
+bool powerHallBegin()
+{
+    return false;
+}
+PowerHall powerHallRead()
+{
+    return PowerHall{0, 0};
+}
+void powerRainBegin() {}
+void powerAdcClaim() {}
+void powerAdcRelease() {}
+void powerRainWatch(uint16_t, uint8_t, bool) {}
+void powerIdle(TFT_eSPI &) {}
+
+#endif
+
+PowerStats powerStats()
+{
+    return stats;
+}
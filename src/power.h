@@ -0,0 +1,57 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+
+// Low-power mode (POWER_LOW_POWER): the ULP coprocessor keeps counting
+// hall pulses and checking the rain sensor while the cores are in light
+// sleep. Without it every call here is a no-op.
+
+struct PowerStats
+{
+    uint32_t sleeps;
+    uint32_t timerWakes; // publish, display refresh, connection retry
+    uint32_t ulpWakes;   // rain transitions seen by the ULP
+    uint32_t radioOffs;  // link suspended for a sleep (mqttSuspend())
+    uint64_t sleepUs;    // time in light sleep
+};
+
+// What the ULP has seen on HALL_PIN
+struct PowerHall
+{
+    uint16_t edges;          // debounced falling edges, wraps
+    uint16_t ticksSinceEdge; // ULP runs (ULP_PERIOD_US) since the latest one, wraps
+};
+
+// Load and start the ULP program (call before the sensor inits)
+void powerInit();
+
+// Hand HALL_PIN to the ULP (wind sensor); false if it cannot sample it
+bool powerHallBegin();
+PowerHall powerHallRead();
+
+// Hand RAIN_D0 and RAIN_A0 to the ULP (rain sensor)
+void powerRainBegin();
+
+// Take ADC1 from the ULP around analogRead(RAIN_A0), and give it back.
+// The ULP skips its rain check while the cores hold it, and the claim
+// waits out a conversion already in flight; powerIdle() does not sleep
+// while it is held. Call both from the task that runs powerIdle(), which is
+// why low-power builds sample in the loop scheduler (ACQ_DUAL_CORE 0).
+void powerAdcClaim();
+void powerAdcRelease();
+
+// The rain state the cores last computed: the ULP wakes them once it
+// disagrees for ULP_RAIN_CONFIRM checks in a row. Wet means a reading below
+// wetBelowRaw or RAIN_D0 at wetLevel, the same rule as rainFilterStep().
+void powerRainWatch(uint16_t wetBelowRaw, uint8_t wetLevel, bool wet);
+
+// Call from loop() after schedulerRun(): once every due task has run,
+// switch the radio off (mqttSuspend()) and sleep until the next display
+// refresh or a rain transition, waking POWER_REJOIN_MS before a publish
+void powerIdle(TFT_eSPI &tft);
+
+PowerStats powerStats();
+
+#endif // POWER_H
@@ -0,0 +1,239 @@
+#include "profiler.h"
+#include "config.h"
+#include "mqtt_client.h"
+
+// Log-scale histogram: four buckets per power of two, so a bucket spans at
+// most 25 % of its value; 32-bit cycle counts need 124 buckets. Windows
+// restart at every profPublish(): it only flags the stages, and each one
+// clears its histogram at its next profRecord(), in the task that times it.
+
+static const uint8_t SUB_BITS = 2;
+static const uint8_t SUBS = 1 << SUB_BITS;
+static const uint8_t BUCKETS = (32 - SUB_BITS + 1) * SUBS;
+
+struct Histogram
+{
+    uint32_t buckets[BUCKETS];
+    uint32_t count;
+    uint32_t maxCycles;
+    uint32_t overruns;
+    uint64_t sumCycles;
+};
+
+static const char *const NAMES[PROF_STAGES] = {"rain", "wind", "bme", "ui", "publish", "mqtt"};
+
+static const char *const BOOT_NAMES[BOOT_MILESTONES] = {"setup", "sample", "frame", "rain_cal",
+                                                         "wifi", "mqtt", "publish"};
+static const uint8_t BOOT_PHASES = 12;
+
+static Histogram hist[PROF_STAGES];
+static volatile bool clearPending[PROF_STAGES]; // set by profPublish(), cleared by the stage's own task
+static uint32_t overrunCycles = 0;
+static uint32_t cyclesPerUs = 240;
+static uint32_t selfCycles = 0; // cost of one profBegin()/profEnd() pair
+static uint32_t windowStartUs = 0; // micros(): the cycle counter wraps every ~18 s at 240 MHz
+static uint32_t windowStartMs = 0;
+
+struct BootPhase
+{
+    const char *name;
+    uint32_t ms;
+};
+
+static BootPhase bootPhases[BOOT_PHASES];
+static uint8_t bootPhaseCount = 0;
+static uint32_t bootPhaseStartMs = 0;
+static volatile uint32_t bootMs[BOOT_MILESTONES]; // 0 = not reached (millis() is past 0 by then)
+
+static inline uint8_t bucketOf(uint32_t cycles)
+{
+    if (cycles < SUBS)
+        return (uint8_t)cycles;
+    uint8_t octave = 31 - __builtin_clz(cycles); // >= SUB_BITS
+    uint8_t sub = (cycles >> (octave - SUB_BITS)) & (SUBS - 1);
+    return (uint8_t)((octave - SUB_BITS + 1) * SUBS + sub);
+}
+
+// Largest cycle count that falls in bucket b
+static uint32_t bucketTop(uint8_t b)
+{
+    if (b < SUBS)
+        return b;
+    uint8_t octave = b / SUBS + SUB_BITS - 1;
+    uint8_t sub = b % SUBS;
+    uint64_t low = (uint64_t)(SUBS + sub) << (octave - SUB_BITS);
+    uint64_t top = low + ((uint64_t)1 << (octave - SUB_BITS)) - 1;
+    return top > UINT32_MAX ? UINT32_MAX : (uint32_t)top;
+}
+
+static void record(Histogram &h, uint32_t cycles)
+{
+    h.buckets[bucketOf(cycles)]++;
+    h.count++;
+    h.sumCycles += cycles;
+    if (cycles > h.maxCycles)
+        h.maxCycles = cycles;
+    if (cycles > overrunCycles)
+        h.overruns++;
+}
+
+void profRecord(ProfStage stage, uint32_t cycles)
+{
+    if (clearPending[stage])
+    {
+        memset(&hist[stage], 0, sizeof(hist[stage]));
+        clearPending[stage] = false;
+    }
+    record(hist[stage], cycles);
+}
+
+void profInit()
+{
+    cyclesPerUs = ESP.getCpuFreqMHz();
+    overrunCycles = PROF_OVERRUN_US * cyclesPerUs;
+
+    // Time an empty stage into a scratch histogram
+    static Histogram scratch;
+    uint32_t start = ESP.getCycleCount();
+    for (uint8_t i = 0; i < 64; i++)
+    {
+        uint32_t t0 = profBegin();
+        record(scratch, ESP.getCycleCount() - t0);
+    }
+    selfCycles = (ESP.getCycleCount() - start) / 64;
+
+    windowStartUs = micros();
+    windowStartMs = millis();
+}
+
+void profBootPhase(const char *name)
+{
+    uint32_t now = millis();
+    if (bootPhaseCount < BOOT_PHASES)
+        bootPhases[bootPhaseCount++] = BootPhase{name, now - bootPhaseStartMs};
+    bootPhaseStartMs = now;
+}
+
+void profBootMark(BootMilestone m)
+{
+    if (bootMs[m])
+        return;
+    uint32_t now = max<uint32_t>(millis(), 1);
+    bootMs[m] = now;
+    if (m != BOOT_SETUP)
+    {
+        Serial.printf("Boot: %s at %lu ms\n", BOOT_NAMES[m], (unsigned long)now);
+        return;
+    }
+    Serial.printf("Boot: setup %lu ms (", (unsigned long)now);
+    for (uint8_t i = 0; i < bootPhaseCount; i++)
+        Serial.printf("%s%s %lu", i ? ", " : "", bootPhases[i].name, (unsigned long)bootPhases[i].ms);
+    Serial.println(")");
+}
+
+uint32_t profBootMs(BootMilestone m)
+{
+    return bootMs[m];
+}
+
+const char *profBootName(BootMilestone m)
+{
+    return m < BOOT_MILESTONES ? BOOT_NAMES[m] : "?";
+}
+
+static uint32_t percentileCycles(const Histogram &h, uint32_t permille)
+{
+    if (h.count == 0)
+        return 0;
+    uint32_t rank = (uint32_t)(((uint64_t)h.count * permille + 999) / 1000); // 1-based
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < BUCKETS; b++)
+    {
+        seen += h.buckets[b];
+        if (seen >= rank)
+            return min(bucketTop(b), h.maxCycles);
+    }
+    return h.maxCycles;
+}
+
+// The stage's histogram for the current window
+static const Histogram &window(ProfStage stage)
+{
+    static const Histogram cleared = {};
+    return clearPending[stage] ? cleared : hist[stage]; // published, not run since
+}
+
+ProfSummary profSummary(ProfStage stage)
+{
+    const Histogram &h = window(stage);
+    return ProfSummary{h.count, percentileCycles(h, 500) / cyclesPerUs, percentileCycles(h, 990) / cyclesPerUs,
+                       h.maxCycles / cyclesPerUs, h.overruns};
+}
+
+const char *profStageName(ProfStage stage)
+{
+    return NAMES[stage];
+}
+
+// Share of the window spent inside the instrumentation itself, in 1/1000 %
+static uint32_t overheadMilliPct()
+{
+    uint64_t records = 0;
+    for (uint8_t i = 0; i < PROF_STAGES; i++)
+        records += window((ProfStage)i).count;
+    uint64_t cycles = (uint64_t)(micros() - windowStartUs) * cyclesPerUs;
+    return cycles ? (uint32_t)(records * selfCycles * 100000ull / cycles) : 0;
+}
+
+void profReport()
+{
+    Serial.println("stage       runs   p50    p99    max   ovr (us)");
+    for (uint8_t i = 0; i < PROF_STAGES; i++)
+    {
+        ProfSummary s = profSummary((ProfStage)i);
+        Serial.printf("%-8s %7lu %6lu %6lu %6lu %5lu\n", NAMES[i], (unsigned long)s.count,
+                      (unsigned long)s.p50Us, (unsigned long)s.p99Us, (unsigned long)s.maxUs,
+                      (unsigned long)s.overruns);
+    }
+    uint32_t ov = overheadMilliPct();
+    Serial.printf("heap %lu free, %lu min; profiling %lu cycles per stage, %lu.%03lu %% of the window\n",
+                  (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap(), (unsigned long)selfCycles,
+                  (unsigned long)(ov / 1000), (unsigned long)(ov % 1000));
+}
+
+void profPublish()
+{
+    char payload[768];
+    uint32_t ov = overheadMilliPct();
+    int len = snprintf(payload, sizeof(payload),
+                       "{\"up\":%lu,\"window_s\":%lu,\"heap\":{\"free\":%lu,\"min\":%lu},\"overhead_pct\":%lu.%03lu",
+                       (unsigned long)millis(), (unsigned long)((millis() - windowStartMs) / 1000),
+                       (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap(),
+                       (unsigned long)(ov / 1000), (unsigned long)(ov % 1000));
+    for (uint8_t i = 0; i < PROF_STAGES && len > 0 && (size_t)len < sizeof(payload); i++)
+    {
+        ProfSummary s = profSummary((ProfStage)i);
+        len += snprintf(payload + len, sizeof(payload) - len,
+                        ",\"%s\":{\"n\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu,\"ovr\":%lu}", NAMES[i],
+                        (unsigned long)s.count, (unsigned long)s.p50Us, (unsigned long)s.p99Us,
+                        (unsigned long)s.maxUs, (unsigned long)s.overruns);
+    }
+    for (uint8_t i = 0; i < BOOT_MILESTONES && len > 0 && (size_t)len < sizeof(payload); i++)
+    {
+        len += snprintf(payload + len, sizeof(payload) - len, "%s\"%s\":%lu", i ? "," : ",\"boot\":{",
+                        BOOT_NAMES[i], (unsigned long)bootMs[i]);
+    }
+    if (len > 0 && (size_t)len < sizeof(payload) - 2)
+    {
+        payload[len++] = '}';
+        payload[len++] = '}';
+        payload[len] = '\0';
+        mqttPublishDiagnostics(payload, (size_t)len);
+    }
+
+    // Next window; a stage in the other task may land one sample either side
+    for (uint8_t i = 0; i < PROF_STAGES; i++)
+        clearPending[i] = true;
+    windowStartUs = micros();
+    windowStartMs = millis();
+}
@@ -0,0 +1,83 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+
+// Per-stage latency histograms from the CPU cycle counter. A stage is
+// timed as
+//     uint32_t t0 = profBegin();
+//     ...
+//     profEnd(PROF_RAIN, t0);
+// which costs two cycle-counter reads and a few dozen cycles to bucket the
+// delta. Each stage must only be timed from one pinned task; that task also
+// clears the stage's histogram when profPublish() starts a new window. A
+// loop-side stage includes any acquisition tick that preempted it.
+
+enum ProfStage
+{
+    PROF_RAIN,    // rainSensorUpdate()
+    PROF_WIND,    // readWind()
+    PROF_BME,     // bmeSensorUpdate() + bmeSensorRead()
+    PROF_UI,      // uiUpdate()
+    PROF_PUBLISH, // mqttPublishData()
+    PROF_MQTT,    // mqttMaintain()
+    PROF_STAGES
+};
+
+struct ProfSummary
+{
+    uint32_t count;
+    uint32_t p50Us, p99Us, maxUs; // percentiles are bucket upper bounds (within 25 %)
+    uint32_t overruns;            // runs longer than PROF_OVERRUN_US
+};
+
+static inline uint32_t profBegin()
+{
+    return ESP.getCycleCount();
+}
+
+void profRecord(ProfStage stage, uint32_t cycles);
+
+static inline void profEnd(ProfStage stage, uint32_t t0)
+{
+    profRecord(stage, ESP.getCycleCount() - t0);
+}
+
+// Measure the cost of one timed stage (call once at boot)
+void profInit();
+
+// Boot timeline, in ms since reset. setup() is split into phases, each
+// closed by profBootPhase(); the milestones after it are reached in the
+// background and recorded once each (the first occurrence), from any core.
+enum BootMilestone
+{
+    BOOT_SETUP,         // setup() returned, the scheduler takes over
+    BOOT_FIRST_SAMPLE,  // first acquisition sample on the loop side
+    BOOT_FIRST_FRAME,   // first live values on the display
+    BOOT_RAIN_CAL,      // rain dry reference learned
+    BOOT_WIFI,          // associated, IP assigned
+    BOOT_MQTT,          // first MQTT session up
+    BOOT_FIRST_PUBLISH, // first data cycle queued for the broker
+    BOOT_MILESTONES
+};
+
+// Close the setup() phase that started at the previous call (or at reset)
+void profBootPhase(const char *name);
+
+// Record a milestone and log it; BOOT_SETUP also logs the phase table
+void profBootMark(BootMilestone m);
+
+// When a milestone was reached, 0 if not yet
+uint32_t profBootMs(BootMilestone m);
+const char *profBootName(BootMilestone m);
+
+ProfSummary profSummary(ProfStage stage);
+const char *profStageName(ProfStage stage);
+
+// Per-stage table on Serial
+void profReport();
+
+// Publish the window (and the boot timeline) on MQTT_TOPIC_DIAG and start a new one
+void profPublish();
+
+#endif // PROFILER_H
@@ -0,0 +1,108 @@
+#include "publish_policy.h"
+#include "config.h"
+#include "settings.h"
+
+// Report by exception: each metric is compared with the value last sent,
+// not the previous sample, so a slow drift still goes out once it adds up
+// to the deadband. A deadband of 0 means any change. NAN (sensor missing)
+// equals NAN and differs from every number.
+
+static const char *const NAMES[PUB_METRICS] = {"wind", "rain", "temp", "hum", "pressure", "motor"};
+
+static float lastSent[PUB_METRICS];
+static uint32_t lastSentMs[PUB_METRICS];
+static uint8_t sentMask = 0; // metrics with a valid lastSent
+static PublishStats stats = {};
+
+// Deadbands are runtime settings, read on every comparison
+static float deadband(PublishMetric m)
+{
+    switch (m)
+    {
+    case PUB_WIND:
+        return settings.deadbandWind;
+    case PUB_TEMP:
+        return settings.deadbandTemp;
+    case PUB_HUM:
+        return settings.deadbandHum;
+    case PUB_PRESSURE:
+        return settings.deadbandPressure;
+    default:
+        return 0;
+    }
+}
+
+static bool moved(PublishMetric m, float v)
+{
+    float prev = lastSent[m];
+    if (isnan(v) || isnan(prev))
+        return isnan(v) != isnan(prev);
+    float d = fabsf(v - prev);
+    float band = deadband(m);
+    return band > 0 ? d >= band : d > 0;
+}
+
+void policyReset()
+{
+    sentMask = 0;
+}
+
+uint8_t policySelect(const float values[PUB_METRICS], uint32_t now)
+{
+    if (settings.publishPolicy == PUBLISH_EVERY)
+        return PUB_ALL;
+
+    uint8_t due = 0;
+    for (uint8_t i = 0; i < PUB_METRICS; i++)
+    {
+        PublishMetric m = (PublishMetric)i;
+        if (!(sentMask & PUB_MASK(m)) || moved(m, values[m]))
+        {
+            due |= PUB_MASK(m);
+        }
+        else if (now - lastSentMs[m] >= settings.heartbeatMs)
+        {
+            due |= PUB_MASK(m);
+            stats.heartbeats++;
+        }
+        else
+        {
+            stats.suppressed[m]++;
+        }
+    }
+    return due;
+}
+
+void policySent(uint8_t mask, const float values[PUB_METRICS], uint32_t now)
+{
+    for (uint8_t i = 0; i < PUB_METRICS; i++)
+    {
+        if (!(mask & PUB_MASK(i)))
+            continue;
+        lastSent[i] = values[i];
+        lastSentMs[i] = now;
+        stats.sent[i]++;
+    }
+    sentMask |= mask;
+}
+
+bool policyUrgent(bool raining, int servoAngle)
+{
+    if (settings.publishPolicy == PUBLISH_EVERY)
+        return false;
+    bool urgent = ((sentMask & PUB_MASK(PUB_RAIN)) && moved(PUB_RAIN, raining ? 1.0f : 0.0f)) ||
+                  ((sentMask & PUB_MASK(PUB_MOTOR)) && moved(PUB_MOTOR, (float)servoAngle));
+    if (urgent)
+        stats.immediate++;
+    return urgent;
+}
+
+PublishStats policyStats()
+{
+    return stats;
+}
+
+const char *policyMetricName(PublishMetric m)
+{
+    return m < PUB_METRICS ? NAMES[m] : "?";
+}
@@ -0,0 +1,49 @@
+#ifndef PUBLISH_POLICY_H
+#define PUBLISH_POLICY_H
+
+#include <Arduino.h>
+
+// Metrics of one mqttPublishData() cycle
+enum PublishMetric
+{
+    PUB_WIND,     // m/s
+    PUB_RAIN,     // 0/1
+    PUB_TEMP,     // °C
+    PUB_HUM,      // %
+    PUB_PRESSURE, // hPa
+    PUB_MOTOR,    // servo angle
+    PUB_METRICS
+};
+
+#define PUB_MASK(m) (1u << (m))
+#define PUB_ALL ((1u << PUB_METRICS) - 1)
+
+struct PublishStats
+{
+    uint32_t sent[PUB_METRICS];       // values written to the broker
+    uint32_t suppressed[PUB_METRICS]; // values held back inside their deadband
+    uint32_t immediate;               // cycles triggered by a rain/motor change
+    uint32_t heartbeats;              // values sent only because heartbeat_ms expired
+};
+
+// Forget what was sent: the next cycle sends every metric (new session)
+void policyReset();
+
+// Metrics to send this cycle (PUB_MASK bits): the ones that moved beyond
+// their deadband since they were last sent, changed at all (rain, motor),
+// were never sent, or were last sent heartbeat_ms ago. The rest count as
+// suppressed. Mode, deadbands and heartbeat come from settings.
+uint8_t policySelect(const float values[PUB_METRICS], uint32_t now);
+
+// Record what actually went out; metrics not sent stay due
+void policySent(uint8_t mask, const float values[PUB_METRICS], uint32_t now);
+
+// True if rain or motor differs from what was last sent (publish now,
+// without waiting for the interval)
+bool policyUrgent(bool raining, int servoAngle);
+
+PublishStats policyStats();
+
+const char *policyMetricName(PublishMetric m);
+
+#endif // PUBLISH_POLICY_H
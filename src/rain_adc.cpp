@@ -0,0 +1,100 @@
+#include "rain_adc.h"
+#include "config.h"
+#include <driver/adc.h>
+#include <driver/i2s.h>
+
+// On the classic ESP32 the only DMA path for the SAR ADC is I2S0 in
+// built-in ADC mode (ADC1 only). Filtering is two boxcar stages:
+// RAIN_ADC_DECIMATE samples are summed into one decimated value, and the
+// output is the mean of the last RAIN_ADC_SMOOTH decimated sums, kept as
+// a float so the extra resolution from oversampling is not rounded away.
+
+static_assert(RAIN_A0 == 34, "RAIN_ADC_CHANNEL assumes GPIO34");
+static const adc1_channel_t RAIN_ADC_CHANNEL = ADC1_CHANNEL_6;
+static const i2s_port_t RAIN_I2S = I2S_NUM_0;
+
+static bool running = false;
+
+static uint32_t accSum = 0;
+static uint16_t accCount = 0;
+static uint32_t window[RAIN_ADC_SMOOTH]; // decimated sums
+static uint32_t windowSum = 0;
+static uint8_t windowPos = 0;
+static uint8_t windowFill = 0;
+
+static RainAdcStats stats = {};
+
+bool rainAdcBegin()
+{
+    i2s_config_t cfg = {};
+    cfg.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN);
+    cfg.sample_rate = RAIN_ADC_SAMPLE_RATE;
+    cfg.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+    cfg.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+    cfg.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    cfg.dma_buf_count = RAIN_ADC_DMA_BUFS;
+    cfg.dma_buf_len = RAIN_ADC_DMA_LEN;
+
+    if (i2s_driver_install(RAIN_I2S, &cfg, 0, nullptr) != ESP_OK)
+        return false;
+    if (i2s_set_adc_mode(ADC_UNIT_1, RAIN_ADC_CHANNEL) != ESP_OK ||
+        adc1_config_channel_atten(RAIN_ADC_CHANNEL, ADC_ATTEN_DB_11) != ESP_OK ||
+        i2s_adc_enable(RAIN_I2S) != ESP_OK)
+    {
+        i2s_driver_uninstall(RAIN_I2S);
+        return false;
+    }
+    running = true;
+    return true;
+}
+
+static inline void addSample(uint16_t v)
+{
+    accSum += v;
+    if (++accCount < RAIN_ADC_DECIMATE)
+        return;
+
+    windowSum += accSum - window[windowPos];
+    window[windowPos] = accSum;
+    windowPos = (windowPos + 1) % RAIN_ADC_SMOOTH;
+    if (windowFill < RAIN_ADC_SMOOTH)
+        windowFill++;
+    stats.decimated++;
+    accSum = 0;
+    accCount = 0;
+}
+
+bool rainAdcRead(float &raw)
+{
+    if (!running)
+        return false;
+
+    static uint16_t buf[RAIN_ADC_DMA_LEN];
+    size_t bytes = 0;
+    // Zero timeout: only whole DMA buffers that are already complete
+    while (i2s_read(RAIN_I2S, buf, sizeof(buf), &bytes, 0) == ESP_OK && bytes > 0)
+    {
+        size_t n = bytes / sizeof(buf[0]);
+        for (size_t i = 0; i < n; i++)
+        {
+            // bits 15..12: channel, 11..0: conversion
+            if ((buf[i] >> 12) != RAIN_ADC_CHANNEL)
+            {
+                stats.rejected++;
+                continue;
+            }
+            addSample(buf[i] & 0x0FFF);
+        }
+        stats.samples += n;
+    }
+
+    if (windowFill == 0)
+        return false;
+    raw = (float)windowSum / (float)(windowFill * RAIN_ADC_DECIMATE);
+    return true;
+}
+
+RainAdcStats rainAdcStats()
+{
+    return stats;
+}
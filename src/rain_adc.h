@@ -0,0 +1,24 @@
+#ifndef RAIN_ADC_H
+#define RAIN_ADC_H
+
+#include <Arduino.h>
+
+struct RainAdcStats
+{
+    uint32_t samples;   // conversions consumed
+    uint32_t decimated; // decimated values produced
+    uint32_t rejected;  // samples tagged with another channel
+};
+
+// Start continuous DMA sampling of RAIN_A0 (analogRead() on ADC1 is
+// unavailable afterwards); false if the driver could not be set up
+bool rainAdcBegin();
+
+// Drain the DMA buffers without waiting, run the samples through the
+// decimation filter and return the filtered reading in ADC counts.
+// False until the first decimated value exists.
+bool rainAdcRead(float &raw);
+
+RainAdcStats rainAdcStats();
+
+#endif // RAIN_ADC_H
@@ -1,15 +1,67 @@
 #include "rain_sensor.h"
 #include "config.h"
+#include "rain_adc.h"
+#include "power.h"
+#include "settings.h"
+#include "profiler.h"
 
-// --- Auto-cal references ---
-static uint16_t dryRef = 3500; // learned at boot
-static uint16_t wetRef = 1500; // tracks "wettest recent"
+#include <Preferences.h>
+#include <atomic>
+#include <rain_filter.h>
+
+// --- Auto-cal references and eased wetness (integer pipeline) ---
+static RainFilter filter = {3500, 1500, 0}; // dryRef learned at boot, wetRef tracks "wettest recent"
 
 // Digital polarity: true if digital pin reads LOW when wet (common)
 static bool digitalWetIsLow = true;
 
-// --- State / animation ---
-static float dispPct = 0.0f;
+// Continuous DMA sampling running (otherwise blocking averages)
+static bool adcContinuous = false;
+static uint16_t lastRaw = 0;
+
+// Pending rainSensorRequestCalibration(): -1 none, 0 current reading, else dryRef
+static volatile int32_t calRequest = -1;
+
+// Pending rainSensorRequestServo(): -1 none, 0 dry angle, 1 wet angle
+static volatile int8_t servoRequest = -1;
+
+// Boot auto-cal progress (bootCalibrate()); complete from the start on a warm start
+static uint8_t bootCalTicks = 0;
+static uint32_t bootCalSum = 0;
+static uint32_t bootCalStartMs = 0;
+
+// Learned references in NVS, so a reboot (a brownout during rain) does not
+// calibrate against a wet plate. One blob, written whole.
+struct SavedCal
+{
+    uint8_t version;
+    uint8_t wetIsLow;
+    uint16_t dryRef;
+    uint16_t wetRef;
+};
+static const uint8_t SAVED_CAL_VERSION = 1;
+static const char *const SAVED_CAL_KEY = "cal";
+
+static Preferences calStore;
+static bool calStoreOk = false;
+static SavedCal saved = {};   // what NVS holds (version 0 = nothing)
+static uint32_t savedMs = 0;  // millis() of the last write (or the warm start)
+static uint32_t savedGen = 0; // calibration generation of the last write
+
+// The references as the acquisition side last published them (publishCal()),
+// for rainSensorSaveCalibration() in the loop task. calSeq is odd while the
+// copy is being written; a reader that sees it odd or changed skips the
+// round. gen counts (re)calibrations, so one that lands after a snapshot
+// is not lost the way a cleared flag would lose it.
+struct CalSnapshot
+{
+    SavedCal cal; // version 0 until the references are known
+    uint32_t gen;
+};
+static CalSnapshot calSnap = {};
+static std::atomic<uint32_t> calSeq{0};
+
+// --- State ---
 static uint32_t lastChangeMs = 0;
 static bool stateWet = false;
 
@@ -19,18 +71,98 @@ static uint32_t drySeenSince = 0;
 static uint32_t servoLastChange = 0;
 static bool servoAtWet = false; // true => 90°, false => 0°
 
-// Helper: average multiple analog reads
+// Helper: average multiple analog reads (ADC1 taken from the ULP meanwhile)
 static uint16_t avgRead(int pin, int n = AVG_SAMPLES)
 {
     uint32_t s = 0;
+    powerAdcClaim();
     for (int i = 0; i < n; i++)
     {
         s += analogRead(pin);
         delay(2);
     }
+    powerAdcRelease();
     return s / n;
 }
 
+// Latest rain reading: the DMA filter output when continuous sampling
+// runs (no waiting), otherwise a short blocking average
+static uint16_t readRainRaw()
+{
+    if (!adcContinuous)
+        return avgRead(RAIN_A0);
+    float filtered;
+    if (rainAdcRead(filtered))
+        lastRaw = (uint16_t)lroundf(filtered);
+    return lastRaw; // first DMA buffer not in yet: hold the boot reading
+}
+
+// Acquisition side: publish the references if they changed (always after a
+// (re)calibration, which also bumps the generation)
+static void publishCal(bool recalibrated)
+{
+    SavedCal c = {SAVED_CAL_VERSION, (uint8_t)(digitalWetIsLow ? 1 : 0), filter.dryRef, filter.wetRef};
+    if (!recalibrated && memcmp(&c, &calSnap.cal, sizeof(c)) == 0)
+        return;
+    uint32_t seq = calSeq.load(std::memory_order_relaxed);
+    calSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    calSnap.cal = c;
+    if (recalibrated)
+        calSnap.gen++;
+    calSeq.store(seq + 2, std::memory_order_release);
+}
+
+// Loop side: a consistent copy, or false if publishCal() was in the middle
+// of one (never waits: it may have been preempted on this core)
+static bool readCal(CalSnapshot &out)
+{
+    uint32_t seq = calSeq.load(std::memory_order_acquire);
+    if (seq & 1)
+        return false;
+    out = calSnap;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return calSeq.load(std::memory_order_relaxed) == seq;
+}
+
+// Take the saved references if the boot reading agrees with them: nullptr
+// on success, otherwise why a fresh calibration is needed. A reading well
+// below the saved dry reference is rain only if RAIN_D0 says so too;
+// otherwise the dry level itself has dropped (only upward drift is
+// learned) and the saved reference is stale.
+static const char *warmStart(uint16_t raw, int d0)
+{
+    SavedCal c;
+    if (!calStoreOk || calStore.getBytesLength(SAVED_CAL_KEY) != sizeof(c) ||
+        calStore.getBytes(SAVED_CAL_KEY, &c, sizeof(c)) != sizeof(c) || c.version != SAVED_CAL_VERSION)
+        return "no saved calibration";
+    if (c.dryRef >= 4000 || c.wetRef > c.dryRef || c.wetIsLow > 1)
+        return "saved calibration out of range";
+    if (raw >= 4000)
+        return "ADC saturated";
+    bool d0Wet = c.wetIsLow ? (d0 == 0) : (d0 == 1);
+    if (raw > c.dryRef + RAIN_WARM_TOLERANCE)
+        return "plate reads drier than the saved dry reference";
+    if (raw + RAIN_WARM_TOLERANCE >= c.dryRef)
+    {
+        if (d0Wet)
+            return "RAIN_D0 reads wet on a dry plate"; // polarity or threshold changed
+    }
+    else if (!d0Wet)
+    {
+        return "analog reads wet, RAIN_D0 dry";
+    }
+
+    saved = c;
+    savedMs = millis();
+    filter.dryRef = c.dryRef;
+    filter.wetRef = c.wetRef;
+    digitalWetIsLow = c.wetIsLow;
+    bootCalTicks = RAIN_BOOT_CAL_TICKS; // nothing left to learn
+    publishCal(false);                  // already in NVS
+    return nullptr;
+}
+
 void rainSensorInit(Servo &servo)
 {
     // ADC for rain
@@ -38,87 +170,105 @@ void rainSensorInit(Servo &servo)
     analogSetPinAttenuation(RAIN_A0, ADC_11db);
     pinMode(RAIN_D0, INPUT_PULLUP); // avoid floating
 
-    // Auto-cal DRY at boot (keep plate dry ~0.4–0.5s)
-    uint32_t sum = 0;
-    for (int i = 0; i < 30; i++)
+    // One short average seeds the streaming reading and is checked against
+    // the saved calibration. Without a plausible one the dry reference is
+    // learned from the first RAIN_BOOT_CAL_TICKS updates (bootCalibrate()),
+    // so boot does not wait either way; until then the sensor reads dry.
+    lastRaw = avgRead(RAIN_A0);
+    lastChangeMs = millis();
+    calStoreOk = calStore.begin(RAIN_CAL_NVS_NAMESPACE, false);
+    const char *coldReason = warmStart(lastRaw, digitalRead(RAIN_D0));
+
+    // Servo init
+    servo.setPeriodHertz(50);           // standard analog servo frequency
+    servo.attach(SERVO_PIN, 500, 2400); // min/max pulse (us) for SG90
+    servo.write(settings.servoAngleDry); // Start at dry position
+    servoAtWet = false;
+    servoLastChange = millis();
+
+    // The ULP watches for rain while the cores sleep (low-power mode); no
+    // raw threshold until the dry reference is known
+    powerRainBegin();
+    uint16_t wetBelow = coldReason ? 0 : rainSubSat(filter.dryRef, settings.rain.triggerDrop);
+    powerRainWatch(wetBelow, digitalWetIsLow ? LOW : HIGH, false);
+
+    // From here on the ADC streams
+#if RAIN_ADC_CONTINUOUS
+    adcContinuous = rainAdcBegin();
+#endif
+    bootCalStartMs = millis();
+
+    if (coldReason)
     {
-        sum += analogRead(RAIN_A0);
-        delay(8);
+        Serial.printf("Rain sensor: %s sampling; %s, calibrating dry reference over %u updates\n",
+                      adcContinuous ? "continuous" : "polled", coldReason, (unsigned)RAIN_BOOT_CAL_TICKS);
+        return;
     }
-    dryRef = sum / 30;
+    Serial.printf("Rain sensor: %s sampling; warm start dryRef=%u, wetRef=%u, digitalWetIsLow=%d (reading %u)\n",
+                  adcContinuous ? "continuous" : "polled", filter.dryRef, filter.wetRef, digitalWetIsLow ? 1 : 0,
+                  lastRaw);
+    profBootMark(BOOT_RAIN_CAL);
+}
+
+// Boot auto-cal (plate dry): average the first RAIN_BOOT_CAL_TICKS
+// readings into dryRef, then detect the RAIN_D0 polarity against it
+static void bootCalibrate(uint16_t raw, int d0)
+{
+    bootCalSum += raw;
+    if (++bootCalTicks < RAIN_BOOT_CAL_TICKS)
+        return;
+
+    uint16_t dryRef = bootCalSum / RAIN_BOOT_CAL_TICKS;
     if (dryRef >= 4000)
     {
         Serial.println("WARN: ADC saturated at boot; using fallback dryRef=3500.");
         dryRef = 3500;
     }
-    wetRef = (dryRef > WET_MARGIN) ? dryRef - WET_MARGIN : (dryRef > 20 ? dryRef - 20 : dryRef);
-
-    lastChangeMs = millis();
+    rainFilterReset(filter, dryRef, settings.rain);
 
     // Simple digital polarity auto-detect (optional safety)
-    uint32_t s2 = 0;
-    for (int i = 0; i < 12; i++)
-    {
-        s2 += analogRead(RAIN_A0);
-        delay(4);
-    }
-    uint16_t rawavg = s2 / 12;
-    int d0sample = digitalRead(RAIN_D0);
-    if (rawavg < 4000 && abs((int)rawavg - (int)dryRef) < 150)
+    if (raw < 4000 && abs((int)raw - (int)dryRef) < 150)
     {
-        digitalWetIsLow = !(d0sample == 0);
+        digitalWetIsLow = !(d0 == 0);
     }
     else
     {
         digitalWetIsLow = true; // assume LOW==wet (typical)
     }
+    stateWet = digitalWetIsLow ? (d0 == 0) : (d0 == 1);
+    lastChangeMs = millis();
+    powerRainWatch(rainSubSat(filter.dryRef, settings.rain.triggerDrop), digitalWetIsLow ? LOW : HIGH, stateWet);
 
-    stateWet = digitalWetIsLow ? (digitalRead(RAIN_D0) == 0) : (digitalRead(RAIN_D0) == 1);
-
-    // Servo init
-    servo.setPeriodHertz(50);           // standard analog servo frequency
-    servo.attach(SERVO_PIN, 500, 2400); // min/max pulse (us) for SG90
-    servo.write(SERVO_ANGLE_DRY);       // Start at dry position
-    servoAtWet = false;
-    servoLastChange = millis();
+    publishCal(true);
 
-    Serial.printf("Rain sensor: dryRef=%u, wetRef=%u, digitalWetIsLow=%d\n",
-                  dryRef, wetRef, digitalWetIsLow ? 1 : 0);
+    Serial.printf("Rain sensor: dryRef=%u, wetRef=%u, digitalWetIsLow=%d, calibrated in %lu ms\n", filter.dryRef,
+                  filter.wetRef, digitalWetIsLow ? 1 : 0, (unsigned long)(millis() - bootCalStartMs));
+    profBootMark(BOOT_RAIN_CAL);
 }
 
 void rainSensorUpdate(Servo &servo)
 {
     // ---- Rain logic ----
-    uint16_t raw = avgRead(RAIN_A0);
+    uint16_t raw = readRainRaw();
     int d0 = digitalRead(RAIN_D0);
-    bool hwWet = digitalWetIsLow ? (d0 == 0) : (d0 == 1);
-
-    bool dropWet = (raw + TRIGGER_DROP < dryRef);
-    bool wetNow = hwWet || dropWet;
-
-    if (wetNow)
+    if (bootCalTicks < RAIN_BOOT_CAL_TICKS)
     {
-        if (raw < wetRef)
-            wetRef = raw;
-    }
-    else
-    {
-        wetRef = (uint16_t)(wetRef + (dryRef - wetRef) / 300);
+        bootCalibrate(raw, d0);
+        return; // reads dry, the servo stays at its dry angle
     }
+    bool hwWet = digitalWetIsLow ? (d0 == 0) : (d0 == 1);
 
-    if (!wetNow && raw > (uint16_t)(dryRef - DRY_HYST) && raw > dryRef)
+    int32_t cal = calRequest;
+    if (cal >= 0)
     {
-        dryRef = (uint16_t)((199 * dryRef + raw) / 200);
+        calRequest = -1;
+        rainFilterReset(filter, cal ? (uint16_t)cal : raw, settings.rain);
+        Serial.printf("Rain sensor recalibrated: dryRef=%u, wetRef=%u\n", filter.dryRef, filter.wetRef);
     }
 
-    int denom = (int)dryRef - (int)wetRef;
-    if (denom < MIN_DENOM)
-        denom = MIN_DENOM;
-    float targetPct = 100.0f * (float)(dryRef - raw) / (float)denom;
-    targetPct = constrain(targetPct, 0.0f, 100.0f);
-
-    float ease = wetNow ? PCT_EASE_WET : PCT_EASE_DRY;
-    dispPct += (targetPct - dispPct) * ease;
+    bool wetNow = rainFilterStep(filter, raw, hwWet, settings.rain);
+    publishCal(cal >= 0);
+    powerRainWatch(rainSubSat(filter.dryRef, settings.rain.triggerDrop), digitalWetIsLow ? LOW : HIGH, wetNow);
 
     if (wetNow != stateWet)
     {
@@ -128,6 +278,20 @@ void rainSensorUpdate(Servo &servo)
 
     // === Stable servo control ===
     uint32_t now = millis();
+
+    // A remote command moves the servo like the rain logic would, so the
+    // dwell times below run from it
+    int8_t move = servoRequest;
+    if (move >= 0)
+    {
+        servoRequest = -1;
+        servoAtWet = move == 1;
+        servoLastChange = now;
+        servo.write(servoAtWet ? settings.servoAngleWet : settings.servoAngleDry);
+        Serial.printf("Servo -> %d (%s, remote)\n", servoAtWet ? settings.servoAngleWet : settings.servoAngleDry,
+                      servoAtWet ? "WET" : "DRY");
+    }
+
     if (wetNow)
     {
         if (wetSeenSince == 0)
@@ -141,25 +305,61 @@ void rainSensorUpdate(Servo &servo)
         wetSeenSince = 0;
     }
 
-    bool requestWet = (wetSeenSince != 0) && (now - wetSeenSince >= WET_DEBOUNCE_MS);
-    bool requestDry = (drySeenSince != 0) && (now - drySeenSince >= DRY_DEBOUNCE_MS);
-    bool canLeaveWet = (now - servoLastChange >= SERVO_MIN_ON_MS);
-    bool canLeaveDry = (now - servoLastChange >= SERVO_MIN_OFF_MS);
+    bool requestWet = (wetSeenSince != 0) && (now - wetSeenSince >= settings.wetDebounceMs);
+    bool requestDry = (drySeenSince != 0) && (now - drySeenSince >= settings.dryDebounceMs);
+    bool canLeaveWet = (now - servoLastChange >= settings.servoMinOnMs);
+    bool canLeaveDry = (now - servoLastChange >= settings.servoMinOffMs);
 
     if (!servoAtWet && requestWet && canLeaveDry)
     {
-        servo.write(SERVO_ANGLE_WET);
+        servo.write(settings.servoAngleWet);
         servoAtWet = true;
         servoLastChange = now;
-        Serial.printf("Servo -> %d (WET)\n", SERVO_ANGLE_WET);
+        Serial.printf("Servo -> %d (WET)\n", settings.servoAngleWet);
     }
     if (servoAtWet && requestDry && canLeaveWet)
     {
-        servo.write(SERVO_ANGLE_DRY);
+        servo.write(settings.servoAngleDry);
         servoAtWet = false;
         servoLastChange = now;
-        Serial.printf("Servo -> %d (DRY)\n", SERVO_ANGLE_DRY);
+        Serial.printf("Servo -> %d (DRY)\n", settings.servoAngleDry);
+    }
+}
+
+void rainSensorSaveCalibration()
+{
+    CalSnapshot snap;
+    if (!calStoreOk || !readCal(snap) || snap.cal.version == 0)
+        return; // not calibrated yet, or caught mid-update: next round
+    const SavedCal &c = snap.cal;
+    uint32_t now = millis();
+    if (snap.gen == savedGen)
+    {
+        bool moved = c.wetIsLow != saved.wetIsLow || abs((int)c.dryRef - (int)saved.dryRef) >= RAIN_CAL_SAVE_DELTA ||
+                     abs((int)c.wetRef - (int)saved.wetRef) >= RAIN_CAL_SAVE_DELTA;
+        if (!moved || (saved.version && now - savedMs < RAIN_CAL_SAVE_MS))
+            return;
     }
+    savedGen = snap.gen;
+    if (calStore.putBytes(SAVED_CAL_KEY, &c, sizeof(c)) != sizeof(c))
+    {
+        Serial.println("Rain calibration: NVS write failed");
+        return;
+    }
+    saved = c;
+    savedMs = now;
+    Serial.printf("Rain calibration saved: dryRef=%u, wetRef=%u, digitalWetIsLow=%u\n", c.dryRef, c.wetRef,
+                  c.wetIsLow);
+}
+
+void rainSensorRequestCalibration(uint16_t dryRaw)
+{
+    calRequest = dryRaw;
+}
+
+void rainSensorRequestServo(bool wet)
+{
+    servoRequest = wet ? 1 : 0;
 }
 
 bool isRaining()
@@ -169,10 +369,10 @@ bool isRaining()
 
 float getWetnessPercent()
 {
-    return dispPct;
+    return filter.pctQ8 / 256.0f;
 }
 
 uint16_t getRainRaw()
 {
-    return avgRead(RAIN_A0);
+    return readRainRaw();
 }
@@ -4,12 +4,27 @@
 #include <Arduino.h>
 #include <ESP32Servo.h>
 
-// Initialize rain sensor and servo
+// Initialize rain sensor and servo; warm-starts from the calibration saved
+// in NVS when the boot reading agrees with it
 void rainSensorInit(Servo &servo);
 
 // Update rain sensor readings and servo position (call periodically)
 void rainSensorUpdate(Servo &servo);
 
+// Re-learn the dry reference on the next update (safe from another task).
+// dryRaw = 0 takes the current reading, so the plate must be dry.
+void rainSensorRequestCalibration(uint16_t dryRaw);
+
+// Move the servo to its wet or dry angle on the next update (safe from
+// another task); the rain logic holds it for the minimum dwell time, then
+// follows the plate again
+void rainSensorRequestServo(bool wet);
+
+// Write the learned references to NVS (call from the loop side): at once
+// after a calibration, otherwise once one moved by RAIN_CAL_SAVE_DELTA and
+// the last write is RAIN_CAL_SAVE_MS old
+void rainSensorSaveCalibration();
+
 // Get current rain state
 bool isRaining();
 
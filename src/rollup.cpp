@@ -0,0 +1,163 @@
+#include "rollup.h"
+#include "config.h"
+#include "mqtt_client.h"
+
+// Only the base level sees samples (Welford's update). A closed window is
+// merged into the level above with Chan's pairwise formula, so the coarse
+// levels cost one merge per closed window instead of work per sample and
+// still give the exact mean and variance of all their samples.
+
+static const RollupStat EMPTY = {0, NAN, 0, NAN, NAN};
+static const char *const TOPICS[ROLL_LEVELS] = {MQTT_TOPIC_ROLLUP_1M, MQTT_TOPIC_ROLLUP_10M, MQTT_TOPIC_ROLLUP_1H};
+static const uint32_t SPAN_S[ROLL_LEVELS] = {ROLLUP_BASE_MS / 1000, ROLLUP_BASE_MS / 1000 * ROLLUP_MID_FACTOR,
+                                             ROLLUP_BASE_MS / 1000 * ROLLUP_MID_FACTOR * ROLLUP_TOP_FACTOR};
+static const uint8_t FACTOR[ROLL_LEVELS] = {1, ROLLUP_MID_FACTOR, ROLLUP_TOP_FACTOR};
+
+static RollupStat current[ROLL_LEVELS][ROLL_CHANNELS];
+static RollupStat last[ROLL_LEVELS][ROLL_CHANNELS];
+static uint8_t merged[ROLL_LEVELS]; // windows of the level below merged so far
+static uint32_t windowStartMs = 0;
+static bool started = false;
+static RollupStats stats = {};
+
+static void reset(RollupLevel level)
+{
+    for (uint8_t c = 0; c < ROLL_CHANNELS; c++)
+        current[level][c] = EMPTY;
+    merged[level] = 0;
+}
+
+static void update(RollupStat &st, float x)
+{
+    if (isnan(x))
+        return;
+    st.n++;
+    if (st.n == 1)
+    {
+        st.mean = st.min = st.max = x;
+        return;
+    }
+    float delta = x - st.mean;
+    st.mean += delta / st.n;
+    st.m2 += delta * (x - st.mean);
+    if (x < st.min)
+        st.min = x;
+    if (x > st.max)
+        st.max = x;
+}
+
+static void merge(RollupStat &into, const RollupStat &from)
+{
+    if (from.n == 0)
+        return;
+    if (into.n == 0)
+    {
+        into = from;
+        return;
+    }
+    uint32_t n = into.n + from.n;
+    float delta = from.mean - into.mean;
+    into.mean += delta * from.n / n;
+    into.m2 += from.m2 + delta * delta * ((float)into.n * from.n / n);
+    into.n = n;
+    if (from.min < into.min)
+        into.min = from.min;
+    if (from.max > into.max)
+        into.max = from.max;
+}
+
+// "name":{...} or "name":null for a channel without samples
+static int formatStat(char *buf, size_t size, const char *name, const RollupStat &st)
+{
+    if (st.n == 0)
+        return snprintf(buf, size, "\"%s\":null", name);
+    return snprintf(buf, size, "\"%s\":{\"n\":%lu,\"mean\":%.2f,\"min\":%.2f,\"max\":%.2f,\"sd\":%.3f}", name,
+                    (unsigned long)st.n, st.mean, st.min, st.max, rollupStdDev(st));
+}
+
+static void publish(RollupLevel level, uint32_t endMs)
+{
+    if (!mqttIsConnected())
+    {
+        stats.skipped++;
+        return;
+    }
+    static const char *const NAMES[ROLL_CHANNELS] = {"wind", "wet", "temp", "hum", "pressure"};
+    char payload[512];
+    time_t now = time(nullptr);
+    int len = snprintf(payload, sizeof(payload), "{\"ts\":%lu,\"up\":%lu,\"span\":%lu",
+                       (unsigned long)(now >= 1600000000 ? now : 0), (unsigned long)endMs,
+                       (unsigned long)SPAN_S[level]);
+    for (uint8_t c = 0; c < ROLL_CHANNELS && len > 0 && (size_t)len < sizeof(payload) - 2; c++)
+    {
+        payload[len++] = ',';
+        len += formatStat(payload + len, sizeof(payload) - len - 1, NAMES[c], last[level][c]);
+    }
+    if (len <= 0 || (size_t)len >= sizeof(payload) - 1)
+        return; // cannot happen with the fields above
+    payload[len++] = '}';
+    payload[len] = '\0';
+    if (mqttPublishRollup(TOPICS[level], payload, (size_t)len))
+        stats.published[level]++;
+}
+
+// Close the current window of level (and the levels above it when they fill)
+static void closeWindow(uint8_t level, uint32_t endMs)
+{
+    for (uint8_t c = 0; c < ROLL_CHANNELS; c++)
+        last[level][c] = current[level][c];
+    publish((RollupLevel)level, endMs);
+
+    if (level + 1 < ROLL_LEVELS)
+    {
+        for (uint8_t c = 0; c < ROLL_CHANNELS; c++)
+            merge(current[level + 1][c], last[level][c]);
+        if (++merged[level + 1] == FACTOR[level + 1])
+            closeWindow(level + 1, endMs);
+    }
+    reset((RollupLevel)level);
+}
+
+void rollupAdd(const SensorSample &s)
+{
+    if (!started)
+    {
+        for (uint8_t l = 0; l < ROLL_LEVELS; l++)
+        {
+            reset((RollupLevel)l);
+            for (uint8_t c = 0; c < ROLL_CHANNELS; c++)
+                last[l][c] = EMPTY;
+        }
+        windowStartMs = s.tMs;
+        started = true;
+    }
+    if (s.tMs - windowStartMs >= ROLLUP_BASE_MS)
+    {
+        windowStartMs += ROLLUP_BASE_MS;
+        closeWindow(ROLL_1M, windowStartMs);
+        if (s.tMs - windowStartMs >= ROLLUP_BASE_MS)
+            windowStartMs = s.tMs; // no samples for more than a window: restart the grid
+    }
+
+    RollupStat *st = current[ROLL_1M];
+    update(st[ROLL_WIND], s.windMs);
+    update(st[ROLL_WETNESS], s.wetnessPct);
+    update(st[ROLL_TEMP], s.tempC);
+    update(st[ROLL_HUMIDITY], s.humidity);
+    update(st[ROLL_PRESSURE], s.pressureHPa);
+}
+
+const RollupStat &rollupLast(RollupLevel level, RollupChannel ch)
+{
+    return last[level][ch];
+}
+
+float rollupStdDev(const RollupStat &st)
+{
+    return st.n > 1 ? sqrtf(st.m2 / (st.n - 1)) : 0.0f;
+}
+
+RollupStats rollupStats()
+{
+    return stats;
+}
@@ -0,0 +1,56 @@
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <Arduino.h>
+
+#include "acquisition.h"
+
+// Channels aggregated per window
+enum RollupChannel
+{
+    ROLL_WIND,     // m/s, instantaneous speed
+    ROLL_WETNESS,  // %
+    ROLL_TEMP,     // °C
+    ROLL_HUMIDITY, // %
+    ROLL_PRESSURE, // hPa
+    ROLL_CHANNELS
+};
+
+// Window sizes, finest first: ROLLUP_BASE_MS, x ROLLUP_MID_FACTOR, x ROLLUP_TOP_FACTOR
+enum RollupLevel
+{
+    ROLL_1M,
+    ROLL_10M,
+    ROLL_1H,
+    ROLL_LEVELS
+};
+
+// Welford running statistics; min/max/mean are NAN while n == 0
+struct RollupStat
+{
+    uint32_t n;
+    float mean;
+    float m2; // sum of squared deviations from the mean
+    float min, max;
+};
+
+struct RollupStats
+{
+    uint32_t published[ROLL_LEVELS];
+    uint32_t skipped; // windows that closed while MQTT was down
+};
+
+// Fold one sample into the open base window (O(1) per channel). Closing a
+// window publishes it and merges it into the next level, which closes in
+// turn after its factor of windows.
+void rollupAdd(const SensorSample &s);
+
+// Last closed window of a level
+const RollupStat &rollupLast(RollupLevel level, RollupChannel ch);
+
+// Sample standard deviation (0 below two samples)
+float rollupStdDev(const RollupStat &st);
+
+RollupStats rollupStats();
+
+#endif // ROLLUP_H
@@ -0,0 +1,134 @@
+#include "scheduler.h"
+
+#define SCHED_MAX_TASKS 12
+
+struct Task
+{
+    const char *name;
+    TaskFn fn;
+    uint32_t periodUs;
+    uint32_t dueUs;
+    uint8_t priority;
+    TaskStats stats;
+};
+
+static Task tasks[SCHED_MAX_TASKS];
+static int taskCount = 0;
+
+// Wrap-safe "a is at or after b" for 32-bit microsecond timestamps
+static inline bool reached(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) >= 0;
+}
+
+int schedulerAdd(const char *name, TaskFn fn, uint32_t periodMs, uint8_t priority)
+{
+    if (taskCount >= SCHED_MAX_TASKS || fn == nullptr || periodMs == 0)
+        return -1;
+
+    Task &t = tasks[taskCount];
+    t.name = name;
+    t.fn = fn;
+    t.periodUs = periodMs * 1000UL;
+    t.dueUs = micros(); // first run as soon as the loop starts
+    t.priority = priority;
+    t.stats = TaskStats{};
+    return taskCount++;
+}
+
+void schedulerRun()
+{
+    uint32_t now = micros();
+
+    // Most urgent due task: lowest priority value, then earliest deadline
+    Task *next = nullptr;
+    for (int i = 0; i < taskCount; i++)
+    {
+        Task &t = tasks[i];
+        if (!reached(now, t.dueUs))
+            continue;
+        if (next == nullptr || t.priority < next->priority ||
+            (t.priority == next->priority && (int32_t)(t.dueUs - next->dueUs) < 0))
+            next = &t;
+    }
+    if (next == nullptr)
+        return;
+
+    TaskStats &s = next->stats;
+    uint32_t jitter = now - next->dueUs;
+    s.lastJitterUs = jitter;
+    if (jitter > s.maxJitterUs)
+        s.maxJitterUs = jitter;
+
+    next->fn();
+
+    uint32_t end = micros();
+    uint32_t run = end - now;
+    s.runs++;
+    s.lastRunUs = run;
+    if (run > s.maxRunUs)
+        s.maxRunUs = run;
+    if (run > next->periodUs)
+        s.overruns++;
+
+    // Fixed-rate: the next deadline follows the schedule, not the start time,
+    // so jitter does not accumulate. Slots already lost count as misses.
+    next->dueUs += next->periodUs;
+    if (reached(end, next->dueUs + next->periodUs))
+    {
+        uint32_t behind = (end - next->dueUs) / next->periodUs;
+        s.misses += behind;
+        next->dueUs += behind * next->periodUs;
+    }
+}
+
+uint32_t schedulerIdleUs()
+{
+    uint32_t now = micros();
+    uint32_t idle = UINT32_MAX;
+    for (int i = 0; i < taskCount; i++)
+    {
+        if (reached(now, tasks[i].dueUs))
+            return 0;
+        idle = min(idle, tasks[i].dueUs - now);
+    }
+    return idle;
+}
+
+void schedulerResync()
+{
+    uint32_t now = micros();
+    for (int i = 0; i < taskCount; i++)
+    {
+        if (reached(now, tasks[i].dueUs))
+            tasks[i].dueUs = now;
+    }
+}
+
+const TaskStats *schedulerStats(int id)
+{
+    if (id < 0 || id >= taskCount)
+        return nullptr;
+    return &tasks[id].stats;
+}
+
+void schedulerResetStats()
+{
+    for (int i = 0; i < taskCount; i++)
+        tasks[i].stats = TaskStats{};
+}
+
+void schedulerReport()
+{
+    Serial.println("task        period  runs    miss  ovr  jit_last  jit_max  run_max (us)");
+    for (int i = 0; i < taskCount; i++)
+    {
+        const Task &t = tasks[i];
+        const TaskStats &s = t.stats;
+        Serial.printf("%-10s %6lu %6lu %6lu %5lu %9lu %8lu %8lu\n", t.name,
+                      (unsigned long)(t.periodUs / 1000), (unsigned long)s.runs,
+                      (unsigned long)s.misses, (unsigned long)s.overruns,
+                      (unsigned long)s.lastJitterUs, (unsigned long)s.maxJitterUs,
+                      (unsigned long)s.maxRunUs);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+// Cooperative periodic task scheduler. Tasks run to completion; each call
+// to schedulerRun() starts at most one due task, highest priority first.
+
+typedef void (*TaskFn)();
+
+struct TaskStats
+{
+    uint32_t runs;
+    uint32_t misses;       // whole periods skipped because the task started too late
+    uint32_t overruns;     // runs that took longer than the period
+    uint32_t lastJitterUs; // start time minus scheduled time
+    uint32_t maxJitterUs;
+    uint32_t lastRunUs;
+    uint32_t maxRunUs;
+};
+
+// Register a task (priority 0 = most urgent). Returns its id, or -1 if full.
+int schedulerAdd(const char *name, TaskFn fn, uint32_t periodMs, uint8_t priority);
+
+// Run the most urgent due task, if any (call from loop())
+void schedulerRun();
+
+// Microseconds until the next task is due, 0 if one is due now
+uint32_t schedulerIdleUs();
+
+// After a sleep: tasks whose deadline passed run once now, without
+// counting the periods slept through as misses
+void schedulerResync();
+
+// Per-task statistics
+const TaskStats *schedulerStats(int id);
+
+// Clear max values and counters
+void schedulerResetStats();
+
+// Print a one-line-per-task statistics table to Serial
+void schedulerReport();
+
+#endif // SCHEDULER_H
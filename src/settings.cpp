@@ -0,0 +1,333 @@
+#include "settings.h"
+#include "config.h"
+#include <Preferences.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// One NVS entry per changed setting, typed like its field and keyed by its
+// name; settings at their default have no entry, so a changed default in
+// config.h reaches every station that never overrode it. The key table
+// drives loading, range checks, MQTT parsing and the JSON report.
+
+enum SettingType : uint8_t
+{
+    T_U8,
+    T_U16,
+    T_U32,
+    T_F32
+};
+
+struct SettingDef
+{
+    const char *key; // NVS key (at most 15 characters) and MQTT name
+    SettingType type;
+    uint16_t offset; // into Settings
+    double min, max;
+};
+
+#define FIELD(f) (uint16_t) offsetof(Settings, f)
+
+static const SettingDef DEFS[SET_COUNT] = {
+    {"wet_margin", T_U16, FIELD(rain.wetMargin), 0, 4095},
+    {"trigger_drop", T_U16, FIELD(rain.triggerDrop), 1, 4095},
+    {"dry_hyst", T_U16, FIELD(rain.dryHyst), 0, 4095},
+    {"min_denom", T_U16, FIELD(rain.minDenom), 1, 4095},
+    {"ease_wet_q8", T_U16, FIELD(rain.easeWetQ8), 1, 256},
+    {"ease_dry_q8", T_U16, FIELD(rain.easeDryQ8), 1, 256},
+    {"servo_dry", T_U8, FIELD(servoAngleDry), 0, 180},
+    {"servo_wet", T_U8, FIELD(servoAngleWet), 0, 180},
+    {"servo_on_ms", T_U32, FIELD(servoMinOnMs), 0, 600000},
+    {"servo_off_ms", T_U32, FIELD(servoMinOffMs), 0, 600000},
+    {"wet_debounce_ms", T_U32, FIELD(wetDebounceMs), 0, 60000},
+    {"dry_debounce_ms", T_U32, FIELD(dryDebounceMs), 0, 60000},
+    {"wind_slope", T_F32, FIELD(windSlope), 0, 1},
+    {"wind_offset", T_F32, FIELD(windOffset), 0, 10},
+    {"wind_min_rpm", T_F32, FIELD(windMinRpm), 0, 1000},
+    {"publish_ms", T_U32, FIELD(publishIntervalMs), PUBLISH_INTERVAL_MIN_S * 1000.0, PUBLISH_INTERVAL_MAX_S * 1000.0},
+    {"publish_policy", T_U8, FIELD(publishPolicy), PUBLISH_EVERY, PUBLISH_ON_CHANGE},
+    {"payload_format", T_U8, FIELD(payloadFormat), PAYLOAD_LEGACY, PAYLOAD_MSGPACK},
+    {"db_wind", T_F32, FIELD(deadbandWind), 0, 50},
+    {"db_temp", T_F32, FIELD(deadbandTemp), 0, 50},
+    {"db_hum", T_F32, FIELD(deadbandHum), 0, 100},
+    {"db_pressure", T_F32, FIELD(deadbandPressure), 0, 100},
+    {"heartbeat_ms", T_U32, FIELD(heartbeatMs), 10000, 86400000},
+};
+
+static_assert(SET_COUNT <= 32, "update masks are 32-bit");
+
+static const Settings DEFAULTS = {
+    {WET_MARGIN, TRIGGER_DROP, DRY_HYST, MIN_DENOM, PCT_EASE_WET_Q8, PCT_EASE_DRY_Q8},
+    SERVO_ANGLE_DRY,
+    SERVO_ANGLE_WET,
+    SERVO_MIN_ON_MS,
+    SERVO_MIN_OFF_MS,
+    WET_DEBOUNCE_MS,
+    DRY_DEBOUNCE_MS,
+    WIND_CAL_SLOPE,
+    WIND_CAL_OFFSET,
+    WIND_CAL_MIN_RPM,
+    PUBLISH_INTERVAL,
+    MQTT_PUBLISH_POLICY,
+    MQTT_PAYLOAD_FORMAT,
+    PUBLISH_DEADBAND_WIND,
+    PUBLISH_DEADBAND_TEMP,
+    PUBLISH_DEADBAND_HUM,
+    PUBLISH_DEADBAND_PRESSURE,
+    PUBLISH_HEARTBEAT_MS,
+};
+
+static Settings store = DEFAULTS;
+const Settings &settings = store;
+
+static Preferences prefs;
+static bool nvsOk = false;
+
+static double getValue(const Settings &s, const SettingDef &d)
+{
+    const uint8_t *p = (const uint8_t *)&s + d.offset;
+    switch (d.type)
+    {
+    case T_U8:
+        return *p;
+    case T_U16:
+        return *(const uint16_t *)p;
+    case T_U32:
+        return *(const uint32_t *)p;
+    case T_F32:
+        return *(const float *)p;
+    }
+    return 0;
+}
+
+static void putValue(Settings &s, const SettingDef &d, double v)
+{
+    uint8_t *p = (uint8_t *)&s + d.offset;
+    switch (d.type)
+    {
+    case T_U8:
+        *p = (uint8_t)v;
+        break;
+    case T_U16:
+        *(uint16_t *)p = (uint16_t)v;
+        break;
+    case T_U32:
+        *(uint32_t *)p = (uint32_t)v;
+        break;
+    case T_F32:
+        *(float *)p = (float)v;
+        break;
+    }
+}
+
+static bool inRange(const SettingDef &d, double v)
+{
+    return v >= d.min && v <= d.max && (d.type == T_F32 || v == floor(v)); // NaN fails the comparisons
+}
+
+// Write the value in force to NVS, or erase the entry if it is the default
+static void persist(const SettingDef &d)
+{
+    if (!nvsOk)
+        return;
+    double v = getValue(store, d);
+    if (v == getValue(DEFAULTS, d))
+    {
+        if (prefs.isKey(d.key))
+            prefs.remove(d.key);
+        return;
+    }
+    switch (d.type)
+    {
+    case T_U8:
+        prefs.putUChar(d.key, (uint8_t)v);
+        break;
+    case T_U16:
+        prefs.putUShort(d.key, (uint16_t)v);
+        break;
+    case T_U32:
+        prefs.putUInt(d.key, (uint32_t)v);
+        break;
+    case T_F32:
+        prefs.putFloat(d.key, (float)v);
+        break;
+    }
+}
+
+static bool load(const SettingDef &d, double &v)
+{
+    if (!prefs.isKey(d.key))
+        return false;
+    switch (d.type)
+    {
+    case T_U8:
+        v = prefs.getUChar(d.key);
+        break;
+    case T_U16:
+        v = prefs.getUShort(d.key);
+        break;
+    case T_U32:
+        v = prefs.getUInt(d.key);
+        break;
+    case T_F32:
+        v = prefs.getFloat(d.key);
+        break;
+    }
+    return true;
+}
+
+void settingsInit()
+{
+    nvsOk = prefs.begin(SETTINGS_NVS_NAMESPACE, false);
+    if (!nvsOk)
+    {
+        Serial.println("Settings: NVS unavailable, defaults only");
+        return;
+    }
+    uint8_t loaded = 0;
+    for (uint8_t i = 0; i < SET_COUNT; i++)
+    {
+        double v = 0;
+        if (!load(DEFS[i], v))
+            continue;
+        if (!inRange(DEFS[i], v))
+        {
+            Serial.printf("Settings: stored %s out of range, using the default\n", DEFS[i].key);
+            prefs.remove(DEFS[i].key);
+            continue;
+        }
+        putValue(store, DEFS[i], v);
+        loaded++;
+    }
+    Serial.printf("Settings: %u of %u changed from the defaults (NVS)\n", loaded, SET_COUNT);
+}
+
+bool settingsSet(SettingId id, double value, bool keep)
+{
+    if (id >= SET_COUNT || !inRange(DEFS[id], value))
+        return false;
+    putValue(store, DEFS[id], value);
+    if (keep)
+        persist(DEFS[id]);
+    return true;
+}
+
+// === MQTT updates ===
+
+static bool isSeparator(uint8_t c)
+{
+    return c == ' ' || c == ',' || c == ';' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static bool tokenIs(const char *tok, size_t n, const char *word)
+{
+    return strlen(word) == n && memcmp(tok, word, n) == 0;
+}
+
+static int findKey(const char *name, size_t n)
+{
+    for (uint8_t i = 0; i < SET_COUNT; i++)
+    {
+        if (tokenIs(name, n, DEFS[i].key))
+            return i;
+    }
+    return -1;
+}
+
+bool settingsApplyText(const uint8_t *text, unsigned int length)
+{
+    double values[SET_COUNT];
+    uint32_t setMask = 0;     // pairs with a value
+    uint32_t defaultMask = 0; // key=default
+    bool resetAll = false;
+
+    unsigned int i = 0;
+    while (i < length)
+    {
+        while (i < length && isSeparator(text[i]))
+            i++;
+        unsigned int start = i;
+        while (i < length && !isSeparator(text[i]))
+            i++;
+        const char *tok = (const char *)text + start;
+        size_t n = i - start;
+        if (n == 0)
+            break;
+        if (tokenIs(tok, n, "reset"))
+        {
+            resetAll = true;
+            continue;
+        }
+
+        const char *eq = (const char *)memchr(tok, '=', n);
+        int id = eq ? findKey(tok, eq - tok) : -1;
+        if (id < 0)
+        {
+            Serial.printf("config: unknown setting \"%.*s\"\n", (int)n, tok);
+            return false;
+        }
+        const char *val = eq + 1;
+        size_t vn = n - (val - tok);
+        uint32_t bit = 1u << id;
+        if (tokenIs(val, vn, "default"))
+        {
+            defaultMask |= bit;
+            setMask &= ~bit;
+            continue;
+        }
+        char num[24];
+        char *end = num;
+        if (vn > 0 && vn < sizeof(num))
+        {
+            memcpy(num, val, vn);
+            num[vn] = '\0';
+            values[id] = strtod(num, &end);
+        }
+        if (vn == 0 || vn >= sizeof(num) || *end != '\0' || !inRange(DEFS[id], values[id]))
+        {
+            Serial.printf("config: %s=%.*s rejected (%g to %g)\n", DEFS[id].key, (int)vn, val, DEFS[id].min,
+                          DEFS[id].max);
+            return false;
+        }
+        setMask |= bit;
+        defaultMask &= ~bit;
+    }
+    if (!resetAll && !setMask && !defaultMask)
+    {
+        Serial.println("config: expected key=value pairs, key=default or reset");
+        return false;
+    }
+
+    // Validated as a whole; now apply, field by field
+    for (uint8_t id = 0; id < SET_COUNT; id++)
+    {
+        uint32_t bit = 1u << id;
+        double old = getValue(store, DEFS[id]);
+        double next = (setMask & bit) ? values[id] : (resetAll || (defaultMask & bit)) ? getValue(DEFAULTS, DEFS[id]) : old;
+        settingsSet((SettingId)id, next, true);
+        if (getValue(store, DEFS[id]) != old)
+            Serial.printf("config: %s %g -> %g\n", DEFS[id].key, old, getValue(store, DEFS[id]));
+    }
+    return true;
+}
+
+size_t settingsFormatJson(char *buf, size_t size)
+{
+    size_t len = 0;
+    for (uint8_t i = 0; i < SET_COUNT && len < size; i++)
+    {
+        double v = getValue(store, DEFS[i]);
+        const char *sep = i == 0 ? "{" : ",";
+        if (DEFS[i].type == T_F32)
+            len += snprintf(buf + len, size - len, "%s\"%s\":%g", sep, DEFS[i].key, v);
+        else
+            len += snprintf(buf + len, size - len, "%s\"%s\":%lu", sep, DEFS[i].key, (unsigned long)v);
+    }
+    if (len + 2 > size)
+        return 0; // truncated
+    buf[len++] = '}';
+    buf[len] = '\0';
+    return len;
+}
@@ -0,0 +1,82 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <Arduino.h>
+#include <rain_filter.h>
+
+// Tunables that change without a reflash. Defaults are the defines in
+// config.h; changed values persist in NVS and apply at once.
+struct Settings
+{
+    RainTuning rain;
+    uint8_t servoAngleDry;
+    uint8_t servoAngleWet;
+    uint32_t servoMinOnMs;
+    uint32_t servoMinOffMs;
+    uint32_t wetDebounceMs;
+    uint32_t dryDebounceMs;
+    float windSlope;   // m/s per rpm
+    float windOffset;  // m/s
+    float windMinRpm;  // below this 0 m/s
+    uint32_t publishIntervalMs;
+    uint8_t publishPolicy; // PUBLISH_EVERY / PUBLISH_ON_CHANGE
+    uint8_t payloadFormat; // PAYLOAD_*
+    float deadbandWind;
+    float deadbandTemp;
+    float deadbandHum;
+    float deadbandPressure;
+    uint32_t heartbeatMs;
+};
+
+// One per Settings field, in the order of the key table in settings.cpp
+enum SettingId
+{
+    SET_WET_MARGIN,
+    SET_TRIGGER_DROP,
+    SET_DRY_HYST,
+    SET_MIN_DENOM,
+    SET_EASE_WET_Q8,
+    SET_EASE_DRY_Q8,
+    SET_SERVO_DRY,
+    SET_SERVO_WET,
+    SET_SERVO_ON_MS,
+    SET_SERVO_OFF_MS,
+    SET_WET_DEBOUNCE_MS,
+    SET_DRY_DEBOUNCE_MS,
+    SET_WIND_SLOPE,
+    SET_WIND_OFFSET,
+    SET_WIND_MIN_RPM,
+    SET_PUBLISH_MS,
+    SET_PUBLISH_POLICY,
+    SET_PAYLOAD_FORMAT,
+    SET_DEADBAND_WIND,
+    SET_DEADBAND_TEMP,
+    SET_DEADBAND_HUM,
+    SET_DEADBAND_PRESSURE,
+    SET_HEARTBEAT_MS,
+    SET_COUNT
+};
+
+// Values in force. Read the fields directly on hot paths (a plain load);
+// they are written only from the loop task, one aligned field at a time,
+// so the acquisition task sees each field either old or new.
+extern const Settings &settings;
+
+// Overlay the values stored in NVS on the defaults (before the sensors
+// start). Values set before this call (host sim options) stay unless NVS
+// has one of its own.
+void settingsInit();
+
+// Set one value if it is within its range; persist = also store it in NVS
+// (a value equal to its default is erased instead)
+bool settingsSet(SettingId id, double value, bool persist);
+
+// Apply an update from MQTT_TOPIC_CMD_CONFIG: "key=value" pairs separated
+// by spaces, commas or newlines, "key=default", or "reset" for all of them.
+// All or nothing: one bad pair rejects the message. Parsed in place.
+bool settingsApplyText(const uint8_t *text, unsigned int length);
+
+// Settings in force as a JSON object, for MQTT_TOPIC_CONFIG; length written
+size_t settingsFormatJson(char *buf, size_t size);
+
+#endif // SETTINGS_H
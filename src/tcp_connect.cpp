@@ -0,0 +1,66 @@
+#include "tcp_connect.h"
+
+#include <lwip/sockets.h>
+
+int tcpConnectStart(const char *ip, uint16_t port)
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, ip, &addr.sin_addr) != 1)
+        return -1;
+
+    int fd = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0)
+        return -1;
+
+    lwip_fcntl(fd, F_SETFL, lwip_fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    if (lwip_connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS)
+    {
+        lwip_close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int tcpConnectPoll(int fd)
+{
+    fd_set wfds;
+    FD_ZERO(&wfds);
+    FD_SET(fd, &wfds);
+    struct timeval tv = {0, 0}; // never wait
+
+    int r = lwip_select(fd + 1, nullptr, &wfds, nullptr, &tv);
+    if (r == 0)
+        return 0;
+
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (r < 0 || lwip_getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0)
+    {
+        lwip_close(fd);
+        return -1;
+    }
+
+    // WiFiClient expects a blocking socket, as its own connect() leaves it
+    lwip_fcntl(fd, F_SETFL, lwip_fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+    return 1;
+}
+
+void tcpConnectAbort(int fd)
+{
+    if (fd >= 0)
+        lwip_close(fd);
+}
+
+bool tcpWritable(int fd)
+{
+    if (fd < 0)
+        return false;
+    fd_set wfds;
+    FD_ZERO(&wfds);
+    FD_SET(fd, &wfds);
+    struct timeval tv = {0, 0};
+    return lwip_select(fd + 1, nullptr, &wfds, nullptr, &tv) > 0;
+}
@@ -0,0 +1,24 @@
+#ifndef TCP_CONNECT_H
+#define TCP_CONNECT_H
+
+#include <Arduino.h>
+
+// Non-blocking TCP connect on a raw lwIP socket. WiFiClient::connect()
+// blocks until the handshake completes or times out; this lets the caller
+// poll instead and hand the finished socket to WiFiClient(fd).
+
+// Start connecting to a dotted-quad address. Returns the socket, or -1.
+int tcpConnectStart(const char *ip, uint16_t port);
+
+// 1 = connected (socket back in blocking mode), 0 = in progress,
+// -1 = failed (socket already closed)
+int tcpConnectPoll(int fd);
+
+// Give up on a pending connect
+void tcpConnectAbort(int fd);
+
+// True if a write to a connected socket would not block: lwIP reports it
+// writable while more than TCP_SNDLOWAT (half the send buffer) is free
+bool tcpWritable(int fd);
+
+#endif // TCP_CONNECT_H
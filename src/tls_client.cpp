@@ -0,0 +1,377 @@
+#include "tls_client.h"
+#include "config.h"
+#include "mqtt_ca.h"
+#include "tcp_connect.h"
+#include <LittleFS.h>
+#include <lwip/sockets.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/error.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+#include <time.h>
+
+// One session at a time (the broker connection). The mbedTLS context is set
+// up once and reset between connections; the socket is non-blocking, so a
+// handshake step returns WANT_READ instead of waiting for the broker.
+// Resumption is detected by the verify callback: only a full handshake
+// checks the broker certificate, a resumed one takes it from the cached
+// session. Only full handshakes are written to flash (a resumed session is already there, apart from a
+// renewed ticket, which is kept in RAM).
+
+static const uint32_t SESSION_MAGIC = 0x534C5454; // "TTLS"
+static const uint16_t SESSION_VERSION = 1;
+static const size_t SESSION_BYTES = 2048;     // serialized session incl. the peer certificate
+static const time_t EPOCH_VALID = 1600000000; // time() before SNTP is near 0
+
+struct SessionHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;     // serialized session that follows
+    uint32_t savedEpoch; // UTC, 0 if the clock was not set
+};
+
+static mbedtls_entropy_context entropy;
+static mbedtls_ctr_drbg_context drbg;
+static mbedtls_x509_crt ca;
+static mbedtls_ssl_config conf;
+static mbedtls_ssl_context ssl;
+static mbedtls_net_context net;
+static mbedtls_ssl_session cached;
+static uint8_t sessionBuf[SESSION_BYTES];
+static bool ready = false;       // tlsInit() succeeded
+static bool haveCached = false;  // cached holds a session to offer
+static uint32_t cachedEpoch = 0; // when it was saved, 0 if unknown
+static bool established = false; // handshake finished, records flow
+static bool resumedNow = false;
+static bool verifiedNow = false; // this handshake checked the broker certificate
+static uint32_t startMs = 0;
+static TlsStats stats = {};
+// Rest of a packet whose record mbedtls_ssl_write() could not finish sending
+// (WANT_WRITE). The call must be repeated with the same data, so the bytes
+// are kept here and reported as written; PubSubClient writes one packet per
+// call and never more than its buffer.
+static uint8_t pendingOut[MQTT_BUFFER_SIZE];
+static size_t pendingLen = 0;
+
+static void logError(const char *what, int err)
+{
+    char msg[96];
+    mbedtls_strerror(err, msg, sizeof(msg));
+    Serial.printf("TLS: %s failed: -0x%04x %s\n", what, (unsigned)-err, msg);
+}
+
+static void closeSocket()
+{
+    if (net.fd >= 0)
+    {
+        if (established)
+            mbedtls_ssl_close_notify(&ssl); // best effort, never waits
+        mbedtls_net_free(&net);
+    }
+    established = false;
+    pendingLen = 0;
+}
+
+// Retry the unfinished record, without waiting; true once nothing is left
+static bool flushPending()
+{
+    while (established && pendingLen > 0)
+    {
+        int r = mbedtls_ssl_write(&ssl, pendingOut, pendingLen);
+        if (r == MBEDTLS_ERR_SSL_WANT_WRITE || r == MBEDTLS_ERR_SSL_WANT_READ)
+            return false;
+        if (r <= 0)
+        {
+            closeSocket();
+            return false;
+        }
+        pendingLen -= r;
+        memmove(pendingOut, pendingOut + r, pendingLen);
+    }
+    return established;
+}
+
+static bool loadSession()
+{
+    File f = LittleFS.open(MQTT_TLS_SESSION_PATH, "r");
+    SessionHeader h;
+    bool ok = f && f.read((uint8_t *)&h, sizeof(h)) == sizeof(h) && h.magic == SESSION_MAGIC &&
+              h.version == SESSION_VERSION && h.length <= sizeof(sessionBuf) &&
+              f.read(sessionBuf, h.length) == h.length && mbedtls_ssl_session_load(&cached, sessionBuf, h.length) == 0;
+    f.close();
+    cachedEpoch = ok ? h.savedEpoch : 0;
+    return ok;
+}
+
+static void saveSession()
+{
+    size_t length = 0;
+    if (mbedtls_ssl_session_save(&cached, sessionBuf, sizeof(sessionBuf), &length) != 0)
+        return; // too large to keep: resumes until the next reboot only
+    time_t now = time(nullptr);
+    SessionHeader h = {SESSION_MAGIC, SESSION_VERSION, (uint16_t)length, now >= EPOCH_VALID ? (uint32_t)now : 0};
+    // LittleFS commits on close, so a reset leaves either the old or the new session
+    File f = LittleFS.open(MQTT_TLS_SESSION_PATH, "w");
+    if (f && f.write((const uint8_t *)&h, sizeof(h)) == sizeof(h) && f.write(sessionBuf, length) == length)
+        stats.sessionSaves++;
+    f.close();
+    cachedEpoch = h.savedEpoch;
+}
+
+// Past MQTT_TLS_SESSION_MAX_AGE_S; unknown ages (no SNTP yet) are offered,
+// the broker rejects what it no longer knows
+static bool sessionTooOld()
+{
+    time_t now = time(nullptr);
+    return cachedEpoch && now >= EPOCH_VALID && (uint32_t)now - cachedEpoch > MQTT_TLS_SESSION_MAX_AGE_S;
+}
+
+// =================== Record layer as a Client ===================
+
+class TlsStream : public Client
+{
+public:
+    int connect(IPAddress, uint16_t) override { return 0; } // tlsStart() adopts a socket instead
+    int connect(const char *, uint16_t) override { return 0; }
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t *buf, size_t size) override;
+    int available() override;
+    int read() override
+    {
+        uint8_t b;
+        return read(&b, 1) == 1 ? b : -1;
+    }
+    int read(uint8_t *buf, size_t size) override;
+    int peek() override { return -1; } // PubSubClient never peeks
+    void flush() override {}
+    void stop() override { closeSocket(); }
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+    int fd() const { return net.fd; }
+};
+
+static TlsStream stream;
+
+// Never waits for the send buffer: a record that does not fit is finished
+// later, and until then nothing new is taken (tlsWritable() is false)
+size_t TlsStream::write(const uint8_t *buf, size_t size)
+{
+    if (!flushPending())
+        return 0;
+    size_t done = 0;
+    while (established && done < size)
+    {
+        int r = mbedtls_ssl_write(&ssl, buf + done, size - done);
+        if (r > 0)
+        {
+            done += r;
+            continue;
+        }
+        if ((r != MBEDTLS_ERR_SSL_WANT_WRITE && r != MBEDTLS_ERR_SSL_WANT_READ) || size - done > sizeof(pendingOut))
+        {
+            closeSocket();
+            break;
+        }
+        pendingLen = size - done;
+        memcpy(pendingOut, buf + done, pendingLen);
+        return size;
+    }
+    return done;
+}
+
+int TlsStream::available()
+{
+    if (!established)
+        return 0;
+    if (mbedtls_ssl_get_bytes_avail(&ssl) == 0)
+    {
+        // Pull the next record into the decrypt buffer, if one arrived
+        int r = mbedtls_ssl_read(&ssl, nullptr, 0);
+        if (r < 0 && r != MBEDTLS_ERR_SSL_WANT_READ && r != MBEDTLS_ERR_SSL_WANT_WRITE)
+        {
+            closeSocket();
+            return 0;
+        }
+    }
+    return (int)mbedtls_ssl_get_bytes_avail(&ssl);
+}
+
+int TlsStream::read(uint8_t *buf, size_t size)
+{
+    if (!established)
+        return -1;
+    int r = mbedtls_ssl_read(&ssl, buf, size);
+    if (r > 0)
+        return r;
+    if (r != MBEDTLS_ERR_SSL_WANT_READ && r != MBEDTLS_ERR_SSL_WANT_WRITE)
+        closeSocket(); // 0 or close_notify: the broker hung up
+    return -1;
+}
+
+uint8_t TlsStream::connected()
+{
+    if (!established)
+        return 0;
+    uint8_t b;
+    int r = lwip_recv(net.fd, &b, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (r > 0 || (r < 0 && (errno == EWOULDBLOCK || errno == EAGAIN)))
+        return 1;
+    closeSocket();
+    return 0;
+}
+
+// =================== Handshake ===================
+
+// Called for each certificate of the chain; the result is left to
+// VERIFY_REQUIRED, this only records that the chain was checked
+static int onVerify(void *, mbedtls_x509_crt *, int, uint32_t *)
+{
+    verifiedNow = true;
+    return 0;
+}
+
+bool tlsInit()
+{
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&drbg);
+    mbedtls_x509_crt_init(&ca);
+    mbedtls_ssl_config_init(&conf);
+    mbedtls_ssl_init(&ssl);
+    mbedtls_ssl_session_init(&cached);
+    mbedtls_net_init(&net);
+
+    static const char PERSONALIZATION[] = MQTT_CLIENT_ID;
+    int r = mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, (const unsigned char *)PERSONALIZATION,
+                                  sizeof(PERSONALIZATION) - 1);
+    if (r != 0)
+    {
+        logError("RNG seed", r);
+        return false;
+    }
+    // PEM input must include the terminating NUL
+    r = mbedtls_x509_crt_parse(&ca, (const unsigned char *)MQTT_CA_PEM, sizeof(MQTT_CA_PEM));
+    if (r != 0)
+    {
+        logError("CA certificate (include/mqtt_ca.h)", r);
+        return false;
+    }
+    r = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT);
+    if (r == 0)
+    {
+        mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+        mbedtls_ssl_conf_ca_chain(&conf, &ca, nullptr);
+        mbedtls_ssl_conf_verify(&conf, onVerify, nullptr);
+        mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &drbg);
+        mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+        r = mbedtls_ssl_setup(&ssl, &conf);
+    }
+    if (r == 0)
+        r = mbedtls_ssl_set_hostname(&ssl, MQTT_TLS_SERVER_NAME);
+    if (r != 0)
+    {
+        logError("setup", r);
+        return false;
+    }
+
+    ready = true;
+    haveCached = LittleFS.exists(MQTT_TLS_SESSION_PATH) && loadSession();
+    Serial.printf("TLS: CA pinned, %s\n", haveCached ? "saved session loaded" : "no saved session");
+    return true;
+}
+
+bool tlsStart(int fd)
+{
+    closeSocket();
+    if (!ready)
+    {
+        lwip_close(fd);
+        return false;
+    }
+    mbedtls_ssl_session_reset(&ssl);
+    net.fd = fd;
+    mbedtls_net_set_nonblock(&net);
+    mbedtls_ssl_set_bio(&ssl, &net, mbedtls_net_send, mbedtls_net_recv, nullptr);
+    if (haveCached && sessionTooOld())
+        haveCached = false;
+    if (haveCached && mbedtls_ssl_set_session(&ssl, &cached) != 0)
+        haveCached = false;
+    resumedNow = false;
+    verifiedNow = false;
+    startMs = millis();
+    return true;
+}
+
+int tlsPoll()
+{
+    if (net.fd < 0)
+        return -1;
+    if (established)
+        return 1;
+    int r = mbedtls_ssl_handshake(&ssl);
+    if (r == MBEDTLS_ERR_SSL_WANT_READ || r == MBEDTLS_ERR_SSL_WANT_WRITE)
+        return 0;
+    if (r != 0)
+    {
+        logError("handshake", r);
+        uint32_t flags = mbedtls_ssl_get_verify_result(&ssl);
+        if (flags != 0 && flags != (uint32_t)-1)
+            Serial.printf("TLS: broker certificate rejected (flags 0x%lx), does it chain to MQTT_CA_PEM?\n",
+                          (unsigned long)flags);
+        stats.failed++;
+        closeSocket();
+        return -1;
+    }
+
+    uint32_t ms = millis() - startMs;
+    mbedtls_ssl_session fresh;
+    mbedtls_ssl_session_init(&fresh);
+    mbedtls_ssl_get_session(&ssl, &fresh);
+    resumedNow = haveCached && !verifiedNow;
+    mbedtls_ssl_session_free(&cached);
+    cached = fresh; // takes over its allocations (ticket, peer certificate)
+    haveCached = true;
+    established = true;
+
+    stats.lastMs = ms;
+    if (resumedNow)
+    {
+        stats.resumed++;
+        stats.maxResumedMs = max(stats.maxResumedMs, ms);
+    }
+    else
+    {
+        stats.full++;
+        stats.maxFullMs = max(stats.maxFullMs, ms);
+        saveSession();
+    }
+    return 1;
+}
+
+bool tlsResumed()
+{
+    return resumedNow;
+}
+
+Client &tlsClient()
+{
+    return stream;
+}
+
+int tlsFd()
+{
+    return net.fd;
+}
+
+bool tlsWritable()
+{
+    return flushPending() && tcpWritable(net.fd);
+}
+
+TlsStats tlsStats()
+{
+    return stats;
+}
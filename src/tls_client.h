@@ -0,0 +1,55 @@
+#ifndef TLS_CLIENT_H
+#define TLS_CLIENT_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+// TLS on the socket tcp_connect opened (MQTT_TLS), driven by mbedTLS
+// directly: WiFiClientSecure only does a blocking connect of its own and
+// cannot resume a session. The broker certificate must chain to
+// MQTT_CA_PEM (include/mqtt_ca.h), the only trusted root. The session of
+// the last full handshake is offered on every reconnect and kept in
+// LittleFS, so a reboot resumes too; a resumed handshake skips the
+// certificate check and key exchange (one round trip, a few ms of CPU
+// instead of seconds).
+
+struct TlsStats
+{
+    uint32_t full;          // handshakes with certificate check and key exchange
+    uint32_t resumed;       // abbreviated handshakes on a cached session
+    uint32_t failed;        // handshakes that ended in an error or timed out
+    uint32_t lastMs;        // duration of the latest successful one
+    uint32_t maxFullMs;
+    uint32_t maxResumedMs;
+    uint32_t sessionSaves;  // session file writes
+};
+
+// Parse the CA, seed the RNG and load the saved session (after LittleFS is
+// mounted); false if the CA does not parse, and nothing will connect
+bool tlsInit();
+
+// Take over a connected socket (it is closed on failure) and start the
+// handshake, offering the cached session
+bool tlsStart(int fd);
+
+// Advance the handshake without blocking on the network: 1 = done, 0 = in
+// progress, -1 = failed (socket closed). The crypto of one step still runs
+// to completion.
+int tlsPoll();
+
+// True if the finished handshake resumed the cached session
+bool tlsResumed();
+
+// The record layer as an Arduino Client, for PubSubClient
+Client &tlsClient();
+
+// Socket under the session, -1 when closed
+int tlsFd();
+
+// True if a write would be taken whole: the last unfinished record has gone
+// out (retried here, without waiting) and the socket has send-buffer room
+bool tlsWritable();
+
+TlsStats tlsStats();
+
+#endif // TLS_CLIENT_H
@@ -1,5 +1,6 @@
 #include "ui.h"
 #include "config.h"
+#include "history.h"
 
 // --- Layout (adaptive) ---
 static bool compactMode = false;
@@ -9,6 +10,65 @@ static int PILL_X, PILL_Y, PILL_W;
 static int CARD_W, CARD_ROW1_Y, CARD_ROW2_Y;
 static int lastPillFill = -1;
 
+// --- Value fields: redraw only the characters that changed ---
+struct TextField
+{
+    int x, y;       // anchor: top-left, or top-right when rightAlign
+    bool rightAlign;
+    uint8_t font, size;
+    uint16_t fg, bg;
+    char text[24]; // last rendered string
+    int width;     // its width in pixels
+};
+
+static TextField windField, envField, pressureField, pillField;
+
+// --- Surfaces: the parts of the screen that change ---
+// Each one is composed off-screen in a sprite and sent in one piece (DMA
+// when available), so the panel never shows a half-drawn value and the CPU
+// does not wait for SPI. Without a sprite (UI_SPRITES 0, over
+// UI_SPRITE_BUDGET, or short on heap) the surface is drawn straight to the
+// panel. Drawing code works in surface coordinates plus (dx, dy).
+struct Surface
+{
+    TFT_eSprite *sprite; // nullptr: direct
+    int x, y, w, h;      // panel area
+    uint16_t bg;
+};
+
+static Surface chipSurf, pillSurf, windSurf, envSurf, pressureSurf;
+static bool dmaOk = false;
+static Surface *inFlight = nullptr; // sprite the last DMA transfer reads from
+
+// --- Sparklines: sweep charts over a history series ---
+// Point k goes in column k % (HISTORY_LEN + 1); the column after the newest
+// stays blank as the sweep cursor. A new point draws only its own column
+// and clears the cursor. Only when the series leaves the plotted range, or
+// shrinks to well under it, is the chart rescaled and drawn in full.
+struct Chart
+{
+    HistoryMetric metric;
+    int x, y, h;    // plot area, (HISTORY_LEN + 1) * colW wide
+    int colW;
+    float minSpan;  // smallest plotted range, so noise does not look like a trend
+    float lo, hi;   // plotted range; lo > hi until the first point
+    uint32_t drawn; // series count() at the last draw
+};
+
+static const int CHART_COLS = HISTORY_LEN + 1;
+static Chart windChart, tempChart, pressureChart;
+
+// --- SPI accounting (estimate: ILI9341 address window + 2 bytes per pixel) ---
+static const uint32_t WINDOW_BYTES = 11; // CASET, RASET (4 data bytes each), RAMWR
+static UiStats stats = {};
+static uint64_t rateMarkBytes = 0;
+static uint32_t rateMarkMs = 0;
+
+static void countSpi(int w, int h, uint32_t windows = 1)
+{
+    stats.spiBytes += windows * WINDOW_BYTES + (uint64_t)max(w, 0) * max(h, 0) * 2;
+}
+
 // --------- Layout compute (adaptive to height) ---------
 static void configureLayout(TFT_eSPI &tft)
 {
@@ -20,7 +80,7 @@ static void configureLayout(TFT_eSPI &tft)
         APPBAR_H = 30;
         CHIP_H = 28;
         PILL_H = 18;
-        CARD_H = 44;
+        CARD_H = 52;
         GAP_S = 4;
         GAP_M = 8;
         GAP_ROW = 6;
@@ -31,17 +91,17 @@ static void configureLayout(TFT_eSPI &tft)
         APPBAR_H = 44;
         CHIP_H = 36;
         PILL_H = 26;
-        CARD_H = 58;
+        CARD_H = 64;
         GAP_S = 6;
         GAP_M = 12;
-        GAP_ROW = 14;
+        GAP_ROW = 10;
     }
 
     PILL_X = PAD;
     PILL_W = tft.width() - 2 * PAD;
     PILL_Y = PAD + APPBAR_H + GAP_S + CHIP_H + GAP_M;
 
-    CARD_ROW1_Y = PILL_Y + PILL_H + (compactMode ? 16 : 30);
+    CARD_ROW1_Y = PILL_Y + PILL_H + (compactMode ? 16 : 26);
     CARD_ROW2_Y = CARD_ROW1_Y + CARD_H + GAP_ROW;
 }
 
@@ -51,35 +111,206 @@ static void drawShadowRect(TFT_eSPI &tft, int x, int y, int w, int h, uint16_t f
     tft.fillRoundRect(x, y, w, h, 10, fill);
 }
 
+static void initField(TextField &f, int x, int y, bool rightAlign, uint8_t font, uint8_t size, uint16_t fg, uint16_t bg)
+{
+    f = TextField{x, y, rightAlign, font, size, fg, bg, "", 0};
+}
+
+static int textWidthOf(TFT_eSPI &tft, const char *s, size_t len)
+{
+    char buf[sizeof(TextField::text)];
+    len = min(len, sizeof(buf) - 1);
+    memcpy(buf, s, len);
+    buf[len] = '\0';
+    return tft.textWidth(buf);
+}
+
+// Draw text into f, touching only the span between the unchanged head and
+// tail of the previous string. Glyphs are drawn with their background, so
+// only a shrinking string needs an explicit clear. False if nothing changed.
+static bool drawField(TFT_eSPI &tft, TextField &f, const char *text, int dx, int dy)
+{
+    if (strcmp(text, f.text) == 0)
+    {
+        stats.fieldSkips++;
+        return false;
+    }
+    stats.fieldRedraws++;
+
+    tft.setTextDatum(TL_DATUM);
+    tft.setTextFont(f.font);
+    tft.setTextSize(f.size);
+    tft.setTextColor(f.fg, f.bg);
+
+    // Common head and tail, on UTF-8 character boundaries
+    size_t oldLen = strlen(f.text), newLen = min(strlen(text), sizeof(f.text) - 1);
+    size_t head = 0;
+    while (head < oldLen && head < newLen && f.text[head] == text[head])
+        head++;
+    while (head > 0 && (text[head] & 0xC0) == 0x80)
+        head--;
+    size_t tail = 0;
+    while (tail < oldLen - head && tail < newLen - head && f.text[oldLen - 1 - tail] == text[newLen - 1 - tail])
+        tail++;
+    while (tail > 0 && (text[newLen - tail] & 0xC0) == 0x80)
+        tail--;
+
+    // If the changed middle keeps its width, head and tail stay in place;
+    // otherwise the side away from the anchor moves and is redrawn too
+    int newW = textWidthOf(tft, text, newLen);
+    if (textWidthOf(tft, text + head, newLen - head - tail) != textWidthOf(tft, f.text + head, oldLen - head - tail))
+    {
+        if (f.rightAlign)
+            head = 0;
+        else
+            tail = 0;
+    }
+
+    int left = dx + (f.rightAlign ? f.x - newW : f.x);
+    int h = tft.fontHeight();
+    size_t midLen = newLen - head - tail;
+    if (midLen)
+    {
+        char mid[sizeof(f.text)];
+        memcpy(mid, text + head, midLen);
+        mid[midLen] = '\0';
+        tft.drawString(mid, left + textWidthOf(tft, text, head), dy + f.y);
+        if (dx || dy)
+            countSpi(tft.textWidth(mid), h, midLen); // direct to the panel
+    }
+    if (newW < f.width)
+    {
+        int clearX = dx + (f.rightAlign ? f.x - f.width : f.x + newW);
+        tft.fillRect(clearX, dy + f.y, f.width - newW, h, f.bg);
+        if (dx || dy)
+            countSpi(f.width - newW, h);
+    }
+
+    memcpy(f.text, text, newLen);
+    f.text[newLen] = '\0';
+    f.width = newW;
+    tft.setTextSize(1);
+    return true;
+}
+
+// Forget what the field shows (its pixels were painted over)
+static void resetField(TextField &f)
+{
+    f.text[0] = '\0';
+    f.width = 0;
+}
+
+// Give back the sprite of s (uiInit() runs again after a layout change)
+static void freeSurface(Surface &s)
+{
+    if (!s.sprite)
+        return;
+    s.sprite->deleteSprite();
+    delete s.sprite;
+    s.sprite = nullptr;
+}
+
+static void allocSurface(TFT_eSPI &tft, Surface &s, int x, int y, int w, int h, uint16_t bg)
+{
+    freeSurface(s);
+    s = Surface{nullptr, x, y, w, h, bg};
+#if UI_SPRITES
+    uint32_t bytes = (uint32_t)w * h * 2;
+    if (stats.spriteBytes + bytes > UI_SPRITE_BUDGET || ESP.getFreeHeap() < bytes + UI_HEAP_RESERVE ||
+        ESP.getMaxAllocHeap() < bytes)
+    {
+        stats.directSurfaces++;
+        return;
+    }
+    TFT_eSprite *spr = new TFT_eSprite(&tft);
+    spr->setColorDepth(16);
+    if (!spr->createSprite(w, h))
+    {
+        delete spr;
+        stats.directSurfaces++;
+        return;
+    }
+    spr->fillSprite(bg);
+    s.sprite = spr;
+    stats.sprites++;
+    stats.spriteBytes += bytes;
+#else
+    (void)tft;
+    stats.directSurfaces++;
+#endif
+}
+
+// A DMA transfer may still be reading a sprite or holding the bus
+static void settle(TFT_eSPI &tft)
+{
+    if (dmaOk)
+        tft.dmaWait();
+    inFlight = nullptr;
+}
+
+// Target for drawing s: its sprite (offset 0) or the panel (offset x, y).
+// Another sprite can be drawn while the last one is still being sent.
+static TFT_eSPI &beginSurface(TFT_eSPI &tft, Surface &s, int &dx, int &dy)
+{
+    if (!s.sprite || inFlight == &s)
+        settle(tft);
+    dx = s.sprite ? 0 : s.x;
+    dy = s.sprite ? 0 : s.y;
+    return s.sprite ? *s.sprite : tft;
+}
+
+static void pushSurface(TFT_eSPI &tft, Surface &s)
+{
+    if (!s.sprite)
+        return;
+    if (dmaOk)
+    {
+        tft.pushImageDMA(s.x, s.y, s.w, s.h, (uint16_t *)s.sprite->getPointer());
+        inFlight = &s;
+        stats.dmaPushes++;
+    }
+    else
+    {
+        s.sprite->pushSprite(s.x, s.y);
+    }
+    countSpi(s.w, s.h);
+}
+
 static void drawChip(TFT_eSPI &tft, bool isDry)
 {
     const char *label = isDry ? "DRY" : "RAIN";
     uint16_t col = isDry ? COL_GOOD : COL_BAD;
 
-    int cx = tft.width() / 2, w = compactMode ? 120 : 136, h = CHIP_H;
-    int x = cx - w / 2, y = PAD + APPBAR_H + GAP_S;
+    int x, y;
+    TFT_eSPI &g = beginSurface(tft, chipSurf, x, y);
+    int w = chipSurf.w, h = chipSurf.h, cx = x + w / 2;
 
-    tft.fillRoundRect(x, y, w, h, 16, COL_SURFACE);
-    tft.drawRoundRect(x, y, w, h, 16, col);
+    g.fillRoundRect(x, y, w, h, 16, COL_SURFACE);
+    g.drawRoundRect(x, y, w, h, 16, col);
 
     if (isDry)
     {
-        tft.fillCircle(x + 18, y + h / 2, compactMode ? 7 : 8, COL_GOOD);
+        g.fillCircle(x + 18, y + h / 2, compactMode ? 7 : 8, COL_GOOD);
     }
     else
     {
         int cx2 = x + 18, cy2 = y + h / 2;
-        tft.fillCircle(cx2, cy2 - 4, compactMode ? 5 : 6, COL_BAD);
-        tft.fillTriangle(cx2 - 6, cy2 - 2, cx2 + 6, cy2 - 2, cx2, cy2 + 10, COL_BAD);
+        g.fillCircle(cx2, cy2 - 4, compactMode ? 5 : 6, COL_BAD);
+        g.fillTriangle(cx2 - 6, cy2 - 2, cx2 + 6, cy2 - 2, cx2, cy2 + 10, COL_BAD);
     }
 
-    tft.setTextDatum(MC_DATUM);
-    tft.setTextColor(col, COL_SURFACE);
-    tft.setTextFont(1);
-    tft.setTextSize(compactMode ? 2 : 3);
-    tft.drawString(label, cx + 4, y + h / 2);
-    tft.setTextSize(1);
-    tft.setTextDatum(TL_DATUM);
+    g.setTextDatum(MC_DATUM);
+    g.setTextColor(col, COL_SURFACE);
+    g.setTextFont(1);
+    g.setTextSize(compactMode ? 2 : 3);
+    g.drawString(label, cx + 4, y + h / 2);
+    g.setTextSize(1);
+    g.setTextDatum(TL_DATUM);
+
+    if (chipSurf.sprite)
+        pushSurface(tft, chipSurf);
+    else
+        countSpi(w, h, 2 * h); // body, outline and icon: about one span per row
 }
 
 static void drawAppBar(TFT_eSPI &tft)
@@ -122,24 +353,40 @@ static void drawPillFill(TFT_eSPI &tft, float pct)
 {
     pct = constrain(pct, 0.0f, 100.0f);
     int fillW = (int)(PILL_W * (pct / 100.0f));
-    if (fillW == lastPillFill)
+    char buf[16];
+    snprintf(buf, sizeof(buf), compactMode ? "%.0f %%" : "%.1f %%", pct);
+    if (fillW == lastPillFill && strcmp(buf, pillField.text) == 0)
+    {
+        stats.fieldSkips++;
         return;
-    lastPillFill = fillW;
+    }
 
-    tft.fillRoundRect(PILL_X + 1, PILL_Y + 1, PILL_W - 2, PILL_H - 2, (PILL_H - 2) / 2, COL_SURFACE);
-    if (fillW > 2)
+    int dx, dy;
+    TFT_eSPI &g = beginSurface(tft, pillSurf, dx, dy);
+    int x = dx + PILL_X - pillSurf.x, y = dy + PILL_Y - pillSurf.y;
+    if (fillW != lastPillFill)
     {
-        tft.fillRoundRect(PILL_X + 1, PILL_Y + 1, fillW - 2, PILL_H - 2, (PILL_H - 2) / 2, COL_ACCENT);
+        lastPillFill = fillW;
+        if (pillSurf.sprite)
+        {
+            g.fillRoundRect(x, y, PILL_W, PILL_H, PILL_H / 2, COL_SURFACE);
+            g.drawRoundRect(x, y, PILL_W, PILL_H, PILL_H / 2, COL_BORDER);
+        }
+        else
+        {
+            g.fillRoundRect(x + 1, y + 1, PILL_W - 2, PILL_H - 2, (PILL_H - 2) / 2, COL_SURFACE);
+            countSpi(PILL_W - 2, PILL_H - 2, PILL_H);
+        }
+        if (fillW > 2)
+        {
+            g.fillRoundRect(x + 1, y + 1, fillW - 2, PILL_H - 2, (PILL_H - 2) / 2, COL_ACCENT);
+            if (!pillSurf.sprite)
+                countSpi(fillW - 2, PILL_H - 2, PILL_H);
+        }
+        resetField(pillField); // the label sits on the bar
     }
-
-    int px = PILL_X + PILL_W - 4, py = PILL_Y - (compactMode ? 0 : 2);
-    tft.fillRect(px - (compactMode ? 66 : 86), py - (compactMode ? 18 : 22),
-                 (compactMode ? 66 : 86), (compactMode ? 18 : 22), COL_BG);
-    tft.setTextDatum(TR_DATUM);
-    tft.setTextFont(compactMode ? 1 : 2);
-    tft.setTextColor(COL_NUMBER, COL_BG);
-    tft.drawString(compactMode ? String(pct, 0) + " %" : String(pct, 1) + " %", px, py);
-    tft.setTextDatum(TL_DATUM);
+    drawField(g, pillField, buf, dx, dy);
+    pushSurface(tft, pillSurf);
 }
 
 static void drawCardsFrame(TFT_eSPI &tft)
@@ -168,81 +415,162 @@ static void drawCardsFrame(TFT_eSPI &tft)
         tft.setTextDatum(MC_DATUM);
         tft.setTextFont(compactMode ? 1 : 2);
         tft.setTextColor(COL_TEXT, COL_BG);
-        tft.drawString("Reset with plate dry to re-calibrate",
+        tft.drawString("Plate dry? Send cmd/calibrate dry",
                        tft.width() / 2, tft.height() - (compactMode ? 8 : 10));
     }
 }
 
-static void updateWindSpeedCard(TFT_eSPI &tft, float ms)
+static void drawValue(TFT_eSPI &tft, Surface &surf, TextField &f, const char *text)
 {
-    int y = CARD_ROW1_Y;
-    int valueY = y + (compactMode ? 22 : 26);
-    int valueW = (tft.width() - 2 * PAD) - 20;
-    tft.fillRect(PAD + 10, valueY, valueW, (compactMode ? 20 : 24), COL_SURFACE);
+    if (strcmp(text, f.text) == 0)
+    {
+        stats.fieldSkips++;
+        return;
+    }
+    int dx, dy;
+    TFT_eSPI &g = beginSurface(tft, surf, dx, dy);
+    drawField(g, f, text, dx, dy);
+    pushSurface(tft, surf);
+}
 
-    tft.setTextDatum(TL_DATUM);
-    tft.setTextFont(1);
-    tft.setTextSize(2);
-    tft.setTextColor(COL_NUMBER, COL_SURFACE);
+static void updateWindSpeedCard(TFT_eSPI &tft, float ms)
+{
     char buf[24];
     snprintf(buf, sizeof(buf), "%.1f m/s", ms);
-    tft.drawString(buf, PAD + 10, valueY);
-    tft.setTextSize(1);
+    drawValue(tft, windSurf, windField, buf);
 }
 
 static void updateEnvTempHum(TFT_eSPI &tft, float tC, float rh)
 {
-    int y = CARD_ROW2_Y;
-    tft.fillRect(PAD + 10, y + (compactMode ? 22 : 26), CARD_W - 20,
-                 (compactMode ? 20 : 24), COL_SURFACE);
-
-    tft.setTextDatum(TL_DATUM);
-    tft.setTextFont(1);
-    tft.setTextSize(2);
-    tft.setTextColor(COL_NUMBER, COL_SURFACE);
-    if (!isnan(tC))
-    {
-        char buf[48];
-        if (compactMode)
-            snprintf(buf, sizeof(buf), "%.1fC  %.0f%%", tC, rh);
-        else
-            snprintf(buf, sizeof(buf), "%.1f°C   %.0f%%", tC, rh);
-        tft.drawString(buf, PAD + 10, y + (compactMode ? 22 : 26));
-    }
+    char buf[24];
+    if (isnan(tC))
+        snprintf(buf, sizeof(buf), "-- C  -- %%");
+    else if (compactMode)
+        snprintf(buf, sizeof(buf), "%.1fC  %.0f%%", tC, rh);
     else
-    {
-        tft.drawString("-- C  -- %", PAD + 10, y + (compactMode ? 22 : 26));
-    }
-    tft.setTextSize(1);
+        snprintf(buf, sizeof(buf), "%.1f°C   %.0f%%", tC, rh);
+    drawValue(tft, envSurf, envField, buf);
 }
 
 static void updateEnvPressure(TFT_eSPI &tft, float hPa)
 {
-    int y = CARD_ROW2_Y;
-    int x = PAD * 2 + CARD_W;
+    char buf[24];
+    if (isnan(hPa))
+        snprintf(buf, sizeof(buf), "-- hPa");
+    else
+        snprintf(buf, sizeof(buf), "%.0f hPa", hPa);
+    drawValue(tft, pressureSurf, pressureField, buf);
+}
 
-    tft.fillRect(x + 10, y + (compactMode ? 22 : 26), CARD_W - 20,
-                 (compactMode ? 20 : 24), COL_SURFACE);
+static int chartY(const Chart &c, float v)
+{
+    float t = (v - c.lo) / (c.hi - c.lo);
+    return c.y + c.h - 1 - (int)(constrain(t, 0.0f, 1.0f) * (c.h - 1) + 0.5f);
+}
 
-    tft.setTextDatum(TL_DATUM);
-    tft.setTextFont(1);
-    tft.setTextSize(2);
-    tft.setTextColor(COL_NUMBER, COL_SURFACE);
-    if (!isnan(hPa))
+// Column of point i of s (0 = oldest held), joined to the point before it
+static void drawChartColumn(TFT_eSPI &tft, const Chart &c, const HistorySeries &s, uint16_t i, bool clear)
+{
+    uint32_t k = s.count() - s.size() + i;
+    int x = c.x + (int)(k % CHART_COLS) * c.colW;
+    if (clear)
     {
-        char buf[32];
-        snprintf(buf, sizeof(buf), "%.0f hPa", hPa);
-        tft.drawString(buf, x + 10, y + (compactMode ? 22 : 26));
+        tft.fillRect(x, c.y, c.colW, c.h, COL_SURFACE);
+        countSpi(c.colW, c.h);
     }
-    else
+    float v = s.at(i);
+    if (isnan(v))
+        return;
+    int y0 = chartY(c, v), y1 = y0;
+    if (i > 0 && !isnan(s.at(i - 1)))
+        y1 = chartY(c, s.at(i - 1));
+    int top = min(y0, y1), h = abs(y0 - y1) + 1;
+    tft.fillRect(x, top, c.colW, h, COL_ACCENT);
+    countSpi(c.colW, h);
+    stats.chartColumns++;
+}
+
+static void redrawChart(TFT_eSPI &tft, Chart &c, const HistorySeries &s)
+{
+    float mid = (s.min() + s.max()) / 2;
+    float half = max(s.max() - s.min(), c.minSpan) * 0.6f; // 20 % headroom
+    c.lo = mid - half;
+    c.hi = mid + half;
+
+    tft.fillRect(c.x, c.y, CHART_COLS * c.colW, c.h, COL_SURFACE);
+    countSpi(CHART_COLS * c.colW, c.h);
+    for (uint16_t i = 0; i < s.size(); i++)
+        drawChartColumn(tft, c, s, i, false);
+    stats.chartRedraws++;
+}
+
+static void updateChart(TFT_eSPI &tft, Chart &c)
+{
+    const HistorySeries &s = historySeries(c.metric);
+    uint32_t added = s.count() - c.drawn;
+    if (added == 0)
+        return;
+    c.drawn = s.count();
+    if (!s.hasRange() && c.lo > c.hi)
+        return; // nothing to plot yet
+
+    settle(tft);
+    if (s.hasRange())
     {
-        tft.drawString("-- hPa", x + 10, y + (compactMode ? 22 : 26));
+        float need = max(s.max() - s.min(), c.minSpan);
+        if (c.lo > c.hi || s.min() < c.lo || s.max() > c.hi || added > HISTORY_LEN || c.hi - c.lo > 2.5f * need)
+        {
+            redrawChart(tft, c, s);
+            return;
+        }
     }
-    tft.setTextSize(1);
+    for (uint16_t i = s.size() - added; i < s.size(); i++)
+        drawChartColumn(tft, c, s, i, true);
+    int cursor = c.x + (int)(s.count() % CHART_COLS) * c.colW;
+    tft.fillRect(cursor, c.y, c.colW, c.h, COL_SURFACE);
+    countSpi(c.colW, c.h);
+}
+
+static void initChart(Chart &c, HistoryMetric metric, int cardX, int cardW, int cardY, float minSpan)
+{
+    int colW = max(1, (cardW - 20) / CHART_COLS);
+    c = Chart{metric, cardX + 10, cardY + (compactMode ? 40 : 46), compactMode ? 8 : 12, colW, minSpan, 1, 0, 0};
+}
+
+// Sprites in order of how often they change, until the budget runs out
+static void setupSurfaces(TFT_eSPI &tft)
+{
+    stats.sprites = 0;
+    stats.spriteBytes = 0;
+    stats.directSurfaces = 0;
+
+    // The wetness label overlaps the right end of the bar
+    int labelY = PILL_Y - (compactMode ? 0 : 2), labelH = compactMode ? 8 : 16;
+    int top = min(PILL_Y, labelY), bottom = max(PILL_Y + PILL_H, labelY + labelH);
+    allocSurface(tft, pillSurf, PILL_X, top, PILL_W, bottom - top, COL_BG);
+    initField(pillField, PILL_W - 4, labelY - top, true, compactMode ? 1 : 2, 1, COL_NUMBER, COL_BG);
+
+    int valueDy = compactMode ? 22 : 26;
+    int valueH = 16; // GLCD font at size 2
+    allocSurface(tft, windSurf, PAD + 10, CARD_ROW1_Y + valueDy, tft.width() - 2 * PAD - 20, valueH, COL_SURFACE);
+    allocSurface(tft, envSurf, PAD + 10, CARD_ROW2_Y + valueDy, CARD_W - 20, valueH, COL_SURFACE);
+    allocSurface(tft, pressureSurf, PAD * 2 + CARD_W + 10, CARD_ROW2_Y + valueDy, CARD_W - 20, valueH, COL_SURFACE);
+    initField(windField, 0, 0, false, 1, 2, COL_NUMBER, COL_SURFACE);
+    initField(envField, 0, 0, false, 1, 2, COL_NUMBER, COL_SURFACE);
+    initField(pressureField, 0, 0, false, 1, 2, COL_NUMBER, COL_SURFACE);
+
+    initChart(windChart, HIST_WIND, PAD, tft.width() - 2 * PAD, CARD_ROW1_Y, 2.0f);
+    initChart(tempChart, HIST_TEMP, PAD, CARD_W, CARD_ROW2_Y, 1.0f);
+    initChart(pressureChart, HIST_PRESSURE, PAD * 2 + CARD_W, CARD_W, CARD_ROW2_Y, 2.0f);
+
+    int chipW = compactMode ? 120 : 136;
+    allocSurface(tft, chipSurf, tft.width() / 2 - chipW / 2, PAD + APPBAR_H + GAP_S, chipW, CHIP_H, COL_BG);
 }
 
 void uiInit(TFT_eSPI &tft)
 {
+    if (dmaOk)
+        settle(tft); // a sprite may still be on its way out
     tft.init();
     tft.setRotation(1); // landscape
     tft.fillScreen(COL_BG);
@@ -250,11 +578,22 @@ void uiInit(TFT_eSPI &tft)
     configureLayout(tft);
 
     drawAppBar(tft);
-    drawChip(tft, true); // placeholder
     drawPillFrame(tft);
     drawCardsFrame(tft);
 
-    Serial.println("UI initialized");
+    setupSurfaces(tft);
+#if UI_SPRITES
+    if (stats.sprites && !dmaOk)
+    {
+        dmaOk = tft.initDMA();
+        if (dmaOk)
+            tft.startWrite(); // keep the panel selected so transfers can run on behind the CPU
+    }
+#endif
+    drawChip(tft, true); // placeholder
+
+    Serial.printf("UI initialized: %u sprites (%lu B), %u direct, DMA %s\n", stats.sprites,
+                  (unsigned long)stats.spriteBytes, stats.directSurfaces, dmaOk ? "on" : "off");
 }
 
 void uiUpdate(TFT_eSPI &tft, bool isDry, float wetnessPct, float windMs, float tempC, float humidityPct, float pressureHPa)
@@ -270,12 +609,30 @@ void uiUpdate(TFT_eSPI &tft, bool isDry, float wetnessPct, float windMs, float t
     updateWindSpeedCard(tft, windMs);
     updateEnvTempHum(tft, tempC, humidityPct);
     updateEnvPressure(tft, pressureHPa);
+    updateChart(tft, windChart);
+    updateChart(tft, tempChart);
+    updateChart(tft, pressureChart);
+
+    uint32_t now = millis();
+    if (now - rateMarkMs >= 1000)
+    {
+        stats.spiBytesPerSec = (uint32_t)((stats.spiBytes - rateMarkBytes) * 1000 / (now - rateMarkMs));
+        rateMarkBytes = stats.spiBytes;
+        rateMarkMs = now;
+    }
 }
 
 void uiHeartbeat(TFT_eSPI &tft)
 {
     static bool on = false;
     on = !on;
-    tft.fillCircle(tft.width() - 12, PAD + (compactMode ? 12 : 16),
-                   (compactMode ? 3 : 4), on ? COL_ACCENT : COL_BORDER);
+    int r = compactMode ? 3 : 4;
+    settle(tft);
+    tft.fillCircle(tft.width() - 12, PAD + (compactMode ? 12 : 16), r, on ? COL_ACCENT : COL_BORDER);
+    countSpi(2 * r + 1, 2 * r + 1, 2 * r + 1);
+}
+
+UiStats uiStats()
+{
+    return stats;
 }
@@ -3,6 +3,22 @@
 
 #include <TFT_eSPI.h>
 
+// Drawing cost of uiUpdate()/uiHeartbeat(), estimated from what they draw
+// (the panel driver does not count bytes)
+struct UiStats
+{
+    uint64_t spiBytes;
+    uint32_t spiBytesPerSec; // over the last second
+    uint32_t fieldRedraws;   // value fields that changed and were redrawn
+    uint32_t fieldSkips;     // value fields left alone (same text)
+    uint8_t sprites;         // surfaces composed off-screen
+    uint8_t directSurfaces;  // surfaces drawn straight to the panel
+    uint32_t spriteBytes;
+    uint32_t dmaPushes;
+    uint32_t chartColumns; // sparkline columns plotted
+    uint32_t chartRedraws; // full sparkline redraws (rescales)
+};
+
 // Initialize the UI (display, layout, draw static elements)
 void uiInit(TFT_eSPI &tft);
 
@@ -12,4 +28,6 @@ void uiUpdate(TFT_eSPI &tft, bool isDry, float wetnessPct, float windMs, float t
 // Heartbeat indicator
 void uiHeartbeat(TFT_eSPI &tft);
 
+UiStats uiStats();
+
 #endif // UI_H
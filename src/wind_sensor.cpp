@@ -1,9 +1,143 @@
 #include "wind_sensor.h"
 #include "config.h"
+#include "settings.h"
 
-// ===== Wind ISR/shared state =====
+#if POWER_LOW_POWER
+#include "power.h"
+#elif WIND_PCNT
+#include <driver/pcnt.h>
+#else
+#include <spsc_ring.h>
+#endif
+
+// Pulse capture leaves the latest pulse period and the time of the latest
+// pulse; everything else runs in readWind(). Speed is sampled
+// WIND_SAMPLE_HZ times a second from the latest period (so it follows the
+// wind within one pulse), the gust is the running WIND_GUST_S mean of those
+// samples, and every second the samples are folded into a 1 s mean and a
+// 1 s gust peak, kept for WIND_MEAN_LONG_S in centi-m/s. The means are
+// running sums over that history; the gust peak is a scan of it once a
+// second.
+
+static const uint16_t GUST_SAMPLES = WIND_GUST_S * WIND_SAMPLE_HZ;
+static const uint32_t SAMPLE_US = 1000000UL / WIND_SAMPLE_HZ;
+static const uint32_t TIMEOUT_US = WIND_TIMEOUT_MS * 1000UL;
+
+static_assert(WIND_MEAN_SHORT_S <= WIND_MEAN_LONG_S, "short mean must fit in the history");
+
+static uint32_t lastPeriodUs = 0; // 0 = stopped
+static uint32_t lastPulseUs = 0;
+
+#if POWER_LOW_POWER
+
+// ===== ULP backend =====
+// The ULP samples HALL_PIN every ULP_PERIOD_US, also while the cores
+// sleep, and keeps the debounced edge count and the runs since the latest
+// edge. The period is the time between the latest edges of two reads
+// divided by the edges in between (a mean over a whole sleep).
+static uint32_t pulses = 0; // since boot
+static uint16_t lastEdges = 0;
+static bool turning = false;
+
+static bool captureInit()
+{
+    if (!powerHallBegin())
+        return false;
+    lastEdges = powerHallRead().edges;
+    return true;
+}
+
+static void capturePoll(uint32_t nowUs)
+{
+    PowerHall h = powerHallRead();
+    uint16_t n = (uint16_t)(h.edges - lastEdges);
+    if (n == 0)
+        return;
+    lastEdges = h.edges;
+    pulses += n;
+
+    uint32_t edgeUs = nowUs - (uint32_t)h.ticksSinceEdge * ULP_PERIOD_US;
+    uint32_t periodUs = (edgeUs - lastPulseUs) / n;
+    lastPeriodUs = turning && periodUs <= TIMEOUT_US ? periodUs : 0; // first pulses after a standstill
+    turning = true;
+    lastPulseUs = edgeUs;
+}
+
+#elif WIND_PCNT
+
+// ===== PCNT backend =====
+static const pcnt_unit_t PCNT_UNIT = PCNT_UNIT_0;
+static const int16_t PCNT_LIMIT = 32767; // counter wraps to 0 here (minutes at any real speed)
+
+static volatile uint32_t pulses = 0; // since boot; written by readWind() only
+static int16_t lastCount = 0;
+static bool turning = false;
+static uint32_t spanStartUs = 0;
+static uint32_t spanPulses = 0;
+
+static bool captureInit()
+{
+    pcnt_config_t cfg = {};
+    cfg.pulse_gpio_num = HALL_PIN;
+    cfg.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+    cfg.lctrl_mode = PCNT_MODE_KEEP;
+    cfg.hctrl_mode = PCNT_MODE_KEEP;
+    cfg.pos_mode = PCNT_COUNT_DIS; // falling edges, like the interrupt
+    cfg.neg_mode = PCNT_COUNT_INC;
+    cfg.counter_h_lim = PCNT_LIMIT;
+    cfg.counter_l_lim = 0;
+    cfg.unit = PCNT_UNIT;
+    cfg.channel = PCNT_CHANNEL_0;
+    if (pcnt_unit_config(&cfg) != ESP_OK || pcnt_set_filter_value(PCNT_UNIT, WIND_PCNT_FILTER) != ESP_OK ||
+        pcnt_filter_enable(PCNT_UNIT) != ESP_OK)
+        return false;
+    pcnt_counter_pause(PCNT_UNIT);
+    pcnt_counter_clear(PCNT_UNIT);
+    pcnt_counter_resume(PCNT_UNIT);
+    return true;
+}
+
+// Edges are only seen at read time, so the period is the time between two
+// reads that saw new pulses (at least WIND_PCNT_SPAN_MS apart) divided by
+// the pulses in between
+static void capturePoll(uint32_t nowUs)
+{
+    int16_t count;
+    if (pcnt_get_counter_value(PCNT_UNIT, &count) != ESP_OK)
+        return;
+    uint32_t n = (uint32_t)((count - lastCount + PCNT_LIMIT) % PCNT_LIMIT);
+    lastCount = count;
+    if (n == 0)
+        return;
+    pulses = pulses + n;
+
+    if (!turning || nowUs - lastPulseUs > TIMEOUT_US)
+    {
+        // First pulses after a standstill: no period yet
+        turning = true;
+        lastPeriodUs = 0;
+        spanStartUs = nowUs;
+        spanPulses = 0;
+    }
+    else
+    {
+        spanPulses += n;
+        if (nowUs - spanStartUs >= WIND_PCNT_SPAN_MS * 1000UL)
+        {
+            lastPeriodUs = (nowUs - spanStartUs) / spanPulses;
+            spanStartUs = nowUs;
+            spanPulses = 0;
+        }
+    }
+    lastPulseUs = nowUs;
+}
+
+#else
+
+// ===== Interrupt backend =====
+static SpscRing<uint32_t, WIND_PULSE_RING> periods; // µs between debounced pulses
 volatile uint32_t wind_last_us = 0;
-volatile int pulses = 0;
+volatile uint32_t pulses = 0; // since boot; written by the ISR only
 
 void IRAM_ATTR onHall()
 {
@@ -13,41 +147,159 @@ void IRAM_ATTR onHall()
     { // debounce
         wind_last_us = now;
         pulses++;
+        periods.push(dt);
+    }
+}
+
+static bool captureInit()
+{
+    attachInterrupt(digitalPinToInterrupt(HALL_PIN), onHall, FALLING);
+    return true;
+}
+
+static void capturePoll(uint32_t nowUs)
+{
+    (void)nowUs;
+    uint32_t p;
+    while (periods.pop(p))
+        lastPeriodUs = p > TIMEOUT_US ? 0 : p; // first pulse after a standstill
+    lastPulseUs = wind_last_us;
+}
+
+#endif
+
+// ===== Statistics (readWind() side) =====
+// Samples filled in after a stall; in low-power mode a whole sleep
+#if POWER_LOW_POWER
+static const uint16_t CATCHUP_SAMPLES = (POWER_MAX_SLEEP_MS / 1000 + 1) * WIND_SAMPLE_HZ;
+#else
+static const uint16_t CATCHUP_SAMPLES = 2 * WIND_SAMPLE_HZ;
+#endif
+
+static uint32_t nextSampleUs = 0;
+static bool sampling = false;
+
+static uint16_t gustBuf[GUST_SAMPLES];
+static uint32_t gustSum = 0;
+static uint16_t gustPos = 0;
+static uint16_t gustFill = 0;
+
+static uint32_t secSum = 0;
+static uint8_t secCount = 0;
+static uint16_t secPeak = 0;
+
+static uint16_t secMeans[WIND_MEAN_LONG_S];
+static uint16_t secPeaks[WIND_MEAN_LONG_S];
+static uint16_t secPos = 0;
+static uint16_t secFill = 0;
+static uint32_t sumShort = 0;
+static uint32_t sumLong = 0;
+
+static WindSample s = {0, 0, 0, 0, 0, 0};
+
+static float msFromRpm(float rpm)
+{
+    // Linear calibration formula: ms = slope * rpm + offset (settings)
+    if (rpm < settings.windMinRpm)
+        return 0.0f; // Onder de drempel = geen wind
+    return settings.windSlope * rpm + settings.windOffset;
+}
+
+static void closeSecond()
+{
+    uint16_t mean = (uint16_t)(secSum / WIND_SAMPLE_HZ);
+
+    // Slots not written yet are zero, so the sums need no fill checks
+    sumShort += mean - secMeans[(secPos + WIND_MEAN_LONG_S - WIND_MEAN_SHORT_S) % WIND_MEAN_LONG_S];
+    sumLong += mean - secMeans[secPos];
+    secMeans[secPos] = mean;
+    secPeaks[secPos] = secPeak;
+    secPos = (secPos + 1) % WIND_MEAN_LONG_S;
+    if (secFill < WIND_MEAN_LONG_S)
+        secFill++;
+
+    uint16_t peak = 0;
+    for (uint16_t i = 0; i < secFill; i++)
+    {
+        if (secPeaks[i] > peak)
+            peak = secPeaks[i];
     }
+
+    s.gustMax = peak / 100.0f;
+    s.mean2m = sumShort / 100.0f / min<uint16_t>(secFill, WIND_MEAN_SHORT_S);
+    s.mean10m = sumLong / 100.0f / secFill;
+    secSum = 0;
+    secCount = 0;
+    secPeak = 0;
+}
+
+static void addSample(float ms)
+{
+    uint16_t cms = (uint16_t)(ms * 100.0f + 0.5f);
+
+    gustSum += cms - gustBuf[gustPos];
+    gustBuf[gustPos] = cms;
+    gustPos = (gustPos + 1) % GUST_SAMPLES;
+    if (gustFill < GUST_SAMPLES)
+        gustFill++;
+    uint16_t gust = (uint16_t)(gustSum / gustFill);
+    s.gust = gust / 100.0f;
+
+    secSum += cms;
+    if (gust > secPeak)
+        secPeak = gust;
+    if (++secCount == WIND_SAMPLE_HZ)
+        closeSecond();
 }
 
 void windSensorInit()
 {
     pinMode(HALL_PIN, INPUT); // most modules have on-board pull-up
-    attachInterrupt(digitalPinToInterrupt(HALL_PIN), onHall, FALLING);
-    Serial.println("Wind sensor initialized on pin " + String(HALL_PIN));
+    if (!captureInit())
+    {
+        Serial.println("Wind sensor: capture setup failed, no wind readings");
+        return;
+    }
+    Serial.println("Wind sensor initialized on pin " + String(HALL_PIN) +
+                   (POWER_LOW_POWER ? " (ULP)" : WIND_PCNT ? " (PCNT)" : ""));
 }
 
 WindSample readWind()
 {
-    static WindSample s{0, 0};
-    static uint32_t lastMs = millis();
+    uint32_t nowUs = micros();
+    capturePoll(nowUs);
+
+    // No pulse for longer than the last period: the wind is at most this fast
+    uint32_t sinceUs = nowUs - lastPulseUs;
+    uint32_t periodUs = lastPeriodUs;
+    if (sinceUs > TIMEOUT_US)
+        periodUs = 0;
+    else if (periodUs && sinceUs > periodUs)
+        periodUs = sinceUs;
+
+    s.rpm = periodUs ? 60e6f / ((float)periodUs * PPR) : 0.0f;
+    s.ms = msFromRpm(s.rpm);
 
-    // timeout => calculate wind from pulse count over timeout window
-    if (millis() - lastMs > WIND_TIMEOUT_MS)
+    if (!sampling)
     {
-        s.rpm = pulses * 60.0f / PPR / (WIND_TIMEOUT_MS / 1000.0f);
-        pulses = 0;
-        lastMs = millis();
-        // Linear calibration formula: ms = 0.0063 * rpm + 1.9973
-        if (s.rpm < 10.0f)
-        {
-            s.ms = 0.0f; // Onder 10 RPM = geen wind
-        }
-        else
+        nextSampleUs = nowUs;
+        sampling = true;
+    }
+    // After a long stall, fill at most CATCHUP_SAMPLES and skip the rest
+    for (uint16_t n = 0; (int32_t)(nowUs - nextSampleUs) >= 0; n++)
+    {
+        if (n == CATCHUP_SAMPLES)
         {
-            s.ms = 0.0063 * s.rpm + 1.9973;
+            nextSampleUs = nowUs + SAMPLE_US;
+            break;
         }
+        addSample(s.ms);
+        nextSampleUs += SAMPLE_US;
     }
     return s;
 }
 
 int getWindPulseCount()
 {
-    return pulses;
+    return (int)pulses;
 }
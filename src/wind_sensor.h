@@ -5,14 +5,18 @@
 
 struct WindSample
 {
-    float rpm;
-    float ms; // meters per second
+    float rpm;     // instantaneous, from the last pulse period
+    float ms;      // instantaneous, meters per second
+    float gust;    // current WIND_GUST_S running mean (m/s)
+    float gustMax; // highest WIND_GUST_S mean over the last WIND_MEAN_LONG_S (m/s)
+    float mean2m;  // mean over the last WIND_MEAN_SHORT_S (m/s)
+    float mean10m; // mean over the last WIND_MEAN_LONG_S (m/s)
 };
 
 // Initialize wind sensor (attach interrupt, etc.)
 void windSensorInit();
 
-// Read current wind speed (call periodically)
+// Read current wind speed (call periodically, from one task only)
 WindSample readWind();
 
 // Get pulse count (for debugging)
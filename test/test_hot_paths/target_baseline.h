@@ -0,0 +1,15 @@
+#ifndef TARGET_BASELINE_H
+#define TARGET_BASELINE_H
+
+// CPU cycles per call on the lolin32 (240 MHz), the on-target counterpart
+// of lib/native_sim/bench_baseline.csv. These start as budgets (a quarter
+// of a millisecond for the rain update, whose DMA read and decimation
+// dominate, and a few microseconds for the wind read); once a board has
+// run the test, replace them with the cycles it printed and commit them
+// with the change that moved them.
+#define TARGET_RAIN_UPDATE_CYCLES 60000
+#define TARGET_WIND_READ_CYCLES 4000
+
+#define TARGET_TOLERANCE_PCT 10 // allowed growth per call, as --tolerance on the host
+
+#endif // TARGET_BASELINE_H
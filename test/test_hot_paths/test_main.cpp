@@ -0,0 +1,78 @@
+// On-target counterpart of the rain.update and wind.read cases of
+// --bench-suite: times rainSensorUpdate() and readWind() with the CPU
+// cycle counter at the acquisition cadence and fails if a call got more
+// than TARGET_TOLERANCE_PCT slower than target_baseline.h.
+//   pio test -e lolin32 -v      (-v shows the measured cycles)
+
+#include <Arduino.h>
+#include <ESP32Servo.h>
+#include <unity.h>
+
+#include "config.h"
+#include "rain_sensor.h"
+#include "settings.h"
+#include "target_baseline.h"
+#include "wind_sensor.h"
+
+static Servo servo;
+
+static const uint32_t TIMED_CALLS = 100; // 8 s of LOGIC_PERIOD_MS ticks
+
+// Mean cycles per call; the DMA buffer refills and the wind ISR runs
+// between calls, as they do in the acquisition task
+template <typename F>
+static uint32_t meanCycles(F fn)
+{
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < TIMED_CALLS; i++)
+    {
+        delay(LOGIC_PERIOD_MS);
+        uint32_t t0 = ESP.getCycleCount();
+        fn();
+        total += ESP.getCycleCount() - t0;
+    }
+    return (uint32_t)(total / TIMED_CALLS);
+}
+
+static void checkCycles(const char *name, uint32_t cycles, uint32_t baseline)
+{
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%s: %u cycles per call (%.1f us), baseline %u", name, (unsigned)cycles,
+             cycles / (float)ESP.getCpuFreqMHz(), (unsigned)baseline);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(baseline + baseline / 100 * TARGET_TOLERANCE_PCT, cycles, msg);
+}
+
+void test_rain_update()
+{
+    checkCycles("rain.update", meanCycles([] { rainSensorUpdate(servo); }), TARGET_RAIN_UPDATE_CYCLES);
+}
+
+void test_wind_read()
+{
+    checkCycles("wind.read", meanCycles([] { readWind(); }), TARGET_WIND_READ_CYCLES);
+}
+
+void setup()
+{
+    delay(2000); // the test runner opens the port after the reset
+
+    settingsInit();
+    rainSensorInit(servo);
+    windSensorInit();
+    // Past the boot calibration, so the timed calls run the filter
+    for (uint8_t i = 0; i <= RAIN_BOOT_CAL_TICKS; i++)
+    {
+        delay(LOGIC_PERIOD_MS);
+        rainSensorUpdate(servo);
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_rain_update);
+    RUN_TEST(test_wind_read);
+    UNITY_END();
+}
+
+void loop()
+{
+}